@@ -28,6 +28,7 @@
 #include "enum_strings.h"
 #include "zrt_helper_macros.h"
 #include "zrtlog.h"
+#include "zrtapi.h" /*SEEK_DATA, SEEK_HOLE*/
 
 static char s_buffer[MAX_FLAGS_LEN];
 
@@ -62,7 +63,7 @@ static struct enum_data_t s_mmap_flags_array2[] = {
 };
 
 static struct enum_data_t s_seek_whence_array3[] = {
-    EITEM(SEEK_SET), EITEM(SEEK_CUR), EITEM(SEEK_END)
+    EITEM(SEEK_SET), EITEM(SEEK_CUR), EITEM(SEEK_END), EITEM(SEEK_DATA), EITEM(SEEK_HOLE)
 };
 
 static struct enum_data_t s_lock_type_array4[] = {
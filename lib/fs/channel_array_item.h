@@ -23,6 +23,16 @@
 #include "zvm.h" // struct ZVMChannel;
 #include "fcntl.h" //struct flock
 
+/*Buffer of channel data, used for read-ahead from sequential channels
+ *and for coalescing writes*/
+struct ChannelIoBuffer{
+    char*   data;                  /*allocated on first use*/
+    int32_t size;                  /*allocated size of data*/
+    int32_t len;                   /*count of valid bytes in data*/
+    int32_t pos;                   /*position of next unread byte*/
+    int64_t offset;                /*channel position of data[0], for writes*/
+};
+
 /*Channel info we need to keep at runtime(For opened channels)
  *suitable data is: opened flags, mode, i/o positions*/
 struct ZrtChannelRt{
@@ -34,6 +44,15 @@ struct ZrtChannelRt{
     int     mode;                  /*channel type, taken from mapping nvram section*/
     int     emu;                   /*equal to 1 if it's emulated channel (not provided by zerovm)*/
     struct flock fcntl_flock;      /*lock flag for support fcntl locking function*/
+    int32_t iobuffer_size;         /*size of i/o buffer, taken from iobuffer nvram
+				     section; 0 - disabled, -1 - default size*/
+    struct ChannelIoBuffer readahead; /*data read from channel but not yet
+					consumed, shared by all opened fds of
+					sequential channel*/
+    struct ChannelIoBuffer writebehind; /*data written by user but not yet
+					  passed to zvm_pwrite*/
+    uint32_t writes;               /*count of user writes into buffered channel*/
+    uint32_t write_traps;          /*count of zvm_pwrite calls for buffered channel*/
 };
 
 
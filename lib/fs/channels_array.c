@@ -17,6 +17,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 
 #include "zvm.h" //struct ZVMChannel
@@ -38,27 +39,68 @@
 		continue; /*do not add matched channel*/		\
 	    }								\
 	    /*alloc item*/						\
-	    item = malloc(sizeof(struct ChannelArrayItem));		\
+	    item = calloc(1, sizeof(struct ChannelArrayItem));		\
 	    item->channel = &(channels_array_p)[i];			\
+	    item->channel_runtime.iobuffer_size = -1;			\
 	    item->channel_runtime.inode =				\
 		INODE_FROM_ZVM_INODE((channels_if_p)->array.num_entries); \
 	    if ( (check) == EMU_CHANNELS ){				\
 		item->channel_runtime.emu = 1;				\
 	    }								\
+	    name_hash_insert( (channels_if_p), item->channel->name,	\
+			      (channels_if_p)->array.num_entries );	\
 	    DynArraySet( &(channels_if_p)->array,			\
 			 (channels_if_p)->array.num_entries, item );	\
 	    assert( res != 0 );						\
 	}								\
     }
 
+/*name hash table contains indexes of channels array items, an empty
+  slot is marked by NAME_HASH_EMPTY; table size is a power of two and
+  at least twice more than channels count, so probing sequence is
+  always short and never loops forever*/
+#define NAME_HASH_EMPTY -1
+#define NAME_HASH_MIN_SIZE 16
+
 
 struct ChannelsArray{
     //base, it is must be a first member
     struct ChannelsArrayPublicInterface public;
     /*private data*/
     struct DynArray array;
+    int*            name_hash;      /*open addressing table of indexes*/
+    uint32_t        name_hash_mask; /*table size minus one*/
 };
 
+/*FNV-1a string hash*/
+static uint32_t name_hash_function(const char* name){
+    uint32_t hash = 2166136261u;
+    while ( *name ){
+	hash ^= (uint8_t)*name++;
+	hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void name_hash_construct(struct ChannelsArray* this, int max_items_count){
+    uint32_t size = NAME_HASH_MIN_SIZE;
+    uint32_t i;
+    while ( size < (uint32_t)max_items_count*2 )
+	size <<= 1;
+    this->name_hash = malloc( size*sizeof(int) );
+    assert( this->name_hash != NULL );
+    for ( i=0; i < size; i++ )
+	this->name_hash[i] = NAME_HASH_EMPTY;
+    this->name_hash_mask = size-1;
+}
+
+static void name_hash_insert(struct ChannelsArray* this, const char* name, int index){
+    uint32_t slot = name_hash_function(name) & this->name_hash_mask;
+    while ( this->name_hash[slot] != NAME_HASH_EMPTY )
+	slot = (slot+1) & this->name_hash_mask;
+    this->name_hash[slot] = index;
+}
+
 
 
 int channels_array_count(struct ChannelsArray* this){
@@ -71,14 +113,16 @@ struct ChannelArrayItem* channels_array_get(struct ChannelsArray* this, int inde
 
 struct ChannelArrayItem* channels_array_match_by_name(struct ChannelsArray* this, 
 						      const char* channel_name ){
-    /* search for name through the channels list*/
-    int handle;
+    /* search for name through the name hash table, probing stops on
+       first empty slot*/
+    uint32_t slot = name_hash_function(channel_name) & this->name_hash_mask;
     struct ChannelArrayItem* item;
-    for(handle = 0; handle < this->array.num_entries; ++handle){
-	item = DynArrayGet(&this->array, handle);
+    while ( this->name_hash[slot] != NAME_HASH_EMPTY ){
+	item = DynArrayGet(&this->array, this->name_hash[slot]);
 	if( strcmp( item->channel->name, channel_name) == 0){
 	    return item; /*matched item*/
 	}
+	slot = (slot+1) & this->name_hash_mask;
     }
     
     return NULL; /* if channel name not matched return error*/
@@ -86,18 +130,17 @@ struct ChannelArrayItem* channels_array_match_by_name(struct ChannelsArray* this
 
 struct ChannelArrayItem* channels_array_match_by_inode(struct ChannelsArray* this, 
 						      int inode ){
-    /* search for inode through the channels list*/
-    int idx;
+    /* inodes are assigned sequentially by array index at construct
+       time, so inode directly addresses array item*/
+    int idx = ZVM_INODE_FROM_INODE(inode);
     struct ChannelArrayItem* item;
-    for(idx = 0; idx < this->array.num_entries; ++idx){
-	item = DynArrayGet(&this->array, idx);
-	ZRT_LOG( L_EXTRA, "inode=%d; name=%10s", 
-		 item->channel_runtime.inode, item->channel->name );
-	if( item->channel_runtime.inode == inode){
-	    return item; /*matched item*/
-	}
+    if ( idx < 0 || idx >= this->array.num_entries ) 
+	return NULL; /* if not matched return error*/
+
+    item = DynArrayGet(&this->array, idx);
+    if( item != NULL && item->channel_runtime.inode == inode){
+	return item; /*matched item*/
     }
-    
     return NULL; /* if not matched return error*/
 }
 
@@ -131,6 +174,7 @@ channels_array_construct( const struct ZVMChannel* zvm_channels,
     int res = DynArrayCtor( &this->array, 
 			   zvm_channels_count+emu_channels_count);
     assert( res != 0 );
+    name_hash_construct( this, zvm_channels_count+emu_channels_count );
 
     /*add zvm_channels*/
     ADD_CHANNELS (this, zvm_channels, zvm_channels_count, ZVM_CHANNELS);
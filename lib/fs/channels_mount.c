@@ -49,6 +49,7 @@
 #include "channels_mount.h"
 #include "channels_mount_magic_numbers.h"
 #include "channels_array.h"
+#include "file_data_source.h"
 
 enum PosAccess{ EPosSeek=0, EPosRead, EPosWrite };
 enum PosWhence{ EPosGet=0, EPosSetAbsolute, EPosSetRelative };
@@ -194,13 +195,20 @@ static int set_flock_data( struct MountSpecificImplem* this, int handle,
     return rc;
 }
 
+static int set_data_source( struct MountSpecificImplem* this, int handle, 
+			    const struct FileDataSource* source ){
+    SET_ERRNO(ENOSYS);
+    return -1;
+}
+
 static struct MountSpecificPublicInterface KMountSpecificImplem = {
     (void*)check_handle,
     (void*)handle_path,
     (void*)file_status_flags,
     (void*)set_file_status_flags,
     (void*)flock_data,
-    (void*)set_flock_data
+    (void*)set_flock_data,
+    (void*)set_data_source
 };
 
 static struct MountSpecificPublicInterface*
@@ -721,6 +729,225 @@ static int emu_handle_write(struct ChannelMounts* this,
 }
 
 
+/*Read-ahead is used only for channels with sequential read, data
+ *fetched from such channel can't be read again, so buffer is shared
+ *by all fds opened for channel. Random read channels are never
+ *buffered, so lseek has nothing to invalidate*/
+#define CHANNEL_READAHEAD_DEFAULT_SIZE 0x10000
+
+#define CHANNEL_READAHEAD_SIZE(item)					\
+    ((item)->channel_runtime.iobuffer_size < 0				\
+     ? CHANNEL_READAHEAD_DEFAULT_SIZE : (item)->channel_runtime.iobuffer_size)
+
+#define CHANNEL_READAHEAD_ENABLED(item)					\
+    ( ((item)->channel->type == SGetSPut || (item)->channel->type == SGetRPut) \
+      && !(item)->channel_runtime.emu && CHANNEL_READAHEAD_SIZE(item) > 0 )
+
+/*Read data from channel via read-ahead buffer; Data remaining in
+ *buffer is returned without reading channel, even if it's less than
+ *requested. Requests larger than buffer size are read directly into
+ *user buffer. Only single zvm_pread is issued per call, so it's never
+ *blocking on pipe waiting for data that was not requested.
+ *@return bytes read, or negative errno returned by zvm_pread*/
+static int32_t
+channel_readahead_read(struct ChannelArrayItem* item, char* buf, size_t nbyte, off_t offset){
+    struct ChannelIoBuffer* ra = &item->channel_runtime.readahead;
+    int32_t size = CHANNEL_READAHEAD_SIZE(item);
+    int zvm_inode = ZVM_INODE_FROM_INODE(item->channel_runtime.inode);
+    int32_t res;
+
+    if ( nbyte == 0 ) return 0;
+    /*use data remaining from previous fetch*/
+    if ( ra->pos < ra->len ){
+	res = ra->len - ra->pos;
+	if ( nbyte < (size_t)res ) res = nbyte;
+	memcpy(buf, ra->data+ra->pos, res);
+	ra->pos += res;
+	return res;
+    }
+
+    if ( nbyte >= (size_t)size ){
+	return zvm_pread(zvm_inode, buf, nbyte, offset);
+    }
+    /*buffer is empty here, reallocate it if size has been changed*/
+    if ( ra->data != NULL && ra->size != size ){
+	free(ra->data);
+	ra->data = NULL;
+    }
+    if ( ra->data == NULL && (ra->data = malloc(size)) != NULL )
+	ra->size = size;
+    if ( ra->data == NULL ){
+	/*no memory for buffer, then read unbuffered*/
+	return zvm_pread(zvm_inode, buf, nbyte, offset);
+    }
+
+    res = zvm_pread(zvm_inode, ra->data, size, offset);
+    ZRT_LOG(L_EXTRA, "channel=%s, read-ahead fetched=%d", CHANNEL_NAME(item), res );
+    ra->pos = 0;
+    ra->len = res > 0 ? res : 0;
+    if ( res > 0 ){
+	if ( nbyte < (size_t)res ) res = nbyte;
+	memcpy(buf, ra->data, res);
+	ra->pos = res;
+    }
+    return res;
+}
+
+/*release read-ahead buffer if it has no unread data*/
+static void channel_readahead_release_empty(struct ChannelArrayItem* item){
+    struct ChannelIoBuffer* ra = &item->channel_runtime.readahead;
+    if ( ra->pos >= ra->len ){
+	free(ra->data);
+	memset(ra, '\0', sizeof(*ra));
+    }
+}
+
+/*Write-behind is disabled by default and enabled for channel by
+ *setting its size in iobuffer nvram section. Only contiguous writes
+ *are coalesced, buffer is flushed before write to another position,
+ *before reading from channel, on fsync, close and by
+ *channels_flush_writebehind*/
+#define CHANNEL_WRITEBEHIND_SIZE(item)					\
+    ((item)->channel_runtime.iobuffer_size < 0 ? 0 : (item)->channel_runtime.iobuffer_size)
+
+/*buffer remaining data must be flushed even if buffering disabled*/
+#define CHANNEL_WRITEBEHIND_ENABLED(item)				\
+    ( !(item)->channel_runtime.emu					\
+      && ( CHANNEL_WRITEBEHIND_SIZE(item) > 0				\
+	   || (item)->channel_runtime.writebehind.len > 0 ) )
+
+/*@return 0 if all buffered data written, or negative errno*/
+static int32_t channel_writebehind_flush(struct ChannelArrayItem* item){
+    struct ChannelIoBuffer* wb = &item->channel_runtime.writebehind;
+    int zvm_inode = ZVM_INODE_FROM_INODE(item->channel_runtime.inode);
+    int32_t wrote = 0;
+    int32_t res = 0;
+
+    while ( wrote < wb->len ){
+	res = zvm_pwrite(zvm_inode, wb->data+wrote, wb->len-wrote, wb->offset+wrote);
+	++item->channel_runtime.write_traps;
+	if ( res <= 0 ) break;
+	wrote += res;
+    }
+    ZRT_LOG(L_EXTRA, "channel=%s, flushed=%d of %d", 
+	    CHANNEL_NAME(item), wrote, wb->len );
+    /*data that is not written is discarded anyway*/
+    wb->len = 0;
+    if ( res < 0 ) return res;
+    if ( res == 0 && wrote > 0 ) return -EIO;
+    return 0;
+}
+
+/*Write data into channel via write-behind buffer; Writes larger than
+ *buffer size are written directly.
+ *@return bytes written, or negative errno*/
+static int32_t
+channel_writebehind_write(struct ChannelArrayItem* item, const char* buf, size_t nbyte, off_t offset){
+    struct ChannelIoBuffer* wb = &item->channel_runtime.writebehind;
+    size_t size = CHANNEL_WRITEBEHIND_SIZE(item);
+    int32_t res;
+
+    ++item->channel_runtime.writes;
+    /*write can't be appended to buffered data, or will be written
+      directly and must follow buffered data*/
+    if ( wb->len > 0 
+	 && (offset != wb->offset+wb->len || wb->len+nbyte > (size_t)wb->size || nbyte >= size) ){
+	if ( (res=channel_writebehind_flush(item)) < 0 ) return res;
+    }
+
+    /*buffer is empty here, reallocate it if size has been changed*/
+    if ( wb->len == 0 && wb->data != NULL && (size_t)wb->size != size ){
+	free(wb->data);
+	wb->data = NULL;
+    }
+    if ( nbyte < size && wb->data == NULL && (wb->data = malloc(size)) != NULL )
+	wb->size = size;
+
+    if ( nbyte >= size || wb->data == NULL ){
+	++item->channel_runtime.write_traps;
+	return zvm_pwrite(ZVM_INODE_FROM_INODE(item->channel_runtime.inode), 
+			  buf, nbyte, offset );
+    }
+
+    if ( wb->len == 0 ) wb->offset = offset;
+    memcpy(wb->data+wb->len, buf, nbyte);
+    wb->len += nbyte;
+    return nbyte;
+}
+
+/*flush write-behind buffers of all channels*/
+int channels_flush_writebehind(struct MountsPublicInterface* channels_mount){
+    struct ChannelMounts* this = (struct ChannelMounts*)channels_mount;
+    int i;
+    int32_t res = 0;
+    for ( i=0; i < this->channels_array->count(this->channels_array); i++ ){
+	struct ChannelArrayItem* item = this->channels_array->get(this->channels_array, i);
+	if ( item != NULL && item->channel_runtime.writes > 0 ){
+	    int32_t flush_res = channel_writebehind_flush(item);
+	    if ( flush_res < 0 ) res = flush_res;
+	    ZRT_LOG(L_SHORT, "channel=%s, writes=%u, zvm_pwrite calls=%u, saved calls=%d",
+		    CHANNEL_NAME(item), item->channel_runtime.writes, 
+		    item->channel_runtime.write_traps,
+		    (int)(item->channel_runtime.writes - item->channel_runtime.write_traps) );
+	}
+    }
+    if ( res < 0 ){
+	SET_ERRNO(-res);
+	return -1;
+    }
+    return 0;
+}
+
+/*drop unread data of read-ahead buffers*/
+void channels_reset_readahead(struct MountsPublicInterface* channels_mount){
+    struct ChannelMounts* this = (struct ChannelMounts*)channels_mount;
+    int i;
+    for ( i=0; i < this->channels_array->count(this->channels_array); i++ ){
+	struct ChannelArrayItem* item = this->channels_array->get(this->channels_array, i);
+	if ( item != NULL ){
+	    item->channel_runtime.readahead.pos = item->channel_runtime.readahead.len;
+	    channel_readahead_release_empty(item);
+	}
+    }
+}
+
+/*read data of source channel, source fd is zvm channel handle*/
+static ssize_t channel_source_pread(const struct FileDataSource* source, 
+				    void *buf, size_t nbyte, off_t offset){
+    size_t readed = 0;
+    while ( readed < nbyte ){
+	int32_t res = zvm_pread(source->fd, (char*)buf+readed, nbyte-readed, 
+				source->offset+offset+readed);
+	if ( res <= 0 ) return -1;
+	readed += res;
+    }
+    return readed;
+}
+
+int channels_data_source(struct MountsPublicInterface* channels_mount, 
+			 const char* name, struct FileDataSource* source){
+    struct ChannelMounts* this = (struct ChannelMounts*)channels_mount;
+    struct ChannelArrayItem* item 
+	= this->channels_array->match_by_name(this->channels_array, name);
+    if ( item == NULL ){
+        SET_ERRNO( ENOENT );
+        return -1;
+    }
+    /*emulated channels has no zvm handle, data must be read randomly*/
+    if ( item->channel_runtime.emu || check_channel_flags(item->channel, O_RDONLY) != 0 ||
+	 (item->channel->type != RGetSPut && item->channel->type != RGetRPut) ){
+	ZRT_LOG(L_ERROR, "channel %s can't be used as data source", name );
+        SET_ERRNO( EACCES );
+        return -1;
+    }
+    source->pread = channel_source_pread;
+    source->mount = channels_mount;
+    source->fd = ZVM_INODE_FROM_INODE(item->channel_runtime.inode);
+    source->offset = 0;
+    source->size = item->channel->size;
+    return 0;
+}
+
 /*calculated synthetic size as maximum writable position for channels 
   with random access on write. For further calls: stat, fstat*/
 static void 
@@ -844,10 +1071,22 @@ channels_pread(struct MountsPublicInterface* this_, int fd, void *buf,
     /*check if file was not opened for reading*/
     CHECK_FILE_OPEN_FLAGS_OR_RAISE_ERROR(ofd->flags&O_ACCMODE, O_RDONLY, O_RDWR);
 
-    /*try to read from emulated channel, else read via zvm_pread call */
+    /*try to read from emulated channel, else read via read-ahead
+      buffer or via zvm_pread call */
     int handled=0;
-    if ( (readed=emu_handle_read(this, hentry->inode, buf, nbyte, &handled)) == -1 && !handled )
-	readed = zvm_pread( ZVM_INODE_FROM_INODE(hentry->inode), buf, nbyte, offset );
+    if ( (readed=emu_handle_read(this, hentry->inode, buf, nbyte, &handled)) == -1 && !handled ){
+	struct ChannelArrayItem* item = CHANNEL_ITEM_BY_INODE(this->channels_array, hentry->inode);
+	int32_t flushed = 0;
+	/*data written before must be visible for reading*/
+	if ( item != NULL && item->channel_runtime.writebehind.len > 0 )
+	    flushed = channel_writebehind_flush(item);
+	if ( flushed < 0 )
+	    readed = flushed;
+	else if ( item != NULL && CHANNEL_READAHEAD_ENABLED(item) )
+	    readed = channel_readahead_read(item, buf, nbyte, offset);
+	else
+	    readed = zvm_pread( ZVM_INODE_FROM_INODE(hentry->inode), buf, nbyte, offset );
+    }
     if(readed > 0) channel_pos(this, fd, EPosSetAbsolute, EPosRead, offset+readed);
     
     ZRT_LOG(L_EXTRA, "channel fd=%d, bytes readed=%d", fd, readed );
@@ -886,10 +1125,16 @@ channels_pwrite(struct MountsPublicInterface* this_,int fd, const void *buf,
     /*if file was not opened for writing, set errno and get error*/
     CHECK_FILE_OPEN_FLAGS_OR_RAISE_ERROR(ofd->flags&O_ACCMODE, O_WRONLY, O_RDWR);
 
-    /*try to read from emulated channel, else read via zvm_pread call */
+    /*try to write into emulated channel, else write via write-behind
+      buffer or via zvm_pwrite call */
     int handled=0;
-    if ( (wrote=emu_handle_write(this, hentry->inode, buf, nbyte, &handled)) == -1 && !handled )
-	wrote = zvm_pwrite(ZVM_INODE_FROM_INODE(hentry->inode), buf, nbyte, offset );
+    if ( (wrote=emu_handle_write(this, hentry->inode, buf, nbyte, &handled)) == -1 && !handled ){
+	item = CHANNEL_ITEM_BY_INODE(this->channels_array, hentry->inode);
+	if ( item != NULL && CHANNEL_WRITEBEHIND_ENABLED(item) )
+	    wrote = channel_writebehind_write(item, buf, nbyte, offset);
+	else
+	    wrote = zvm_pwrite(ZVM_INODE_FROM_INODE(hentry->inode), buf, nbyte, offset );
+    }
     if(wrote > 0) channel_pos(this, fd, EPosSetAbsolute, EPosWrite, offset+wrote);
     ZRT_LOG(L_EXTRA, "channel fd=%d, bytes wrote=%d", fd, wrote);
 
@@ -995,14 +1240,35 @@ static int channels_getdents(struct MountsPublicInterface* this_, int fd, void *
     return bytes_read;
 }
 
-static int channels_fsync(struct MountsPublicInterface* this,int fd){
-    SET_ERRNO(ENOSYS);
-    return -1;
+static int channels_fsync(struct MountsPublicInterface* this_,int fd){
+    struct ChannelMounts *this = (struct ChannelMounts *)this_;
+    struct ChannelArrayItem* item;
+    int32_t res;
+    errno = 0;
+
+    /*case: file not opened, bad descriptor*/
+    if ( this->handle_allocator->check_handle_is_related_to_filesystem(fd, &this->public) == -1 ){
+	SET_ERRNO( EBADF );
+	return -1;
+    }
+
+    item = CHANNEL_ITEM_BY_INODE(this->channels_array, this->handle_allocator->entry(fd)->inode);
+    if ( item == NULL ){
+	/*directory*/
+	SET_ERRNO(EINVAL);
+	return -1;
+    }
+    if ( (res=channel_writebehind_flush(item)) < 0 ){
+	SET_ERRNO(-res);
+	return -1;
+    }
+    return 0;
 }
 
 static int channels_close(struct MountsPublicInterface* this_,int fd){
     struct ChannelMounts *this = (struct ChannelMounts *)this_;
     const struct HandleItem* hentry;
+    int32_t flush_res = 0;
     errno = 0;
 
     /*case: file not opened, bad descriptor*/
@@ -1021,6 +1287,8 @@ static int channels_close(struct MountsPublicInterface* this_,int fd){
 	item->channel_runtime.maxsize = 0;
 #endif
 
+	channel_readahead_release_empty(item);
+	flush_res = channel_writebehind_flush(item);
 	ZRT_LOG(L_EXTRA, "closed channel=%s", CHANNEL_NAME( item ) );
     }
     else{ /*search fd in directories list*/
@@ -1032,6 +1300,11 @@ static int channels_close(struct MountsPublicInterface* this_,int fd){
     assert(res==0);
 
     this->handle_allocator->free_handle(fd);
+    /*descriptor is closed anyway, but buffered data was lost*/
+    if ( flush_res < 0 ){
+	SET_ERRNO(-flush_res);
+	return -1;
+    }
     return 0;
 }
 
@@ -1186,6 +1459,11 @@ static int channels_truncate_size(struct MountsPublicInterface* this,const char*
     return -1;
 }
 
+static int channels_fallocate_size(struct MountsPublicInterface* this,int fd, off_t length){
+    SET_ERRNO( ENOSYS );
+    return -1;
+}
+
 static int channels_isatty(struct MountsPublicInterface* this,int fd){
     SET_ERRNO( ENOSYS );
     return -1;
@@ -1270,6 +1548,7 @@ static struct MountsPublicInterface KChannels_mount = {
     channels_access,
     channels_ftruncate_size,
     channels_truncate_size,
+    channels_fallocate_size,
     channels_isatty,
     channels_dup,
     channels_dup2,
@@ -1296,12 +1575,25 @@ void mode_updater_set_channel_mode(struct ChannelsModeUpdaterPublicInterface* th
 	item->channel_runtime.mode = mode;
 }
 
+/*used by iobuffer nvram section for setting channel buffer size*/
+void mode_updater_set_channel_iobuffer_size(struct ChannelsModeUpdaterPublicInterface* this, 
+					    const char* channel_name,
+					    int size){
+    struct ChannelsModeUpdater* this_ = (struct ChannelsModeUpdater*)this;
+    struct ChannelMounts* mounts = (struct ChannelMounts*)this_->channels_mount;
+    struct ChannelArrayItem* item 
+	= mounts->channels_array->match_by_name(mounts->channels_array, channel_name);
+    if ( item != NULL )
+	item->channel_runtime.iobuffer_size = size;
+}
+
 
 
 struct ChannelsModeUpdaterPublicInterface*
 channel_mode_updater_construct(struct MountsPublicInterface* channels_mount){
     struct ChannelsModeUpdater* this = malloc(sizeof(struct ChannelsModeUpdater));
     this->public.set_channel_mode = mode_updater_set_channel_mode;
+    this->public.set_channel_iobuffer_size = mode_updater_set_channel_iobuffer_size;
     this->channels_mount = channels_mount;
 
     return (struct ChannelsModeUpdaterPublicInterface*)this;
@@ -35,12 +35,17 @@
 struct ZVMChannel;
 struct HandleAllocator;
 struct OpenFilesPool;
+struct FileDataSource;
 
 /*used by mapping nvram section for setting custom channel type*/
 struct ChannelsModeUpdaterPublicInterface{
     /*used by mapping nvram section for setting custom channel type*/
     void (*set_channel_mode)(struct ChannelsModeUpdaterPublicInterface* this_, 
 			     const char* channel_name, uint mode);
+    /*used by iobuffer nvram section for setting channel buffer size,
+     *0 disables buffering*/
+    void (*set_channel_iobuffer_size)(struct ChannelsModeUpdaterPublicInterface* this_, 
+				      const char* channel_name, int size);
 };
 
 /*@param mode_updater Create object and set provided pointer*/
@@ -51,6 +56,22 @@ channels_filesystem_construct ( struct ChannelsModeUpdaterPublicInterface** mode
 				const struct ZVMChannel* zvm_channels, int zvm_channels_count,
 				const struct ZVMChannel* emu_channels, int emu_channels_count);
 
+/*Drop data fetched by read-ahead from sequential channels, it's
+ *become stale if channels are changed by zvm_fork*/
+void channels_reset_readahead(struct MountsPublicInterface* channels_mount);
+
+/*Write data buffered by write-behind of all channels and log count of
+ *zvm_pwrite calls saved by buffering.
+ *@return 0 on success, -1 and errno if some of data can't be written*/
+int channels_flush_writebehind(struct MountsPublicInterface* channels_mount);
+
+/*Init source that reads channel data by zvm_pread directly, without
+ *file descriptor, so it's not visible to user and stays valid after
+ *close of user files. Channel must be readable with random access.
+ *@return 0 on success, -1 and errno if channel can't be used*/
+int channels_data_source(struct MountsPublicInterface* channels_mount, 
+			 const char* name, struct FileDataSource* source);
+
 struct ChannelsModeUpdaterPublicInterface*
 channel_mode_updater_construct(struct MountsPublicInterface* channels_mount);
 
@@ -0,0 +1,41 @@
+/*
+ * Read-only source of file data, used by lazy mounted images
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FILE_DATA_SOURCE_H__
+#define __FILE_DATA_SOURCE_H__
+
+#include <sys/types.h>
+
+struct MountsPublicInterface;
+
+/*File data located in another opened file, for example file data of
+ *tar archive located in channel. File of in-memory filesystem reads
+ *data from source until it is written, written data is copied into
+ *memory*/
+struct FileDataSource{
+    /*read nbyte of file data located at offset relative to the beginning
+     *of file data, @return count of bytes read or -1 on error*/
+    ssize_t (*pread)(const struct FileDataSource* this_, void *buf, size_t nbyte, off_t offset);
+    /*data*/
+    struct MountsPublicInterface* mount; /*mount of source file*/
+    int   fd;                            /*handle of source file, specific for source*/
+    off_t offset;                        /*position of file data in source file*/
+    off_t size;                          /*size of file data*/
+};
+
+#endif //__FILE_DATA_SOURCE_H__
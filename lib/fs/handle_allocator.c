@@ -22,6 +22,7 @@
 
 #include "zrtlog.h"
 #include "handle_allocator.h"
+#include "slots_bitmap.h"
 
 #define VERIFY_HANDLE(handle, state)					\
     ((handle<0 || handle>=MAX_HANDLES_COUNT)? 0 : (s_handle_slots[handle].used == state)) 
@@ -36,36 +37,24 @@ struct HandleItemInternal{
 
 
 
-static int s_first_unused_slot = 0;
+/*used slots, it is keeping lowest available handle semantic*/
+static struct SlotsBitmap s_used_slots;
 static struct HandleItemInternal s_handle_slots[MAX_HANDLES_COUNT];
 
-static int seek_unused_slot( int starting_from ){
-    int i;
-    starting_from = starting_from<0 ?0 :starting_from;
-    for ( i=starting_from; i < MAX_HANDLES_COUNT; i++ ){
-        if ( s_handle_slots[i].used == EHandleAvailable ){
-	    /*found closest unusable slot*/
-            ZRT_LOG( L_INFO, "slot index=%d, EHandleAvailable", i );
-            s_first_unused_slot = i;
-            return s_first_unused_slot;
-        }
-    }
-    return -1;
-}
-
-
 static int allocate_handle(struct MountsPublicInterface* mount_fs, 
 			   ino_t inode, 
 			   ino_t parent_dir_inode,
 			   int open_file_desc_id){
-    s_first_unused_slot = seek_unused_slot( s_first_unused_slot );
-    if ( s_first_unused_slot == -1 ) return -1;
-    s_handle_slots[s_first_unused_slot].used = EHandleUsed;
-    s_handle_slots[s_first_unused_slot].public_.mount_fs = mount_fs;
-    s_handle_slots[s_first_unused_slot].public_.open_file_description_id = open_file_desc_id;
-    s_handle_slots[s_first_unused_slot].public_.inode = inode;
-    s_handle_slots[s_first_unused_slot].public_.parent_dir_inode = parent_dir_inode;
-    return s_first_unused_slot;
+    int handle = slots_bitmap_lowest_free(&s_used_slots);
+    if ( handle == -1 ) return -1;
+    ZRT_LOG( L_INFO, "slot index=%d, EHandleAvailable", handle );
+    slots_bitmap_set_used(&s_used_slots, handle);
+    s_handle_slots[handle].used = EHandleUsed;
+    s_handle_slots[handle].public_.mount_fs = mount_fs;
+    s_handle_slots[handle].public_.open_file_description_id = open_file_desc_id;
+    s_handle_slots[handle].public_.inode = inode;
+    s_handle_slots[handle].public_.parent_dir_inode = parent_dir_inode;
+    return handle;
 }
 
 static int allocate_handle2(struct MountsPublicInterface* mount_fs, 
@@ -74,6 +63,7 @@ static int allocate_handle2(struct MountsPublicInterface* mount_fs,
 			    int open_file_desc_id, 
 			    int handle){
     if ( !VERIFY_HANDLE(handle, EHandleAvailable) ) return -1;
+    slots_bitmap_set_used(&s_used_slots, handle);
     s_handle_slots[handle].used = EHandleUsed;
     s_handle_slots[handle].public_.mount_fs = mount_fs;
     s_handle_slots[handle].public_.open_file_description_id = open_file_desc_id;
@@ -88,8 +78,7 @@ static int free_handle(int handle){
     s_handle_slots[handle].public_.mount_fs = NULL;
     s_handle_slots[handle].public_.open_file_description_id = 0;
     s_handle_slots[handle].public_.inode = 0;
-    /*set lowest available slot*/
-    if ( handle < s_first_unused_slot ) s_first_unused_slot = handle;
+    slots_bitmap_set_free(&s_used_slots, handle);
     return 0; //ok
 
 }
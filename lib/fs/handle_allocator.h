@@ -23,7 +23,7 @@
 
 #include "open_file_description.h" //const struct OpenFileDescription
 
-#define MAX_HANDLES_COUNT 1000
+#define MAX_HANDLES_COUNT 4096
 
 struct MountsPublicInterface;
 
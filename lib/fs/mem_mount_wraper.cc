@@ -27,6 +27,7 @@ extern "C" {
 #include "fcntl_implem.h"
 #include "channels_mount.h"
 #include "enum_strings.h"
+#include "zrtapi.h" /*SEEK_DATA, SEEK_HOLE*/
 }
 
 #define NODE_OBJECT_BYINODE(memount_p, inode) memount_p->ToMemNode(inode)
@@ -227,13 +228,39 @@ static int set_flock_data(struct MountSpecificPublicInterface* this_, int fd, co
     }
 }
 
+/*return 0 if success, -1 if fd didn't found or it's not a file*/
+static int set_data_source(struct MountSpecificPublicInterface* this_, int fd, 
+			   const struct FileDataSource* source ){
+    if ( HALLOCATOR_BY_MOUNT_SPECIF(this_)
+	 ->check_handle_is_related_to_filesystem(fd, 
+						 &((struct MountSpecificImplem*)this_)->mount->public_) == 0 ){
+	MemNode* mnode;	
+	const struct HandleItem* hentry;
+	hentry = HALLOCATOR_BY_MOUNT_SPECIF(this_)->entry(fd);
+
+    	mnode = NODE_OBJECT_BYINODE( MEMOUNT_BY_MOUNT_SPECIF(this_), hentry->inode);
+	assert(mnode);
+	if ( mnode->is_dir() ){
+	    SET_ERRNO(EISDIR);
+	    return -1;
+	}
+	mnode->SetDataSource(source);
+	return 0;
+    }
+    else{
+	SET_ERRNO(EBADF);
+	return -1;
+    }
+}
+
 static struct MountSpecificPublicInterface KMountSpecificImplem = {
     check_handle,
     path_handle,
     file_status_flags,
     set_file_status_flags,
     flock_data,
-    set_flock_data
+    set_flock_data,
+    set_data_source
 };
 
 
@@ -527,6 +554,23 @@ static off_t mem_lseek(struct MountsPublicInterface* this_, int fd, off_t offset
 		}
 		next = static_cast<size_t>(len) + offset;
 		break;
+	    case SEEK_DATA:
+	    case SEEK_HOLE:{
+		MemNode* node = NODE_OBJECT_BYINODE( MEMOUNT_BY_MOUNT(this_), hentry->inode);
+		assert(node);
+		/*offset beyond of file end is not allowed*/
+		if ( offset < 0 || offset >= static_cast<off_t>(node->len()) ){
+		    SET_ERRNO(ENXIO);
+		    return -1;
+		}
+		next = whence==SEEK_DATA? node->SeekData(offset): node->SeekHole(offset);
+		if ( next == -1 ){
+		    /*no more data up to the end of file*/
+		    SET_ERRNO(ENXIO);
+		    return -1;
+		}
+		break;
+	    }
 	    default:
 		SET_ERRNO(EINVAL);
 		return -1;
@@ -594,7 +638,7 @@ static int mem_open(struct MountsPublicInterface* this_, const char* path, int o
 		ZRT_LOG(L_SHORT, P_TEXT, "handle flag: O_TRUNC");
 		/*update stat*/
 		st.st_size = 0;
-		mnode->set_len(st.st_size);
+		mnode->Truncate(st.st_size);
 		ZRT_LOG(L_SHORT, "%s, %d", mnode->name().c_str(), mnode->len() );
 	    }
 	}
@@ -676,7 +720,7 @@ static int mem_ftruncate_size(struct MountsPublicInterface* this_, int fd, off_t
 		    return -1;
 		}
 		/*set file length on related node and update new length in stat*/
-		node->set_len(length);
+		node->Truncate(length);
 
 		/*in according to docs: if doing file size reduce then
 		  offset should not be changed, but on ubuntu linux
@@ -719,6 +763,37 @@ int mem_truncate_size(struct MountsPublicInterface* this_, const char* path, off
     return -1;
 }
 
+static int mem_fallocate_size(struct MountsPublicInterface* this_, int fd, off_t length){
+    if ( HALLOCATOR_BY_MOUNT(this_)->check_handle_is_related_to_filesystem(fd, this_) == 0 ){
+	const struct HandleItem* hentry = HALLOCATOR_BY_MOUNT(this_)->entry(fd);
+	const struct OpenFileDescription* ofd = HALLOCATOR_BY_MOUNT(this_)->ofd(fd);
+	assert(ofd);
+
+	MemNode* node; 
+	if ( is_dir(this_, hentry->inode) ||
+	     (node=NODE_OBJECT_BYINODE( MEMOUNT_BY_MOUNT(this_), hentry->inode )) == NULL ){
+	    SET_ERRNO(EBADF);
+	    return -1;
+	}
+	int flags = ofd->flags & O_ACCMODE;
+	/*check if file was not opened for writing*/
+	if ( flags!=O_WRONLY && flags!=O_RDWR ){
+	    SET_ERRNO( EBADF );
+	    return -1;
+	}
+	/*file length is not changed, only memory is allocated*/
+	if ( !node->Reserve(length) ){
+	    SET_ERRNO( ENOSPC );
+	    return -1;
+	}
+	return 0;
+    }
+    else{
+	SET_ERRNO(EBADF);
+	return -1;
+    }
+}
+
 static int mem_isatty(struct MountsPublicInterface* this_, int fd){
     return -1;
 }
@@ -773,6 +848,7 @@ static struct MountsPublicInterface KInMemoryMountWraper = {
     mem_access,
     mem_ftruncate_size,
     mem_truncate_size,
+    mem_fallocate_size,
     mem_isatty,
     mem_dup,
     mem_dup2,
@@ -27,6 +27,8 @@
 
 #include "zrt_defines.h" //CONSTRUCT_L
 
+struct FileDataSource;
+
 /*name of constructor*/
 #define MOUNT_SPECIFIC mount_specific_construct 
 
@@ -43,6 +45,12 @@ struct MountSpecificPublicInterface{
 
     const struct flock* (*flock_data)( struct MountSpecificPublicInterface* this_, int fd );
     int (*set_flock_data)( struct MountSpecificPublicInterface* this_, int fd, const struct flock* flock_data );
+
+    /*file data will be read from source instead of file contents, file
+     *length is set to source size; Only for filesystems that support it
+     *@return 0 if OK, -1 and errno on error*/
+    int (*set_data_source)( struct MountSpecificPublicInterface* this_, int fd, 
+			    const struct FileDataSource* source );
 };
 
 
@@ -86,6 +86,8 @@ struct MountsPublicInterface{
     int (*ftruncate_size)(struct MountsPublicInterface* this_,int fd, off_t length);
     //only reduces file size, not padding it; posix
     int (*truncate_size)(struct MountsPublicInterface* this_,const char* path, off_t length);
+    //reserves storage for file data up to length, file size is not changed
+    int (*fallocate_size)(struct MountsPublicInterface* this_,int fd, off_t length);
 
     int (*isatty)(struct MountsPublicInterface* this_,int fd);
     int (*dup)(struct MountsPublicInterface* this_,int oldfd);
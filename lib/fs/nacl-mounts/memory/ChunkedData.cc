@@ -0,0 +1,264 @@
+/*
+ * Chunked file data storage for MemNode
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ChunkedData.h"
+
+#define CHUNK_INDEX(offset) ((offset) / CHUNKED_DATA_CHUNK_SIZE)
+#define CHUNK_OFFSET(offset) ((offset) % CHUNKED_DATA_CHUNK_SIZE)
+
+ChunkedData::ChunkedData() : allocated_(0) {
+    memset(&source_, 0, sizeof(source_));
+}
+
+ChunkedData::~ChunkedData() {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        free(chunks_[i].data);
+    }
+}
+
+bool ChunkedData::EnsureChunk(size_t index, size_t end, bool will_be_overwritten) {
+    if (index >= chunks_.size()) {
+        Chunk hole = { NULL, 0 };
+        chunks_.resize(index+1, hole);
+    }
+    Chunk *chunk = &chunks_[index];
+    if (chunk->capacity >= end) {
+        return true;
+    }
+
+    size_t capacity;
+    if (index > 0) {
+        /*file is already large enough, use the whole chunk*/
+        capacity = CHUNKED_DATA_CHUNK_SIZE;
+    }
+    else {
+        capacity = chunk->capacity ? chunk->capacity : CHUNKED_DATA_MIN_ALLOC;
+        while (capacity < end) capacity *= 2;
+        if (capacity > CHUNKED_DATA_CHUNK_SIZE) capacity = CHUNKED_DATA_CHUNK_SIZE;
+    }
+
+    char *data;
+    if (chunk->data == NULL && will_be_overwritten && capacity == end) {
+        /*no need to zero memory that will be written completely*/
+        data = static_cast<char *>(malloc(capacity));
+    }
+    else {
+        data = static_cast<char *>(realloc(chunk->data, capacity));
+        if (data != NULL) {
+            memset(data+chunk->capacity, 0, capacity-chunk->capacity);
+        }
+    }
+    if (data == NULL) {
+        return false;
+    }
+    allocated_ += capacity - chunk->capacity;
+    chunk->data = data;
+    chunk->capacity = capacity;
+    return true;
+}
+
+bool ChunkedData::InSource(size_t index) const {
+    if (source_.pread == NULL ||
+        static_cast<off_t>(index) * CHUNKED_DATA_CHUNK_SIZE >= source_.size) {
+        return false;
+    }
+    return index >= chunks_.size() || chunks_[index].data == NULL;
+}
+
+bool ChunkedData::LoadChunk(size_t index) {
+    off_t start = static_cast<off_t>(index) * CHUNKED_DATA_CHUNK_SIZE;
+    size_t count = CHUNKED_DATA_CHUNK_SIZE;
+    if (source_.size - start < CHUNKED_DATA_CHUNK_SIZE) {
+        count = source_.size - start;
+    }
+    /*the first chunk keeps exact size as small files do*/
+    size_t capacity = index > 0 ? CHUNKED_DATA_CHUNK_SIZE : count;
+
+    char *data = static_cast<char *>(malloc(capacity));
+    if (data == NULL) {
+        return false;
+    }
+    if (source_.pread(&source_, data, count, start) != static_cast<ssize_t>(count)) {
+        free(data);
+        return false;
+    }
+    memset(data+count, 0, capacity-count);
+    if (index >= chunks_.size()) {
+        Chunk hole = { NULL, 0 };
+        chunks_.resize(index+1, hole);
+    }
+    chunks_[index].data = data;
+    chunks_[index].capacity = capacity;
+    allocated_ += capacity;
+    return true;
+}
+
+void ChunkedData::SetSource(const FileDataSource *source) {
+    if (source != NULL) {
+        source_ = *source;
+    }
+    else {
+        memset(&source_, 0, sizeof(source_));
+    }
+}
+
+bool ChunkedData::Read(off_t offset, void *buf, size_t count) const {
+    char *dest = static_cast<char *>(buf);
+    while (count > 0) {
+        size_t index = CHUNK_INDEX(offset);
+        size_t chunk_offset = CHUNK_OFFSET(offset);
+        size_t part = CHUNKED_DATA_CHUNK_SIZE - chunk_offset;
+        if (part > count) part = count;
+
+        size_t copied = 0;
+        if (index < chunks_.size() && chunk_offset < chunks_[index].capacity) {
+            copied = chunks_[index].capacity - chunk_offset;
+            if (copied > part) copied = part;
+            memcpy(dest, chunks_[index].data + chunk_offset, copied);
+        }
+        else if (InSource(index) && offset < source_.size) {
+            copied = part;
+            if (static_cast<off_t>(copied) > source_.size - offset) {
+                copied = source_.size - offset;
+            }
+            if (source_.pread(&source_, dest, copied, offset) != static_cast<ssize_t>(copied)) {
+                return false;
+            }
+        }
+        /*hole or not allocated tail of chunk*/
+        memset(dest+copied, 0, part-copied);
+
+        dest += part;
+        offset += part;
+        count -= part;
+    }
+    return true;
+}
+
+bool ChunkedData::Write(off_t offset, const void *buf, size_t count) {
+    const char *src = static_cast<const char *>(buf);
+    while (count > 0) {
+        size_t index = CHUNK_INDEX(offset);
+        size_t chunk_offset = CHUNK_OFFSET(offset);
+        size_t part = CHUNKED_DATA_CHUNK_SIZE - chunk_offset;
+        if (part > count) part = count;
+
+        /*copy source data into chunk before it's changed*/
+        if (InSource(index) && !LoadChunk(index)) {
+            return false;
+        }
+        if (!EnsureChunk(index, chunk_offset+part, chunk_offset == 0)) {
+            return false;
+        }
+        memcpy(chunks_[index].data + chunk_offset, src, part);
+
+        src += part;
+        offset += part;
+        count -= part;
+    }
+    return true;
+}
+
+void ChunkedData::Truncate(off_t len) {
+    size_t keep = CHUNK_INDEX(len + CHUNKED_DATA_CHUNK_SIZE - 1);
+    for (size_t i = keep; i < chunks_.size(); ++i) {
+        free(chunks_[i].data);
+        allocated_ -= chunks_[i].capacity;
+    }
+    if (keep < chunks_.size()) {
+        chunks_.resize(keep);
+    }
+    /*source data beyond len is not a file data anymore*/
+    if (source_.pread != NULL && source_.size > len) {
+        source_.size = len;
+    }
+    /*zero the tail of the last partial chunk*/
+    size_t chunk_offset = CHUNK_OFFSET(len);
+    if (chunk_offset > 0 && keep > 0 && keep <= chunks_.size()) {
+        Chunk *chunk = &chunks_[keep-1];
+        if (chunk_offset < chunk->capacity) {
+            memset(chunk->data + chunk_offset, 0, chunk->capacity - chunk_offset);
+        }
+    }
+}
+
+bool ChunkedData::Reserve(off_t len) {
+    /*chunk located in source is allocated by its first write, empty
+      chunk would hide source data*/
+    if (len <= 0 || InSource(0)) {
+        return true;
+    }
+    size_t capacity = len < CHUNKED_DATA_CHUNK_SIZE ? len : CHUNKED_DATA_CHUNK_SIZE;
+    if (chunks_.empty()) {
+        Chunk hole = { NULL, 0 };
+        chunks_.push_back(hole);
+    }
+    Chunk *chunk = &chunks_[0];
+    if (chunk->capacity >= capacity) {
+        return true;
+    }
+    char *data = static_cast<char *>(realloc(chunk->data, capacity));
+    if (data == NULL) {
+        return false;
+    }
+    memset(data+chunk->capacity, 0, capacity-chunk->capacity);
+    allocated_ += capacity - chunk->capacity;
+    chunk->data = data;
+    chunk->capacity = capacity;
+    return true;
+}
+
+size_t ChunkedData::DataChunksCount() const {
+    size_t count = chunks_.size();
+    if (source_.pread != NULL && source_.size > 0) {
+        size_t source_chunks = CHUNK_INDEX(source_.size - 1) + 1;
+        if (source_chunks > count) count = source_chunks;
+    }
+    return count;
+}
+
+bool ChunkedData::IsData(size_t index) const {
+    return (index < chunks_.size() && chunks_[index].data != NULL) || InSource(index);
+}
+
+off_t ChunkedData::SeekData(off_t offset, off_t len) const {
+    size_t count = DataChunksCount();
+    for (size_t index = CHUNK_INDEX(offset);
+         index < count && offset < len;
+         ++index, offset = static_cast<off_t>(index) * CHUNKED_DATA_CHUNK_SIZE) {
+        if (IsData(index)) {
+            return offset;
+        }
+    }
+    return -1;
+}
+
+off_t ChunkedData::SeekHole(off_t offset, off_t len) const {
+    size_t count = DataChunksCount();
+    for (size_t index = CHUNK_INDEX(offset);
+         index < count && offset < len;
+         ++index, offset = static_cast<off_t>(index) * CHUNKED_DATA_CHUNK_SIZE) {
+        if (!IsData(index)) {
+            return offset;
+        }
+    }
+    return offset < len ? offset : len;
+}
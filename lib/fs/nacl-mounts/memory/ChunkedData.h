@@ -0,0 +1,114 @@
+/*
+ * Chunked file data storage for MemNode
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CHUNKED_DATA_H__
+#define __CHUNKED_DATA_H__
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <vector>
+#include "../util/macros.h"
+#include "file_data_source.h"
+
+/*Size of single chunk of file data*/
+#define CHUNKED_DATA_CHUNK_SIZE 0x10000
+/*Initial allocation for the first chunk, small files growing in the
+  first chunk only*/
+#define CHUNKED_DATA_MIN_ALLOC 64
+
+// ChunkedData keeps file contents as a list of fixed size chunks, so
+// growing file never copies already written data, except of the first
+// chunk that grows by realloc up to the chunk size to keep small files
+// compact. Chunks that never been written are not allocated and read as
+// zeros, bytes of allocated chunks that never been written are zeros.
+// If data source is set then chunks that never been written are read
+// from source, and source data is copied into chunk on its first write.
+class ChunkedData {
+ public:
+  ChunkedData();
+  ~ChunkedData();
+
+  // Read() copies count bytes starting from offset into buf, holes
+  // are read as zeros. Caller is responsible to limit count by file
+  // length.
+  // @return false if data source read failed
+  bool Read(off_t offset, void *buf, size_t count) const;
+
+  // Write() copies count bytes from buf into storage starting from
+  // offset, allocating chunks if needed.
+  // @return false if memory allocation failed
+  bool Write(off_t offset, const void *buf, size_t count);
+
+  // Truncate() frees chunks located beyond len and zeroes the tail of
+  // the last chunk, so extending file later reads zeros there.
+  void Truncate(off_t len);
+
+  // Reserve() allocates the first chunk with exact capacity for data of
+  // length len, so small files are not grown by doubling. Other chunks
+  // are always allocated whole by Write(). Chunk located in source is
+  // not allocated, it gets exact capacity on its first write anyway.
+  // @return false if memory allocation failed
+  bool Reserve(off_t len);
+
+  // SeekData() returns position of the first data byte located at
+  // offset or after it and before len, or -1 if there is only a hole.
+  // Data is tracked with chunk granularity, source data is a data.
+  off_t SeekData(off_t offset, off_t len) const;
+
+  // SeekHole() returns position of the first hole byte located at
+  // offset or after it, the end of data at len is an implicit hole.
+  off_t SeekHole(off_t offset, off_t len) const;
+
+  // SetSource() sets source of data for chunks that never been
+  // written, NULL removes source. Existing chunks are not changed.
+  void SetSource(const FileDataSource *source);
+
+  // allocated() returns count of bytes allocated for chunks
+  size_t allocated() const { return allocated_; }
+
+ private:
+  struct Chunk {
+    char *data;
+    size_t capacity;
+  };
+
+  // EnsureChunk() allocates chunk or grows its capacity, so that it can
+  // hold bytes up to the end position inside of chunk.
+  bool EnsureChunk(size_t index, size_t end, bool will_be_overwritten);
+
+  // InSource() returns true if chunk is not allocated and its data is
+  // located in source.
+  bool InSource(size_t index) const;
+
+  // LoadChunk() allocates chunk and fills it by source data.
+  bool LoadChunk(size_t index);
+
+  // IsData() returns true if chunk is allocated or located in source.
+  bool IsData(size_t index) const;
+
+  // DataChunksCount() returns count of chunks that can hold data.
+  size_t DataChunksCount() const;
+
+  std::vector<Chunk> chunks_;
+  size_t allocated_;
+  FileDataSource source_;  // source_.pread is NULL if there is no source
+
+  DISALLOW_COPY_AND_ASSIGN(ChunkedData);
+};
+
+#endif  // __CHUNKED_DATA_H__
@@ -0,0 +1,75 @@
+/*
+ * Path to inode cache for MemMount
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DENTRY_CACHE_H__
+#define __DENTRY_CACHE_H__
+
+#include <stdint.h>
+#include <string>
+#include <tr1/unordered_map>
+#include "../util/macros.h"
+
+/*Maximum amount of cached paths, when exceeded cache is cleared*/
+#define DENTRY_CACHE_MAX_ENTRIES 0x4000
+
+// DentryCache keeps resolved full path to slot mapping, it saves
+// splitting of path into components and walking directories from the
+// root for every lookup. Only successfully resolved paths are cached,
+// so adding new nodes never makes cache stale, but any removal or
+// renaming of node must be followed by Clear().
+class DentryCache {
+ public:
+  DentryCache() : hits_(0), misses_(0) {}
+  ~DentryCache() {}
+
+  // Lookup() returns cached slot for path, or -1 if path is not cached.
+  int Lookup(const std::string& path) {
+    std::tr1::unordered_map<std::string, int>::const_iterator it =
+        paths_.find(path);
+    if (it == paths_.end()) {
+      ++misses_;
+      return -1;
+    }
+    ++hits_;
+    return it->second;
+  }
+
+  // Insert() saves resolved slot of path.
+  void Insert(const std::string& path, int slot) {
+    if (paths_.size() >= DENTRY_CACHE_MAX_ENTRIES) {
+      paths_.clear();
+    }
+    paths_[path] = slot;
+  }
+
+  // Clear() drops all cached paths, must be called if any node has been
+  // removed or renamed.
+  void Clear() { paths_.clear(); }
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  std::tr1::unordered_map<std::string, int> paths_;
+  uint64_t hits_;
+  uint64_t misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(DentryCache);
+};
+
+#endif  // __DENTRY_CACHE_H__
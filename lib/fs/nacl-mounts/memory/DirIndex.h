@@ -0,0 +1,126 @@
+/*
+ * Ordered hashed index of directory children for MemMount
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DIR_INDEX_H__
+#define __DIR_INDEX_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include "../util/macros.h"
+
+/*Removed entries count must exceed this value and also live entries
+  count before removed entries are compacted*/
+#define DIR_INDEX_COMPACT_THRESHOLD 64
+#define DIR_INDEX_EMPTY_ENTRY -1
+
+// DirIndex keeps children slots of directory in order of insertion.
+// Removed child leaves an empty entry instead of shifting the rest, so
+// position of entry is a stable cursor that is used as getdents offset.
+// Lookup by name and removal by slot are done via hash maps.
+class DirIndex {
+ public:
+  DirIndex() : live_count_(0) {}
+  ~DirIndex() {}
+
+  // Add() appends child into the end of directory.
+  void Add(int slot, const std::string& name) {
+    positions_[slot] = entries_.size();
+    entries_.push_back(slot);
+    names_[name] = slot;
+    ++live_count_;
+  }
+
+  // Remove() removes child with given slot, name is removed from names
+  // index only if it's still refers to this slot.
+  void Remove(int slot, const std::string& name) {
+    std::tr1::unordered_map<int, size_t>::iterator it = positions_.find(slot);
+    if (it == positions_.end()) {
+      return;
+    }
+    entries_[it->second] = DIR_INDEX_EMPTY_ENTRY;
+    positions_.erase(it);
+    --live_count_;
+    std::tr1::unordered_map<std::string, int>::iterator name_it =
+        names_.find(name);
+    if (name_it != names_.end() && name_it->second == slot) {
+      names_.erase(name_it);
+    }
+  }
+
+  // Hide() removes name from names index, but child is still kept in
+  // directory. Used for unlinked children that still opened.
+  void Hide(const std::string& name) { names_.erase(name); }
+
+  // Lookup() returns slot of child with given name, or -1.
+  int Lookup(const std::string& name) const {
+    std::tr1::unordered_map<std::string, int>::const_iterator it =
+        names_.find(name);
+    if (it == names_.end()) {
+      return -1;
+    }
+    return it->second;
+  }
+
+  // Compact() drops empty entries if there are too many of them. It
+  // changes positions of entries, so it must not be called while
+  // directory is opened and cursors are in use.
+  void Compact() {
+    size_t removed = entries_.size() - live_count_;
+    if (removed <= DIR_INDEX_COMPACT_THRESHOLD || removed <= live_count_) {
+      return;
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i] != DIR_INDEX_EMPTY_ENTRY) {
+        entries_[pos] = entries_[i];
+        positions_[entries_[pos]] = pos;
+        ++pos;
+      }
+    }
+    entries_.resize(pos);
+  }
+
+  void clear() {
+    entries_.clear();
+    positions_.clear();
+    names_.clear();
+    live_count_ = 0;
+  }
+
+  // size() returns count of children, including hidden.
+  size_t size() const { return live_count_; }
+
+  // end() returns cursor position next after the last entry.
+  size_t end() const { return entries_.size(); }
+
+  // at() returns child slot at cursor position, or
+  // DIR_INDEX_EMPTY_ENTRY if entry at cursor has been removed.
+  int at(size_t pos) const { return entries_[pos]; }
+
+ private:
+  std::vector<int> entries_;
+  std::tr1::unordered_map<int, size_t> positions_;
+  std::tr1::unordered_map<std::string, int> names_;
+  size_t live_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirIndex);
+};
+
+#endif  // __DIR_INDEX_H__
@@ -116,7 +116,7 @@ int MemMount::Creat(const std::string& path, mode_t mode, struct stat *buf, MemD
     Path p(path);
     child->set_name(p.Last());
     child->set_parent(parent_slot);
-    parent->AddChild(slot);
+    parent->AddChild(slot, child->name());
 
     if (!buf) {
         return 0;
@@ -167,7 +167,7 @@ int MemMount::Mkdir(const std::string& path, mode_t mode, struct stat *buf,
     Path p(path);
     child->set_name(p.Last());
     child->set_parent(parent_slot);
-    parent->AddChild(slot);
+    parent->AddChild(slot, child->name());
     parent->increment_nlink(); /*emulate of creating hardlink to parent directory*/
     errno=0;
     if (!buf) {
@@ -254,15 +254,18 @@ MemNode *MemMount::GetMemNode(std::string path) {
 
 int MemMount::GetSlot(std::string path) {
     int slot;
+    int child;
     std::list<std::string> path_components;
-    std::list<int>::iterator it;
-    std::list<int> *children;
 
     // Get in canonical form.
     if (path.length() == 0) {
         ZRT_LOG(L_ERROR, "path.length() %d", path.length());
         return -1;
     }
+    // Check if path already resolved
+    if ((slot = dentry_cache_.Lookup(path)) != -1) {
+        return slot;
+    }
     // Check if it is an absolute path
     Path p(path);
     path_components = p.path();
@@ -278,19 +281,14 @@ int MemMount::GetSlot(std::string path) {
             SET_ERRNO(ENOTDIR);
             return -1;
         }
-        // loop through children
-        children = slots_.At(slot)->children();
-        for (it = children->begin(); it != children->end(); ++it) {
-            if ((slots_.At(*it)->name()).compare(*path_it) == 0) {
-                break;
-            }
-        }
+        // lookup child by name
+        child = slots_.At(slot)->LookupChild(*path_it);
         // check for failure
-        if (it == children->end()) {
+        if (child == -1) {
 	    errno=ENOENT;
             return -1;
         } else {
-            slot = *it;
+            slot = child;
         }
     }
     // We should now have completed the walk.
@@ -298,6 +296,7 @@ int MemMount::GetSlot(std::string path) {
         ZRT_LOG(L_ERROR, "path_components.size() %d", path_components.size());
         return -1;
     }
+    dentry_cache_.Insert(path, slot);
     return slot;
 }
 
@@ -419,16 +418,20 @@ int MemMount::UnlinkInternal(MemNode *node) {
         return -1;
     }
 
+    /*any path resolved through removing node became stale*/
+    dentry_cache_.Clear();
+
     /*if file has no references or removing file already in removing state
       and must be deleted finally*/
     if ( !node->use_count() || node->UnlinkisTrying() ){
 	ZRT_LOG(L_SHORT, "file inode=%d UnlinkisTrying()=%d", inode, node->UnlinkisTrying() );
-	if ( parent ) parent->RemoveChild(inode);
+	if ( parent ) parent->RemoveChild(inode, node->name());
         slots_.Free(inode);
         ZRT_LOG(L_SHORT, "file inode=%d removed", inode);
     }
     else{
         /*set some wrong name, to do file unaccessible*/
+	if ( parent ) parent->HideChild(node->name());
         node->set_name("//some deleted file//");
         node->TryUnlink(); /*autotry to remove it at file close*/
     }
@@ -454,9 +457,10 @@ int MemMount::Rmdir(ino_t slot) {
       mark it as deleted */
     // Check if it's empty.
     if (node->children()->size() > 0) {
-	std::list<int>::iterator it;
-	for (it = node->children()->begin(); it != node->children()->end(); ++it) {
-	    MemNode *child = slots_.At(*it);
+	DirIndex *children = node->children();
+	for (size_t pos = 0; pos < children->end(); ++pos) {
+	    if ( children->at(pos) == DIR_INDEX_EMPTY_ENTRY ) continue;
+	    MemNode *child = slots_.At(children->at(pos));
 	    /*If any not deleted child in dir return error notempty*/
 	    if ( !child->UnlinkisTrying() ){
 		SET_ERRNO(ENOTEMPTY);
@@ -465,6 +469,8 @@ int MemMount::Rmdir(ino_t slot) {
 	}
     }
     ZRT_LOG(L_INFO, "node->name()=%s", node->name().c_str() );
+    /*any path resolved through removing directory became stale*/
+    dentry_cache_.Clear();
     parent = slots_.At(node->parent());
     parent->decrement_nlink(); /*emulate of removing hardlink to parent directory*/
 
@@ -472,7 +478,7 @@ int MemMount::Rmdir(ino_t slot) {
     // children list
 
     if (slot != 0) {
-        parent->RemoveChild(slot);
+        parent->RemoveChild(slot, node->name());
     }
 
     //Just release node instead using of Unref because it's 
@@ -499,9 +505,6 @@ void MemMount::Unref(ino_t slot) {
     if (node == NULL) {
         return;
     }
-    if (node->is_dir()) {
-        return;
-    }
     ZRT_LOG(L_INFO, "before inode=%d use_count=%d", node->slot(), node->use_count());
     node->decrement_use_count();
     ZRT_LOG(L_INFO, "after inode=%d use_count=%d", node->slot(), node->use_count());
@@ -518,36 +521,33 @@ int MemMount::Getdents(ino_t slot, off_t offset, off_t *newoffset, void *buf, un
         return -1;
     }
 
-    std::list<int> *children = node->children();
-    int pos;
+    DirIndex *children = node->children();
+    size_t pos;
     int bytes_read;
+    ssize_t ret;
 
-    pos = 0;
     bytes_read = 0;
     assert(children);
 
-    // Skip to the child at the current offset.
-    std::list<int>::iterator it;
-    for (it = children->begin(); it != children->end() && pos < offset; ++it) {
-        ++pos;
-    }
-
+    // Resume from the child at the current offset, offset is a
+    // position in directory index and stays valid across removals.
     struct stat st;
-    for (; it != children->end() &&
-	     bytes_read + sizeof(DIRENT) <= buf_size;
-	 ++it) {
-	MemNode *node = slots_.At(*it);
+    for (pos = offset; pos < children->end(); ++pos) {
+	if ( children->at(pos) == DIR_INDEX_EMPTY_ENTRY ) continue;
+	MemNode *node = slots_.At(children->at(pos));
 	/*unlinked file must not be available for filesystem*/
 	if ( node->UnlinkisTrying() ) continue;
 	node->stat(&st);
 	ZRT_LOG(L_SHORT, "getdents entity: %s", node->name().c_str());
 	/*format in buf dirent structure, of variable size, and save current file data;
 	  original MemMount implementation was used dirent as having constant size */
-	bytes_read += get_dirent_engine()
+	ret = get_dirent_engine()
 	    ->add_dirent_into_buf( ((char*)buf)+bytes_read, buf_size-bytes_read, 
 				   node->slot(), 0, st.st_mode,
 				   node->name().c_str() );
-        ++pos;
+	/*interrupt - insufficient buffer space*/
+	if ( ret <= 0 ) break;
+	bytes_read += ret;
     }
     *newoffset=pos;
     return bytes_read;
@@ -563,19 +563,17 @@ ssize_t MemMount::Read(ino_t slot, off_t offset, void *buf, size_t count) {
     }
 
     // Limit to the end of the file.
-    ssize_t len = count;
-    if (len > node->len() - offset) {
-        len = node->len() - offset;
-	if ( len < 0 ){
-	    len =0;
-	}
-	ZRT_LOG(L_SHORT,"To expensive count=%d limited to len=%d", 
-		count, len);
+    if (offset + static_cast<off_t>(count) > static_cast<off_t>(node->len())) {
+	ZRT_LOG(L_SHORT,"To expensive count=%d limited by file len=%d", 
+		count, node->len());
     }
 
-    // Do the read.
-    memcpy(buf, node->data() + offset, len);
-    return len;
+    // Do the read, holes are read as zeros.
+    ssize_t readed = node->ReadData(offset, buf, count);
+    if (readed == -1) {
+	SET_ERRNO(EIO);
+    }
+    return readed;
 }
 
 ssize_t MemMount::Write(ino_t slot, off_t offset, const void *buf,
@@ -586,26 +584,11 @@ ssize_t MemMount::Write(ino_t slot, off_t offset, const void *buf,
         return -1;
     }
 
-    size_t len = node->capacity();
-    // Grow the file if needed.
-    if (offset + static_cast<off_t>(count) > static_cast<off_t>(len)) {
-        len = offset + count;
-        size_t next = (node->capacity() + 1) * 2;
-        if (next > len) {
-            len = next;
-        }
-        node->ReallocData(len);
-    }
-    // Pad any gap with zeros.
-    if (offset > static_cast<off_t>(node->len())) {
-        memset(node->data()+node->len(), 0, offset-node->len());
-    }
-
-    // Write out the block.
-    memcpy(node->data() + offset, buf, count);
-    offset += count;
-    if (offset > static_cast<off_t>(node->len())) {
-        node->set_len(offset);
+    // Write out the block, file data grows by chunks and gap between
+    // file end and offset is not allocated.
+    if (node->WriteData(offset, buf, count) == -1) {
+	SET_ERRNO(ENOSPC);
+	return -1;
     }
     return count;
 }
@@ -41,6 +41,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 #include "../util/Path.h"
 #include "../util/SlotAllocator.h"
 #include "MemNode.h"
+#include "DentryCache.h"
 #include "nacl_struct.h"
 
 //#define DIRENT struct nacl_abi_dirent
@@ -104,6 +105,12 @@ class MemMount {
     return slots_.At(node);
   }
 
+  // Get hits and misses count of path lookups in dentry cache.
+  void DentryCacheStat(uint64_t *hits, uint64_t *misses) {
+    *hits = dentry_cache_.hits();
+    *misses = dentry_cache_.misses();
+  }
+
  private:
   // Creat() creates a node at path with the given mode and stores the
   // information of that node in st.  0 is returned if the node is
@@ -129,6 +136,9 @@ class MemMount {
 
   SlotAllocator<MemNode> slots_;
 
+  // Cache of resolved paths, must be cleared if node removed or renamed
+  DentryCache dentry_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(MemMount);
 };
 
@@ -16,15 +16,12 @@ extern "C" {
 #include "MemNode.h"
 
 MemData::~MemData(){
-    free(data_);
     children_.clear();
 }
 
 MemData::MemData() {
-    data_ = NULL;
     len_ = 0;
     is_dir_ = 0;
-    capacity_ = 0;
     use_count_ = 0;
     nlink_ = 1; /*new file/dir has 1 hardlink at creature time*/
     want_unlink_ = 0;
@@ -35,10 +32,12 @@ MemData::MemData() {
 }
 
 
-MemNode::MemNode() {
+MemNode::MemNode() : nodedata_(NULL) {
 }
 
 MemNode::~MemNode() {
+    /*unused slot of allocator has no data*/
+    if ( nodedata_ == NULL ) return;
     decrement_nlink();
     if ( !nlink_count() ){
 	//delete file data if no hardlinks
@@ -89,30 +88,89 @@ int MemNode::stat(struct stat *buf) {
     return 0;
 }
 
-void MemNode::AddChild(int child) {
+void MemNode::AddChild(int child, const std::string& name) {
     if (!is_dir()) {
         return;
     }
-    nodedata_->children_.push_back(child);
+    nodedata_->children_.Add(child, name);
 }
 
-void MemNode::RemoveChild(int child) {
+void MemNode::RemoveChild(int child, const std::string& name) {
     if (!is_dir()) {
         return;
     }
-    nodedata_->children_.remove(child);
+    nodedata_->children_.Remove(child, name);
+    /*positions of children are used as getdents cursors*/
+    if ( !use_count() ){
+	nodedata_->children_.Compact();
+    }
+}
+
+void MemNode::HideChild(const std::string& name) {
+    if (!is_dir()) {
+        return;
+    }
+    nodedata_->children_.Hide(name);
+}
+
+int MemNode::LookupChild(const std::string& name) {
+    if (!is_dir()) {
+        return -1;
+    }
+    return nodedata_->children_.Lookup(name);
 }
 
 //size_t to avoid int overflow on big files
-void MemNode::ReallocData(size_t len) {
-    assert(len > 0);
-    // TODO(arbenson): Handle memory overflow more gracefully.
-    nodedata_->data_ = reinterpret_cast<char *>(realloc(data(), len));
-    assert(nodedata_->data_);
-    set_capacity(len);
+ssize_t MemNode::ReadData(off_t offset, void *buf, size_t count) {
+    if (offset >= static_cast<off_t>(len())) {
+        return 0;
+    }
+    if (count > len() - offset) {
+        count = len() - offset;
+    }
+    if (!nodedata_->data_.Read(offset, buf, count)) {
+        return -1;
+    }
+    return count;
+}
+
+ssize_t MemNode::WriteData(off_t offset, const void *buf, size_t count) {
+    if (!nodedata_->data_.Write(offset, buf, count)) {
+        return -1;
+    }
+    offset += count;
+    if (offset > static_cast<off_t>(len())) {
+        set_len(offset);
+    }
+    return count;
+}
+
+void MemNode::Truncate(size_t len) {
+    if (len < this->len()) {
+        nodedata_->data_.Truncate(len);
+    }
+    set_len(len);
+}
+
+void MemNode::SetDataSource(const FileDataSource *source) {
+    Truncate(0);
+    nodedata_->data_.SetSource(source);
+    set_len(source != NULL ? source->size : 0);
+}
+
+bool MemNode::Reserve(size_t len) {
+    return nodedata_->data_.Reserve(len);
+}
+
+off_t MemNode::SeekData(off_t offset) {
+    return nodedata_->data_.SeekData(offset, len());
+}
+
+off_t MemNode::SeekHole(off_t offset) {
+    return nodedata_->data_.SeekHole(offset, len());
 }
 
-std::list<int> *MemNode::children() {
+DirIndex *MemNode::children() {
     if (is_dir()) {
         return &nodedata_->children_;
     } else {
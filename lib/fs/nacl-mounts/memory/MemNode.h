@@ -36,11 +36,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 #include <string.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <list>
 #include <string>
 
 #include "../util/macros.h"
 #include "../util/SlotAllocator.h"
+#include "DirIndex.h"
+#include "ChunkedData.h"
 
 class MemMount;
 
@@ -50,10 +51,9 @@ class MemData {
     MemData();
     ~MemData();
 
-    char *data_;
+    ChunkedData data_;
     size_t len_;
     bool is_dir_;
-    size_t capacity_;
     int use_count_; 
     int nlink_;      //nlink_ is hardlinks count
     int want_unlink_;//want_unlink_ flag indicates file waiting for remove if close
@@ -62,7 +62,7 @@ class MemData {
     uint32_t gid_;
     int hardinode_; //inode the same for all hardlinks
     struct flock flock_;
-    std::list<int> children_;
+    DirIndex children_;
 };
 
 // MemNode is the node object for the MemoryMount class
@@ -81,21 +81,58 @@ class MemNode {
     // Add child to this node's children.  This method will do nothing
     // if this node is a directory or if child points to a child that is
     // not in the children list of this node
-    void AddChild(int slot);
+    void AddChild(int slot, const std::string& name);
 
     // Remove child from this node's children.  This method will do
-    // nothing if the node is not a directory
-    void RemoveChild(int slot);
-
-    // Reallocate the size of data to be len bytes.  Copies the
-    // current data to the reallocated memory.
-    void ReallocData(size_t len);
-
-    // children() returns a list of MemNode pointers
+    // nothing if the node is not a directory. Removed entries are
+    // compacted only if directory is not opened.
+    void RemoveChild(int slot, const std::string& name);
+
+    // Remove child name from the children name index, but keep child
+    // in the children. Used for unlinked children that still opened.
+    void HideChild(const std::string& name);
+
+    // Return slot of child with given name, or -1 if this node is not a
+    // directory or has no such child
+    int LookupChild(const std::string& name);
+
+    // Copy count bytes of file data starting from offset into buf,
+    // bytes beyond of file length are not read.
+    // @return count of bytes read, or -1 if data source read failed
+    ssize_t ReadData(off_t offset, void *buf, size_t count);
+
+    // Write count bytes from buf into file data starting from offset,
+    // file length is extended if needed. Gap between old file length
+    // and offset is kept as a hole that reads as zeros.
+    // @return count, or -1 if memory allocation failed
+    ssize_t WriteData(off_t offset, const void *buf, size_t count);
+
+    // Set file length to len, data beyond of len is released. Growing
+    // file just adds a hole, no memory is allocated for it.
+    void Truncate(size_t len);
+
+    // Replace file contents by data located in source, file length is
+    // set to source size. Data is copied into memory only on write.
+    void SetDataSource(const FileDataSource *source);
+
+    // Allocate memory for file data up to len, to avoid growing of
+    // storage by following writes. File length is not changed, data
+    // located in source is not allocated.
+    // @return false if memory allocation failed
+    bool Reserve(size_t len);
+
+    // Return position of the first data byte at offset or after it, or
+    // -1 if file has no data there.
+    off_t SeekData(off_t offset);
+
+    // Return position of the first hole byte at offset or after it,
+    // file end is an implicit hole.
+    off_t SeekHole(off_t offset);
+
+    // children() returns an index of slots
     // which represent the children of this node.
-    // If this node is a file or a directory with no children,
-    // a NULL pointer is returned.
-    std::list<int> *children(void);
+    // If this node is a file, a NULL pointer is returned.
+    DirIndex *children(void);
 
     // set_name() sets the name of this node.  This is not the
     // path but rather the name of the file or directory
@@ -155,14 +192,9 @@ class MemNode {
     //returns the use count of this node
     int use_count(void) { return nodedata_->use_count_; }
 
-    // capacity() returns the capcity (in bytes) of this node
-    int capacity(void) { return nodedata_->capacity_; }
-
-    // set the capacity of this node to capacity bytes
-    void set_capacity(int capacity) { nodedata_->capacity_ = capacity; }
-
-    // data() returns a pointer to the data of this node
-    char *data(void) { return nodedata_->data_; }
+    // capacity() returns amount of memory (in bytes) allocated for
+    // the data of this node
+    size_t capacity(void) { return nodedata_->data_.allocated(); }
 
     // set_data() sets the length of this node to len
     void set_len(size_t len) { nodedata_->len_ = len; }
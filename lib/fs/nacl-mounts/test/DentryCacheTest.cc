@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include "gtest/gtest.h"
+#include "../memory/MemMount.h"
+
+TEST(DentryCacheTest, LookupAndClear) {
+  DentryCache cache;
+  EXPECT_EQ(-1, cache.Lookup("/a"));
+  cache.Insert("/a", 2);
+  EXPECT_EQ(2, cache.Lookup("/a"));
+  EXPECT_EQ(1U, cache.hits());
+  EXPECT_EQ(1U, cache.misses());
+  cache.Clear();
+  EXPECT_EQ(-1, cache.Lookup("/a"));
+  EXPECT_EQ(2U, cache.misses());
+}
+
+TEST(DentryCacheTest, MountLookups) {
+  MemMount *mount = new MemMount();
+  struct stat st;
+  uint64_t hits, misses, hits2, misses2;
+
+  EXPECT_EQ(0, mount->Mkdir("/a", 0755, NULL));
+  EXPECT_EQ(0, mount->Mkdir("/a/b", 0755, NULL));
+
+  // path is resolved by walk once, then found in cache only
+  EXPECT_EQ(0, mount->GetNode("/a/b", &st));
+  mount->DentryCacheStat(&hits, &misses);
+  EXPECT_EQ(0, mount->GetNode("/a/b", &st));
+  mount->DentryCacheStat(&hits2, &misses2);
+  EXPECT_LT(hits, hits2);
+  EXPECT_EQ(misses, misses2);
+
+  // removal clears cache, so removed path is not found, and other
+  // paths are resolved by walk again
+  EXPECT_EQ(0, mount->Rmdir(st.st_ino));
+  EXPECT_EQ(-1, mount->GetNode("/a/b", &st));
+  EXPECT_EQ(0, mount->GetNode("/a", &st));
+  mount->DentryCacheStat(&hits, &misses);
+  EXPECT_LT(misses2, misses);
+
+  delete mount;
+}
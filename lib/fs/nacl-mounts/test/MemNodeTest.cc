@@ -11,6 +11,7 @@
 MemNode *CreateMemNode(std::string name, int parent,
                        MemMount *mount, bool is_dir, int slot) {
   MemNode *node = new MemNode();
+  node->second_phase_construct(NULL);
   node->set_name(name);
   node->set_parent(parent);
   node->set_mount(mount);
@@ -19,6 +20,14 @@ MemNode *CreateMemNode(std::string name, int parent,
   return node;
 }
 
+static void AddChild(MemNode *parent, MemNode *child) {
+  parent->AddChild(child->slot(), child->name());
+}
+
+static void RemoveChild(MemNode *parent, MemNode *child) {
+  parent->RemoveChild(child->slot(), child->name());
+}
+
 
 TEST(MemNodeTest, AddChildren) {
   MemMount *mnt = new MemMount();
@@ -27,41 +36,29 @@ TEST(MemNodeTest, AddChildren) {
   MemNode *node3 = CreateMemNode("node3", node1->slot(), mnt, false, 3);
   MemNode *node4 = CreateMemNode("node4", node1->slot(), mnt, false, 4);
   MemNode *node5 = CreateMemNode("node5", node2->slot(), mnt, false, 5);
-  node1->AddChild(node2->slot());
-  node1->AddChild(node3->slot());
-  node1->AddChild(node4->slot());
-  node2->AddChild(node5->slot());
-
-  std::list<int> *children;
-  std::list<int> *children2;
-  std::list<int> *children3;
+  AddChild(node1, node2);
+  AddChild(node1, node3);
+  AddChild(node1, node4);
+  AddChild(node2, node5);
+
+  DirIndex *children;
   children = node1->children();
   EXPECT_EQ(3, static_cast<int>(children->size()));
-
-  std::list<int>::iterator it;
-  it = children->begin();
-  EXPECT_EQ(node2->slot(), *it);
-  children2 = node2->children();
-  EXPECT_EQ(1, static_cast<int>(children2->size()));
-
-  ++it;
-  EXPECT_EQ(node3->slot(), *it);
-  children3 = node3->children();
-  EXPECT_EQ(NULL, children3);
-
-  it = children2->begin();
-  EXPECT_EQ(node5->slot(), *it);
-  children2 = node5->children();
-  EXPECT_EQ(NULL, children2);
+  // children are kept in order of insertion and found by name
+  EXPECT_EQ(node2->slot(), children->at(0));
+  EXPECT_EQ(node3->slot(), children->at(1));
+  EXPECT_EQ(node4->slot(), node1->LookupChild("node4"));
+  EXPECT_EQ(-1, node1->LookupChild("node5"));
+  EXPECT_EQ(1, static_cast<int>(node2->children()->size()));
+  EXPECT_EQ(node5->slot(), node2->children()->at(0));
+  EXPECT_EQ(NULL, node3->children());
+  EXPECT_EQ(NULL, node5->children());
 
   // can't add children to non-directory
-  children = node4->children();
-  EXPECT_EQ(NULL, children);
-  node4->AddChild(0);
-  node4->AddChild(1);
-  node4->AddChild(2);
-  children = node4->children();
-  EXPECT_EQ(NULL, children);
+  node4->AddChild(0, "a");
+  node4->AddChild(1, "b");
+  EXPECT_EQ(NULL, node4->children());
+  EXPECT_EQ(-1, node4->LookupChild("a"));
 
   delete mnt;
   delete node1;
@@ -80,43 +77,43 @@ TEST(MemNodeTest, RemoveChildren) {
   MemNode *node5 = CreateMemNode("node5", node2->slot(), mnt, false, 5);
   MemNode *node6 = CreateMemNode("node6", node4->slot(), mnt, false, 6);
 
-  node1->AddChild(node2->slot());
-  node1->AddChild(node3->slot());
-  node1->AddChild(node4->slot());
-  node2->AddChild(node5->slot());
-
-  node1->RemoveChild(node2->slot());
-  node1->RemoveChild(node3->slot());
+  AddChild(node1, node2);
+  AddChild(node1, node3);
+  AddChild(node1, node4);
+  AddChild(node2, node5);
 
-  std::list<int> *children;
-  std::list<int>::iterator it;
+  RemoveChild(node1, node2);
+  RemoveChild(node1, node3);
 
+  DirIndex *children;
   children = node1->children();
   EXPECT_EQ(1, static_cast<int>(children->size()));
-  it = children->begin();
-  EXPECT_EQ(node4->slot(), *it);
+  // removed entries are kept as empty cursor positions
+  EXPECT_EQ(DIR_INDEX_EMPTY_ENTRY, children->at(0));
+  EXPECT_EQ(node4->slot(), children->at(2));
+  EXPECT_EQ(-1, node1->LookupChild("node2"));
 
-  node2->RemoveChild(node4->slot());
+  // removing not a child changes nothing
+  RemoveChild(node2, node4);
   children = node2->children();
   EXPECT_EQ(1, static_cast<int>(children->size()));
 
-  node2->RemoveChild(node5->slot());
+  RemoveChild(node2, node5);
   children = node2->children();
   EXPECT_EQ(0, static_cast<int>(children->size()));
 
   // can't remove child from non-directory
-  node4->AddChild(node6->slot());
+  AddChild(node4, node6);
   node4->set_is_dir(false);
-  node4->RemoveChild(node6->slot());
+  RemoveChild(node4, node6);
   children = node4->children();
   EXPECT_EQ(NULL, children);
   node4->set_is_dir(true);
-  node4->RemoveChild(node6->slot());
+  EXPECT_EQ(1, static_cast<int>(node4->children()->size()));
+  RemoveChild(node4, node6);
   children = node4->children();
   EXPECT_EQ(0, static_cast<int>(children->size()));
 
-  node4->set_is_dir(true);
-
   delete mnt;
   delete node1;
   delete node2;
@@ -128,13 +125,14 @@ TEST(MemNodeTest, RemoveChildren) {
 
 TEST(MemNodeTest, Stat) {
   MemMount *mnt = new MemMount();
-  struct stat *buf = (struct stat *)malloc(sizeof(struct stat));
+  struct stat st;
   MemNode *node1 = CreateMemNode("node", 0, mnt, false, 1);
-  int size = 128;
-  node1->ReallocData(size);
-  EXPECT_EQ(size, node1->capacity());
-  node1->stat(buf);
-  EXPECT_EQ(0, buf->st_size);
+  char data[128] = {0};
+  EXPECT_EQ(128, node1->WriteData(0, data, sizeof(data)));
+  EXPECT_EQ(128, node1->capacity());
+  node1->Truncate(0);
+  node1->stat(&st);
+  EXPECT_EQ(0, st.st_size);
   delete mnt;
   delete node1;
 }
@@ -145,11 +143,11 @@ TEST(MemNodeTest, UseCount) {
   int i;
 
   for (i = 0; i < 10; i++) {
-    node1->IncrementUseCount();
+    node1->increment_use_count();
   }
 
   for (i = 0; i < 8; i++) {
-    node1->DecrementUseCount();
+    node1->decrement_use_count();
   }
 
   EXPECT_EQ(2, node1->use_count());
@@ -158,16 +156,90 @@ TEST(MemNodeTest, UseCount) {
   delete node1;
 }
 
-TEST(MemNodeTest, ReallocData) {
+TEST(MemNodeTest, ChunkedData) {
   MemMount *mnt = new MemMount();
   MemNode *node1 = CreateMemNode("node1", 0, mnt, false, 1);
+  char buf[10];
+
+  EXPECT_EQ(10, node1->WriteData(0, "0123456789", 10));
+  EXPECT_EQ(CHUNKED_DATA_MIN_ALLOC, node1->capacity());
+  // write beyond of the end leaves unallocated hole
+  EXPECT_EQ(10, node1->WriteData(CHUNKED_DATA_CHUNK_SIZE*4, "0123456789", 10));
+  EXPECT_EQ(CHUNKED_DATA_CHUNK_SIZE*4+10, node1->len());
+  EXPECT_EQ(CHUNKED_DATA_MIN_ALLOC+CHUNKED_DATA_CHUNK_SIZE, node1->capacity());
+  EXPECT_EQ(10, node1->ReadData(CHUNKED_DATA_CHUNK_SIZE*2, buf, 10));
+  EXPECT_EQ(0, memcmp(buf, "\0\0\0\0\0\0\0\0\0\0", 10));
+  // truncate releases chunks and zeroes tail of the last one
+  node1->Truncate(5);
+  EXPECT_EQ(CHUNKED_DATA_MIN_ALLOC, node1->capacity());
+  node1->Truncate(10);
+  EXPECT_EQ(10, node1->ReadData(0, buf, 10));
+  EXPECT_EQ(0, memcmp(buf, "01234\0\0\0\0\0", 10));
+
+  delete mnt;
+  delete node1;
+}
+
+static const char kSourceData[] = "0123456789";
 
-  node1->ReallocData(10);
-  EXPECT_EQ(10, node1->capacity());
-  node1->ReallocData(5);
-  EXPECT_EQ(5, node1->capacity());
-  node1->ReallocData(400);
-  EXPECT_EQ(400, node1->capacity());
+static ssize_t SourcePread(const FileDataSource *source, void *buf,
+                           size_t count, off_t offset) {
+  memcpy(buf, kSourceData + source->offset + offset, count);
+  return count;
+}
+
+TEST(MemNodeTest, DataSource) {
+  MemMount *mnt = new MemMount();
+  MemNode *node1 = CreateMemNode("node1", 0, mnt, false, 1);
+  FileDataSource source = { SourcePread, NULL, -1, 2, 6 };
+  char buf[10];
+
+  // data is read from source without allocation
+  node1->SetDataSource(&source);
+  EXPECT_EQ(6, node1->len());
+  EXPECT_EQ(6, node1->ReadData(0, buf, 10));
+  EXPECT_EQ(0, memcmp(buf, "234567", 6));
+  EXPECT_EQ(0, node1->capacity());
+  // write copies source data
+  EXPECT_EQ(1, node1->WriteData(1, "x", 1));
+  EXPECT_EQ(6, node1->capacity());
+  EXPECT_EQ(6, node1->ReadData(0, buf, 10));
+  EXPECT_EQ(0, memcmp(buf, "2x4567", 6));
+
+  delete mnt;
+  delete node1;
+}
+
+TEST(MemNodeTest, Reserve) {
+  MemMount *mnt = new MemMount();
+  MemNode *node1 = CreateMemNode("node1", 0, mnt, false, 1);
+
+  // first chunk is allocated exactly, length is not changed
+  EXPECT_TRUE(node1->Reserve(1000));
+  EXPECT_EQ(1000, node1->capacity());
+  EXPECT_EQ(0, node1->len());
+  EXPECT_EQ(1000, node1->WriteData(0, std::string(1000, 'x').c_str(), 1000));
+  EXPECT_EQ(1000, node1->capacity());
+  // big file uses whole first chunk
+  EXPECT_TRUE(node1->Reserve(CHUNKED_DATA_CHUNK_SIZE*3));
+  EXPECT_EQ(CHUNKED_DATA_CHUNK_SIZE, node1->capacity());
+
+  delete mnt;
+  delete node1;
+}
+
+TEST(MemNodeTest, ReserveDataSource) {
+  MemMount *mnt = new MemMount();
+  MemNode *node1 = CreateMemNode("node1", 0, mnt, false, 1);
+  FileDataSource source = { SourcePread, NULL, -1, 2, 6 };
+  char buf[10];
+
+  // data located in source is not allocated and still read from source
+  node1->SetDataSource(&source);
+  EXPECT_TRUE(node1->Reserve(1000));
+  EXPECT_EQ(0, node1->capacity());
+  EXPECT_EQ(6, node1->ReadData(0, buf, 10));
+  EXPECT_EQ(0, memcmp(buf, "234567", 6));
 
   delete mnt;
   delete node1;
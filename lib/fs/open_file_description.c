@@ -17,6 +17,7 @@
 
 #include "open_file_description.h"
 #include "handle_allocator.h" //MAX_HANDLES_COUNT
+#include "slots_bitmap.h"
 
 
 #define VERIFY_OFD(id)							\
@@ -29,30 +30,19 @@ struct OpenFileDescInternal{
     int refcount;
 };
 
-static int s_first_unused_slot=0;
+/*used slots, lowest available is always allocated*/
+static struct SlotsBitmap s_used_slots;
 static struct OpenFileDescInternal s_open_files_array[MAX_HANDLES_COUNT];
 
-static int seek_unused_slot( int starting_from ){
-    int i;
-    starting_from = starting_from<0 ?0 :starting_from;
-    for ( i=starting_from; i < MAX_HANDLES_COUNT; i++ ){
-        if ( s_open_files_array[i].refcount == 0 ){
-            s_first_unused_slot = i;
-            return s_first_unused_slot;
-        }
-    }
-    return -1;
-}
-
-
 static int getnew_ofd(int flags){
-    s_first_unused_slot = seek_unused_slot( s_first_unused_slot );
-    if ( s_first_unused_slot == -1 ) return -1;
-    ++s_open_files_array[s_first_unused_slot].refcount;
-    s_open_files_array[s_first_unused_slot].public_.offset=0;
-    s_open_files_array[s_first_unused_slot].public_.channel_sequential_offset=0;
-    s_open_files_array[s_first_unused_slot].public_.flags=flags;
-    return s_first_unused_slot;
+    int id_ofd = slots_bitmap_lowest_free(&s_used_slots);
+    if ( id_ofd == -1 ) return -1;
+    slots_bitmap_set_used(&s_used_slots, id_ofd);
+    ++s_open_files_array[id_ofd].refcount;
+    s_open_files_array[id_ofd].public_.offset=0;
+    s_open_files_array[id_ofd].public_.channel_sequential_offset=0;
+    s_open_files_array[id_ofd].public_.flags=flags;
+    return id_ofd;
 }
 
 
@@ -65,8 +55,7 @@ static int refer_ofd(int id_ofd){
 static int release_ofd(int id_ofd){
     if ( !VERIFY_OFD(id_ofd) ) return -1;
     if ( !--s_open_files_array[id_ofd].refcount ){
-	/*set lowest available slot*/
-	if ( id_ofd < s_first_unused_slot ) s_first_unused_slot = id_ofd;
+	slots_bitmap_set_free(&s_used_slots, id_ofd);
     }
     return 0;
 }
@@ -0,0 +1,66 @@
+/*
+ * Two level bitmap of used slots, finds the lowest free slot in O(1)
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SLOTS_BITMAP_H__
+#define __SLOTS_BITMAP_H__
+
+#include <stdint.h>
+
+#include "handle_allocator.h" //MAX_HANDLES_COUNT
+
+#define SLOTS_BITMAP_WORD_BITS 64
+#define SLOTS_BITMAP_WORDS \
+    ((MAX_HANDLES_COUNT+SLOTS_BITMAP_WORD_BITS-1)/SLOTS_BITMAP_WORD_BITS)
+
+/*summary level is a single word*/
+#if SLOTS_BITMAP_WORDS > SLOTS_BITMAP_WORD_BITS
+#  error "MAX_HANDLES_COUNT is too big for slots bitmap"
+#endif
+
+/*Bit is set for used slot; bit of full_words is set if all slots of
+ *related word are used. Zero initialized bitmap has all slots free*/
+struct SlotsBitmap{
+    uint64_t words[SLOTS_BITMAP_WORDS];
+    uint64_t full_words;
+};
+
+/*@return lowest free slot index, or -1 if all slots are used*/
+static inline int slots_bitmap_lowest_free(const struct SlotsBitmap* bitmap){
+    uint64_t not_full = ~bitmap->full_words;
+    int word, index;
+    if ( not_full == 0 ) return -1;
+    word = __builtin_ctzll(not_full);
+    if ( word >= SLOTS_BITMAP_WORDS ) return -1;
+    index = word*SLOTS_BITMAP_WORD_BITS + __builtin_ctzll(~bitmap->words[word]);
+    return index < MAX_HANDLES_COUNT ? index : -1;
+}
+
+static inline void slots_bitmap_set_used(struct SlotsBitmap* bitmap, int index){
+    int word = index/SLOTS_BITMAP_WORD_BITS;
+    bitmap->words[word] |= 1ULL << (index%SLOTS_BITMAP_WORD_BITS);
+    if ( bitmap->words[word] == ~0ULL )
+	bitmap->full_words |= 1ULL << word;
+}
+
+static inline void slots_bitmap_set_free(struct SlotsBitmap* bitmap, int index){
+    int word = index/SLOTS_BITMAP_WORD_BITS;
+    bitmap->words[word] &= ~(1ULL << (index%SLOTS_BITMAP_WORD_BITS));
+    bitmap->full_words &= ~(1ULL << word);
+}
+
+#endif //__SLOTS_BITMAP_H__
@@ -460,6 +460,17 @@ static int transparent_truncate_size(struct MountsPublicInterface *this,
     }
 }
 
+static int transparent_fallocate_size(struct MountsPublicInterface *this,
+				      int fd, off_t length){
+    struct MountsPublicInterface* mount = s_mounts_manager->mount_byhandle(fd);
+    if ( mount )
+	return mount->fallocate_size( mount, fd, length );
+    else{
+	SET_ERRNO( EBADF );
+        return -1;
+    }
+}
+
 
 static int transparent_isatty(struct MountsPublicInterface *this, int fd){
     struct MountsPublicInterface* mount = s_mounts_manager->mount_byhandle(fd);
@@ -600,6 +611,7 @@ static struct MountsPublicInterface s_transparent_mount = {
         transparent_access,
 	transparent_ftruncate_size,
 	transparent_truncate_size,
+	transparent_fallocate_size,
         transparent_isatty,
         transparent_dup,
         transparent_dup2,
@@ -17,6 +17,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -25,23 +26,34 @@
 #include <assert.h>
 
 #include "zrtlog.h"
+#include "zrt_helper_macros.h"
 #include "unpack_interface.h"
 #include "mounts_reader.h"
 #include "parse_path.h"
 #include "mounts_interface.h"
+#include "mounts_manager.h"
+#include "mount_specific_interface.h"
+#include "file_data_source.h"
 #include "image_engine.h"
 #include "enum_strings.h"
 
-static char block[512];
-static struct ParsePathObserver s_path_observer;
+#define TAR_BLOCK_SIZE 512
+/*Archive data is copied into file by pieces of this size, it's aligned
+ *to tar block and equal to chunk size of in-memory filesystem, so that
+ *every chunk of file is allocated at once by single write*/
+#define BULK_COPY_SIZE (64*1024)
+#define ROUND_UP_TO_TAR_BLOCK(size) (((size)+TAR_BLOCK_SIZE-1)/TAR_BLOCK_SIZE*TAR_BLOCK_SIZE)
 
-#define WRITE_DATA_INTO_FS_IN_MEMORY( mounts_p, wrote_p, err_p, out_fd, data, datasize )	\
-    *wrote_p = (mounts_p)->write(mounts_p,out_fd, block, datasize );		\
-    if ( *wrote_p < datasize ){						\
-	*err_p=1;							\
-	ZRT_LOG(L_ERROR, "block write error, wrote %d instead %d bytes", \
-		*wrote_p, datasize );					\
-    }
+static char s_bulk_buffer[BULK_COPY_SIZE];
+static struct ParsePathObserver s_path_observer;
+static long long s_deployed_bytes;
+/*totals of all deployed images*/
+static long long s_total_deployed_bytes;
+static long long s_total_deploy_msec;
+static int s_images_count;
+/*source of file data for on demand mount, offset and size are set
+ *for every file*/
+static struct FileDataSource s_lazy_source;
 
 
 //////////////////////////// parse path callback implementation //////////////////////////////
@@ -56,9 +68,12 @@ static void callback_parse(struct ParsePathObserver* this_p, const char *path, i
 
 //////////////////////////// unpack observer implementation //////////////////////////////
 
-/*unpack observer 1st parameter : main unpack interface that gives access to observer, mounts and mounted fs*/
-static int extract_entry( struct UnpackInterface* unpacker, 
-			  TypeFlag type, const char* name, int entry_size ){
+/*Create directories of entry path, and entry itself if it's a
+ *directory, or open new file for file entry
+ *@param out_fd opened file descriptor for file entry, -1 for directory
+ *@return 0 if OK, -1 on error*/
+static int create_entry( struct UnpackInterface* unpacker, 
+			 TypeFlag type, const char* name, int entry_size, int* out_fd ){
     /*parse path and create directories recursively*/
     ZRT_LOG( L_INFO, "type=%s, name=%s, entry_size=%d", 
 	     STR_ARCH_ENTRY_TYPE(type), name, entry_size );
@@ -72,52 +87,107 @@ static int extract_entry( struct UnpackInterface* unpacker,
     int parsed_dir_count = parse_path( &s_path_observer, name );
     ZRT_LOG(L_INFO, "parsed_dir_count=%d", parsed_dir_count );
 
+    *out_fd = -1;
     if ( type == ETypeDir ){
 	create_dir_and_cache_name(name, strlen(name));
     }
     else{
 	/*Create new file, truncate it if exist*/
-	int out_fd = unpacker->observer->mounts->open( unpacker->observer->mounts,
-						       name, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
-	if (out_fd < 0) {
+	*out_fd = unpacker->observer->mounts->open( unpacker->observer->mounts,
+						    name, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+	if (*out_fd < 0) {
 	    ZRT_LOG( L_ERROR, "create new file error, name=%s", name );
 	    return -1;
 	}
+    }
+    return 0;
+}
+
+/*copy file data from archive into opened file and close it*/
+static int copy_entry_data( struct UnpackInterface* unpacker, 
+			    const char* name, int entry_size, int out_fd ){
+    ZRT_LOG(L_SHORT, "save %7d B : %s", entry_size, name);
+    struct MountsPublicInterface* mounts = unpacker->observer->mounts;
+    /*allocate file storage using size from archive header, it's
+      only optimization and failure is not an error*/
+    if ( entry_size > 0 )
+	mounts->fallocate_size(mounts, out_fd, entry_size);
 
-	ZRT_LOG(L_SHORT, "save %7d B : %s", entry_size, name);
-	int write_err = 0;
-        /*read file by blocks*/
-        while (entry_size > 0) {
-            int len = (*unpacker->mounts_reader->read)( unpacker->mounts_reader,
-							block, sizeof(block) );
-            if (len != sizeof(block)) {
-		ZRT_LOG(L_ERROR, "read error. saving failed=%s", name);
-                return -1;
-            }
-	    int wrote;
-            if (entry_size > sizeof(block)) {
-		WRITE_DATA_INTO_FS_IN_MEMORY( unpacker->observer->mounts,
-					      &wrote, &write_err, out_fd, block, sizeof(block) );
-            } else {
-		WRITE_DATA_INTO_FS_IN_MEMORY( unpacker->observer->mounts,
-					      &wrote, &write_err, out_fd, block, entry_size );
-            }
-	    if ( write_err ){
-		return -1;
-	    }
-            entry_size -= sizeof(block);
-        }
-	unpacker->observer->mounts->close(unpacker->observer->mounts,
-					  out_fd);
+    /*read file data padded to tar block by large pieces and write
+      them without padding*/
+    while (entry_size > 0) {
+	int toread = MIN( ROUND_UP_TO_TAR_BLOCK(entry_size), BULK_COPY_SIZE );
+	int towrite = MIN( entry_size, toread );
+	int len = (*unpacker->mounts_reader->read)( unpacker->mounts_reader,
+						    s_bulk_buffer, toread );
+	if (len != toread) {
+	    ZRT_LOG(L_ERROR, "read error. saving failed=%s", name);
+	    mounts->close(mounts, out_fd);
+	    return -1;
+	}
+	int wrote = mounts->write(mounts, out_fd, s_bulk_buffer, towrite );
+	if ( wrote < towrite ){
+	    ZRT_LOG(L_ERROR, "block write error, wrote %d instead %d bytes", 
+		    wrote, towrite );
+	    mounts->close(mounts, out_fd);
+	    return -1;
+	}
+	s_deployed_bytes += wrote;
+	entry_size -= towrite;
     }
+    mounts->close(mounts, out_fd);
+    return 0;
+}
+
+/*unpack observer 1st parameter : main unpack interface that gives access to observer, mounts and mounted fs*/
+static int extract_entry( struct UnpackInterface* unpacker, 
+			  TypeFlag type, const char* name, int entry_size ){
+    int out_fd;
+    if ( create_entry(unpacker, type, name, entry_size, &out_fd) != 0 )
+	return -1;
+    if ( out_fd >= 0 )
+	return copy_entry_data(unpacker, name, entry_size, out_fd);
     return 0;
 }
 
+/*unpack observer for on demand mount: file data is not copied, file
+  reads data from channel until it's written*/
+static int index_entry( struct UnpackInterface* unpacker, 
+			TypeFlag type, const char* name, int entry_size ){
+    int out_fd;
+    if ( create_entry(unpacker, type, name, entry_size, &out_fd) != 0 )
+	return -1;
+    if ( out_fd < 0 || entry_size == 0 ){
+	if ( out_fd >= 0 ) 
+	    unpacker->observer->mounts->close(unpacker->observer->mounts, out_fd);
+	return 0;
+    }
+
+    struct FileDataSource source = s_lazy_source;
+    source.offset += unpacker->mounts_reader->position;
+    source.size = entry_size;
+    struct MountsPublicInterface* mount = get_mounts_manager()->mount_byhandle(out_fd);
+    if ( mount != NULL && 
+	 mount->implem(mount)->set_data_source(mount->implem(mount), out_fd, &source) == 0 ){
+	ZRT_LOG(L_SHORT, "index %7d B : %s", entry_size, name);
+	unpacker->observer->mounts->close(unpacker->observer->mounts, out_fd);
+	return unpacker->mounts_reader->skip( unpacker->mounts_reader, 
+					      ROUND_UP_TO_TAR_BLOCK(entry_size) );
+    }
+    /*filesystem can't read data from source, copy it*/
+    return copy_entry_data(unpacker, name, entry_size, out_fd);
+}
+
 static struct UnpackObserver s_unpack_observer = {
         extract_entry,
         NULL
 };
 
+static struct UnpackObserver s_lazy_unpack_observer = {
+        index_entry,
+        NULL
+};
+
 static int deploy_image( const char* mount_path, struct UnpackInterface* unpacker ){
     assert(unpacker);
     ZRT_LOG(L_SHORT, "mount_path=%s", mount_path );
@@ -135,8 +205,22 @@ static int deploy_image( const char* mount_path, struct UnpackInterface* unpacke
 	ZRT_LOG(L_ERROR, "Mountpoint %s is not a directory", mount_path );
 	return -1;
     }
-    else
-	return unpacker->unpack( unpacker, mount_path );
+    else{
+	struct timeval start, end;
+	int res;
+	s_deployed_bytes = 0;
+	gettimeofday(&start, NULL);
+	res = unpacker->unpack( unpacker, mount_path );
+	gettimeofday(&end, NULL);
+	/*deploy time of image, to estimate startup cost of big images*/
+	long long msec = (end.tv_sec-start.tv_sec)*1000LL + (end.tv_usec-start.tv_usec)/1000;
+	ZRT_LOG(L_SHORT, "image deployed into %s: %lld bytes in %lld ms", 
+		mount_path, s_deployed_bytes, msec );
+	s_total_deployed_bytes += s_deployed_bytes;
+	s_total_deploy_msec += msec;
+	++s_images_count;
+	return res;
+    }
 }
 
 //////////////////////////// image engine implementation //////////////////////////////
@@ -150,9 +234,25 @@ struct ImageInterface* alloc_image_loader( struct MountsPublicInterface* mounts
     return image_engine;
 }
 
+struct ImageInterface* alloc_lazy_image_loader( struct MountsPublicInterface* mounts,
+					       const struct FileDataSource* source ){
+    struct ImageInterface* image_engine = alloc_image_loader(mounts);
+    image_engine->observer_implementation = &s_lazy_unpack_observer;
+    image_engine->observer_implementation->mounts = mounts;
+    s_lazy_source = *source;
+    return image_engine;
+}
+
 void free_image_loader( struct ImageInterface* image_engine ){
     free( image_engine );
 }
 
+void get_image_deploy_stat( long long* deployed_bytes, long long* deploy_msec,
+			    int* images_count ){
+    *deployed_bytes = s_total_deployed_bytes;
+    *deploy_msec = s_total_deploy_msec;
+    *images_count = s_images_count;
+}
+
 
 
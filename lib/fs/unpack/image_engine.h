@@ -20,6 +20,7 @@
 
 struct UnpackInterface;
 struct UnpackObserver;
+struct FileDataSource;
 
 struct ImageInterface{
     /*return files count*/
@@ -32,6 +33,17 @@ struct ImageInterface{
 
 struct ImageInterface* alloc_image_loader( struct MountsPublicInterface* );
 
+/*Image loader that only reads archive headers, data of files is read
+ *from source at archive offsets and it's copied into memory on write.
+ *Source must stay valid while files are in use*/
+struct ImageInterface* alloc_lazy_image_loader( struct MountsPublicInterface* mounts,
+					       const struct FileDataSource* source );
+
 void free_image_loader( struct ImageInterface* );
 
+/*Get totals of all images deployed by image loaders, to report them by
+ *zimagestat*/
+void get_image_deploy_stat( long long* deployed_bytes, long long* deploy_msec,
+			    int* images_count );
+
 #endif /* IMAGE_ENGINE_H_ */
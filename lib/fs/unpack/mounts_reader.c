@@ -39,7 +39,28 @@ ssize_t  read_override (int handle, void* data, size_t size){
 
 
 ssize_t mounts_read(struct MountsReader* reader, void *buf, size_t nbyte){
-    return reader->buffered_io_reader->read(reader->buffered_io_reader, reader->fd, buf, nbyte);
+    ssize_t readed = reader->buffered_io_reader->read(reader->buffered_io_reader, reader->fd, buf, nbyte);
+    if ( readed > 0 ) reader->position += readed;
+    return readed;
+}
+
+int mounts_skip(struct MountsReader* reader, off_t nbyte){
+    BufferedIORead* io = reader->buffered_io_reader;
+    if ( nbyte <= io->buffered(io) ){
+	io->data.cursor += nbyte;
+    }
+    else{
+	/*drop buffered data and seek channel*/
+	off_t pos = reader->position + nbyte;
+	if ( reader->mounts_interface->lseek( reader->mounts_interface, 
+					      reader->fd, pos, SEEK_SET) != pos ){
+	    ZRT_LOG( L_ERROR, "can't skip %lld bytes of channel fd=%d", (long long)nbyte, reader->fd );
+	    return -1;
+	}
+	io->data.cursor = io->data.datasize = 0;
+    }
+    reader->position += nbyte;
+    return 0;
 }
 
 
@@ -68,7 +89,9 @@ struct MountsReader* alloc_mounts_reader( struct MountsPublicInterface* mounts_i
 			     read_override /*override read for buffered io*/ );
     /*set interface functions*/
     mounts_reader->fd = fd;
+    mounts_reader->position = 0;
     mounts_reader->read = mounts_read;
+    mounts_reader->skip = mounts_skip;
     mounts_reader->mounts_interface = mounts_interface;
     return mounts_reader;
 }
@@ -31,8 +31,12 @@ struct MountsPublicInterface;
  */
 struct MountsReader{
     ssize_t (*read)(struct MountsReader*, void *buf, size_t nbyte);
+    /*skip nbyte of data without reading it, @return 0 if OK, -1 if
+     *channel is not seekable*/
+    int (*skip)(struct MountsReader*, off_t nbyte);
     /*private data*/
     int fd;                                   /*opened descriptor*/
+    off_t position;                           /*position of next byte to read*/
     char*           buffer;                   /*buffer to be used for buffered io*/
     BufferedIORead* buffered_io_reader;       /*buffered io reader*/
     struct MountsPublicInterface* mounts_interface; /*interface to filesystem*/
@@ -17,57 +17,183 @@
 
 #include "bitarray.h"
 
+#include <string.h>
 #include <assert.h>
 
+#define ALL_BITS (~(uint64_t)0)
+#define WORD_INDEX(index) ((index) / BIT_ARRAY_WORD_BITS)
+#define WORD_BIT(index)   ((index) % BIT_ARRAY_WORD_BITS)
+/*mask of bits [bit, 64) of word*/
+#define MASK_FROM(bit)    (ALL_BITS << (bit))
+/*mask of bits [0, bit) of word, bit in range 1..64*/
+#define MASK_TO(bit)      (ALL_BITS >> (BIT_ARRAY_WORD_BITS - (bit)))
 
-static int bitarray_search_emptybit_sequence_begin(struct BitArray* this, 
+#define EMPTY_BITS(word)  (BIT_ARRAY_WORD_BITS - __builtin_popcountll(word))
+
+
+/*update summary bit of word after it's changed*/
+static inline void update_summary(struct BitArray* this, int word_index){
+    uint64_t bit = (uint64_t)1 << WORD_BIT(word_index);
+    if ( this->array[word_index] == ALL_BITS )
+	this->summary[WORD_INDEX(word_index)] |= bit;
+    else
+	this->summary[WORD_INDEX(word_index)] &= ~bit;
+}
+
+/*set word bits selected by mask to value 0 or 1, update counter and
+ *summary*/
+static inline void set_word_bits(struct BitArray* this, int word_index, 
+				 uint64_t mask, int value){
+    uint64_t old = this->array[word_index];
+    uint64_t word = value ? old | mask : old & ~mask;
+    this->empty_bits_count += EMPTY_BITS(word) - EMPTY_BITS(old);
+    this->array[word_index] = word;
+    update_summary(this, word_index);
+}
+
+static void bitarray_set_range_value(struct BitArray* this, 
+				     int index, int count, int value){
+    if ( count <= 0 ) return;
+    assert( index >= 0 && index+count <= this->bits_count );
+    int first = WORD_INDEX(index);
+    int last = WORD_INDEX(index+count-1);
+    if ( first == last ){
+	set_word_bits(this, first, 
+		      MASK_FROM(WORD_BIT(index)) & MASK_TO(WORD_BIT(index+count-1)+1), value);
+	return;
+    }
+    set_word_bits(this, first, MASK_FROM(WORD_BIT(index)), value);
+    for ( int i=first+1; i < last; i++ )
+	set_word_bits(this, i, ALL_BITS, value);
+    set_word_bits(this, last, MASK_TO(WORD_BIT(index+count-1)+1), value);
+}
+
+static void bitarray_set_range(struct BitArrayPublicInterface* this_public, int index, int count){
+    struct BitArray* this = (struct BitArray*)this_public;
+    bitarray_set_range_value(this, index, count, 1);
+}
+
+static void bitarray_clear_range(struct BitArrayPublicInterface* this_public, int index, int count){
+    struct BitArray* this = (struct BitArray*)this_public;
+    bitarray_set_range_value(this, index, count, 0);
+}
+
+/*@return index of first word that is not full located at word_index
+ *or after it, or words_count if all words are full*/
+static int next_nonfull_word(struct BitArray* this, int word_index){
+    int summary_words = BIT_ARRAY_WORDS(this->words_count);
+    int i = WORD_INDEX(word_index);
+    if ( i >= summary_words ) return this->words_count;
+    uint64_t nonfull = ~this->summary[i] & MASK_FROM(WORD_BIT(word_index));
+    while ( !nonfull ){
+	if ( ++i == summary_words ) return this->words_count;
+	nonfull = ~this->summary[i];
+    }
+    word_index = i*BIT_ARRAY_WORD_BITS + __builtin_ctzll(nonfull);
+    return word_index < this->words_count ? word_index : this->words_count;
+}
+
+static int bitarray_search_emptybit_sequence_begin(struct BitArrayPublicInterface* this_public, 
 					  int begin_offset,
 					  int len_of_sequence){
-    int i, j, search_seq_len=0;
+    struct BitArray* this = (struct BitArray*)this_public;
+    int run_begin = 0, run_len = 0;
     assert(len_of_sequence);
-    for ( i=0; i < this->array_size; i++ ){
-	/*if at least one bit non setted, then locate it*/
-	if ( this->array[i] != 0xFF ){
-	    for ( j=0; j < 8 && search_seq_len < len_of_sequence; j++ ){
-		if ( !this->public.get_bit(this, i*8+j) )
-		    search_seq_len++;
-		else
-		    search_seq_len=0;
-	    }
+    if ( begin_offset < 0 ) begin_offset = 0;
+    int word_index = WORD_INDEX(begin_offset);
+    /*bits before begin_offset are treated as set*/
+    uint64_t skip_mask = MASK_TO(WORD_BIT(begin_offset)+1) >> 1;
 
-	    /*if search complete*/
-	    if ( search_seq_len == len_of_sequence ){
-		/*update default search pos*/
-		this->array_search_pos = i;
-		int matched_index = i*8+(j-1);
-		return matched_index-len_of_sequence+1;
-	    }
+    while ( word_index < this->words_count ){
+	/*full words are breaking sequence, skip them all using summary*/
+	if ( this->array[word_index] == ALL_BITS ){
+	    run_len = 0;
+	    word_index = next_nonfull_word(this, word_index);
+	    skip_mask = 0;
+	    continue;
+	}
+	uint64_t word = this->array[word_index] | skip_mask;
+	skip_mask = 0;
+	if ( word == 0 ){
+	    if ( !run_len ) run_begin = word_index*BIT_ARRAY_WORD_BITS;
+	    run_len += BIT_ARRAY_WORD_BITS;
 	}
 	else{
-	    search_seq_len = 0;
+	    int bit = 0;
+	    while ( bit < BIT_ARRAY_WORD_BITS ){
+		uint64_t rest = word >> bit;
+		/*zero bits up to set bit or to the end of word*/
+		int zeros = rest ? __builtin_ctzll(rest) : BIT_ARRAY_WORD_BITS-bit;
+		if ( zeros ){
+		    if ( !run_len ) run_begin = word_index*BIT_ARRAY_WORD_BITS + bit;
+		    run_len += zeros;
+		    if ( run_len >= len_of_sequence ) return run_begin;
+		    bit += zeros;
+		}
+		if ( bit == BIT_ARRAY_WORD_BITS ) break;
+		/*set bits are breaking sequence*/
+		rest = ~(word >> bit);
+		bit += rest ? __builtin_ctzll(rest) : BIT_ARRAY_WORD_BITS-bit;
+		run_len = 0;
+	    }
 	}
+	if ( run_len >= len_of_sequence ) return run_begin;
+	word_index++;
     }
     return -1;
 }
 
+static int bitarray_search_emptybit_run(struct BitArrayPublicInterface* this_public, 
+					int begin_offset, int* run_begin){
+    struct BitArray* this = (struct BitArray*)this_public;
+    if ( begin_offset < 0 ) begin_offset = 0;
+    if ( begin_offset >= this->bits_count ) return 0;
+    int word_index = WORD_INDEX(begin_offset);
+    /*bits before begin_offset are treated as set*/
+    uint64_t word = this->array[word_index] | (MASK_TO(WORD_BIT(begin_offset)+1) >> 1);
 
-/*set bit & flush cache*/
-static void bitarray_toggle_bit(struct BitArray* this, int index){
-    /*toggle bit*/
-    this->array[index/8] ^= 1 << (index % 8);
-    /*if new bit value is 0 then update search pos*/
-    if ( !this->public.get_bit(this, index) && index < this->array_search_pos )
-	this->array_search_pos = index/8;
+    /*skip full words using summary*/
+    while ( word == ALL_BITS ){
+	word_index = next_nonfull_word(this, word_index+1);
+	if ( word_index == this->words_count ) return 0;
+	word = this->array[word_index];
+    }
+    int bit = __builtin_ctzll(~word);
+    *run_begin = word_index*BIT_ARRAY_WORD_BITS + bit;
+    /*count zero bits up to the first set bit, bits of the last word
+      beyond array are set, so sequence never crosses bits_count*/
+    uint64_t rest = word >> bit;
+    if ( rest ) return __builtin_ctzll(rest);
+    int len = BIT_ARRAY_WORD_BITS - bit;
+    while ( ++word_index < this->words_count && this->array[word_index] == 0 )
+	len += BIT_ARRAY_WORD_BITS;
+    if ( word_index < this->words_count )
+	len += __builtin_ctzll(this->array[word_index]);
+    return len;
 }
 
-static unsigned char bitarray_get_bit(struct BitArray* this, int index){
-    return 1 & (this->array[index/8] >> (index % 8));
+
+static void bitarray_toggle_bit(struct BitArrayPublicInterface* this_public, int index){
+    struct BitArray* this = (struct BitArray*)this_public;
+    uint64_t mask = (uint64_t)1 << WORD_BIT(index);
+    set_word_bits(this, WORD_INDEX(index), mask, 
+		  !(this->array[WORD_INDEX(index)] & mask) );
+}
+
+static char bitarray_get_bit(struct BitArrayPublicInterface* this_public, int index){
+    struct BitArray* this = (struct BitArray*)this_public;
+    return 1 & (this->array[WORD_INDEX(index)] >> WORD_BIT(index));
+}
+
+static int bitarray_count_empty_bits(struct BitArrayPublicInterface* this_public){
+    struct BitArray* this = (struct BitArray*)this_public;
+    return this->empty_bits_count;
 }
 
 /*
   implem must be NULL if want to alloc it in heap, or to use existing
   object provide pointer */
-struct BitArrayPublicInterface* bit_array_construct( unsigned char* array, int array_size, struct BitArray* exist ){
+struct BitArrayPublicInterface* bit_array_construct( uint64_t* array, int bits_count, struct BitArray* exist ){
     /*use existing object memory, for example resided in bss  */
     struct BitArray* this = exist;
 
@@ -76,10 +202,19 @@ struct BitArrayPublicInterface* bit_array_construct( unsigned char* array, int a
     this->public.get_bit =    bitarray_get_bit;
     this->public.search_emptybit_sequence_begin 
 	= bitarray_search_emptybit_sequence_begin;
+    this->public.search_emptybit_run = bitarray_search_emptybit_run;
+    this->public.set_range =   bitarray_set_range;
+    this->public.clear_range = bitarray_clear_range;
+    this->public.count_empty_bits = bitarray_count_empty_bits;
     /*set data members*/
-    this->array_size = array_size;
+    this->bits_count = bits_count;
+    this->words_count = BIT_ARRAY_WORDS(bits_count);
     this->array = array;
-    this->array_search_pos = 0;
+    this->summary = array + this->words_count;
+    memset( array, '\0', BIT_ARRAY_STORAGE_WORDS(bits_count)*sizeof(uint64_t) );
+    this->empty_bits_count = this->words_count*BIT_ARRAY_WORD_BITS;
+    /*bits of the last word beyond array are never free*/
+    if ( WORD_BIT(bits_count) )
+	set_word_bits(this, this->words_count-1, MASK_FROM(WORD_BIT(bits_count)), 1);
     return (struct BitArrayPublicInterface*)this;
 }
-
@@ -19,18 +19,40 @@
 #ifndef __BITARRAY_H__
 #define __BITARRAY_H__
 
+#include <stdint.h>
+
 #include "zrt_defines.h" //CONSTRUCT_L
 
 /*name of constructor*/
 #define BIT_ARRAY bit_array_construct 
 
+#define BIT_ARRAY_WORD_BITS 64
+/*count of 64bit words needed for bits_count bits*/
+#define BIT_ARRAY_WORDS(bits_count) (((bits_count)+BIT_ARRAY_WORD_BITS-1)/BIT_ARRAY_WORD_BITS)
+/*count of words of storage for bits and for summary level*/
+#define BIT_ARRAY_STORAGE_WORDS(bits_count)				\
+    (BIT_ARRAY_WORDS(bits_count) + BIT_ARRAY_WORDS(BIT_ARRAY_WORDS(bits_count)))
+
 struct BitArray;
 
 struct BitArrayPublicInterface{
     void (*toggle_bit)(struct BitArrayPublicInterface*this, int index);
     char (*get_bit)   (struct BitArrayPublicInterface* this, int index);
-    /*@return starting bit index, or -1 if no empty bits located*/
+    /*search for the first sequence of len_of_sequence zero bits
+     *located at begin_offset or after it
+     *@return starting bit index, or -1 if no empty bits located*/
     int  (*search_emptybit_sequence_begin)(struct BitArrayPublicInterface* this, int begin_offset, int len_of_sequence);
+    /*search for the first sequence of zero bits located at begin_offset
+     *or after it, sequence is not limited by length
+     *@param run_begin starting bit index of sequence
+     *@return length of sequence, or 0 if no empty bits located*/
+    int  (*search_emptybit_run)(struct BitArrayPublicInterface* this, int begin_offset, int* run_begin);
+    /*set bits [index, index+count) to 1*/
+    void (*set_range)(struct BitArrayPublicInterface* this, int index, int count);
+    /*set bits [index, index+count) to 0*/
+    void (*clear_range)(struct BitArrayPublicInterface* this, int index, int count);
+    /*@return count of zero bits, it's cached and not calculated*/
+    int  (*count_empty_bits)(struct BitArrayPublicInterface* this);
 };
 
 
@@ -39,19 +61,25 @@ struct BitArrayPublicInterface{
 struct BitArray{
     //base, it is must be a first member
     struct BitArrayPublicInterface public;
-    /*private funcs*/
-    int (*test)();
     /*private data*/
-    int array_size;
-    unsigned char* array;
-    /*search_pos is using to accelerate search by skipping setted bits*/
-    int array_search_pos;
+    int bits_count;
+    int words_count;
+    /*bits are stored by 64bit words, bit index%64 of word index/64*/
+    uint64_t* array;
+    /*summary level, bit N is set if word N of array is full, it's
+     *used to skip full words by search*/
+    uint64_t* summary;
+    /*count of zero bits*/
+    int empty_bits_count;
 };
 
 
-/*@return result pointer can be casted to struct BitArray*/
+/*Bits of array are cleared by constructor, bits of the last word
+ *beyond bits_count are set and never found by search.
+ *@param array storage of BIT_ARRAY_STORAGE_WORDS(bits_count) words
+ *@return result pointer can be casted to struct BitArray*/
 struct BitArrayPublicInterface* 
-bit_array_construct( unsigned char* array, int array_size, struct BitArray* implem );
+bit_array_construct( uint64_t* array, int bits_count, struct BitArray* implem );
 
 #endif //__BITARRAY_H__
 
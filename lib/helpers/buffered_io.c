@@ -69,6 +69,20 @@ int buf_buffered(struct BufferedIORead* self){
 
 int buf_read (BufferedIORead* self, int handle, void* data, size_t size){
     READ_IF_BUFFER_ENOUGH(self, data, size)
+    else if ( size >= self->data.bufmax ){
+	/*large read, get buffered data and read the rest directly
+	  from file descriptor, avoiding copy via buffer*/
+	int cached=self->buffered(self);
+	memcpy( data, self->data.buf + self->data.cursor, cached );
+	self->data.cursor = self->data.datasize = 0;
+	int bytes = self->read_override(handle, data+cached, size-cached);
+	ZRT_LOG( L_EXTRA, "buffered_io: direct read %d/%d bytes \n", bytes, size );
+	if ( bytes <= 0 && cached == 0 ){
+	    /*eof*/
+	    return -1;
+	}
+	return cached + (bytes > 0 ? bytes : 0);
+    }
     else{
 	int sizeinuse=self->buffered(self);
 	/*move unread data into beginning, it's overlap safe*/
@@ -92,6 +106,9 @@ int buf_read (BufferedIORead* self, int handle, void* data, size_t size){
 		READ_IF_BUFFER_ENOUGH(self, data, cached );
 		bytes = self->read_override(handle, data+cached, size-cached);
 		ZRT_LOG( L_EXTRA, "buffered_io: direct read %d/%d bytes \n", bytes, size );
+		/*return actual count of bytes if direct read is incomplete*/
+		if ( bytes < (int)(size-cached) ) 
+		    return cached + (bytes > 0 ? bytes : 0);
 	    }
 	}
 	else{
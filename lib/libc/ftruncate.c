@@ -90,23 +90,21 @@ int zrt_zcall_ftruncate(int fd, off_t length){
     assert(ret==0);
     CHECK_NON_NEGATIVE_VALUE_RETURN_ERROR(st.st_size);
 
-    /*if filesize should be increased then just write null bytes '\0' into*/
-    if ( length > st.st_size ){
-	/*set cursor to the end of file, and check assertion*/
+    /*set new file size, filesystems supporting sparse files are
+     *growing file by adding a hole without writing data*/
+    int res = transpar_mount->ftruncate_size(transpar_mount, fd, length);
+    if ( res != 0 && errno == ENOSYS && length > st.st_size ){
+	/*filesystem can't change size, then write null bytes '\0' into
+	 *set cursor to the end of file, and check assertion*/
+	errno=0;
 	off_t endpos = lseek( fd, st.st_size, SEEK_SET);
 	CHECK_NON_NEGATIVE_VALUE_RETURN_ERROR(st.st_size);
 	assert(endpos==st.st_size);
 
 	/*just write amount of bytes starting from end of file*/
-	int res = write_file_padding(fd, length-st.st_size);
-	CHECK_NON_NEGATIVE_VALUE_RETURN_ERROR(res);
-    }
-    else{ 
-	/*truncate data if user wants to reduce filesize
-	 *set new file size*/
-	int res = transpar_mount->ftruncate_size(transpar_mount, fd, length);	
-	CHECK_NON_NEGATIVE_VALUE_RETURN_ERROR(res);
+	res = write_file_padding(fd, length-st.st_size);
     }
+    CHECK_NON_NEGATIVE_VALUE_RETURN_ERROR(res);
 
     /*restore file position, it's should stay unchanged*/
     if ( saved_pos < length ){
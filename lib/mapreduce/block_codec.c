@@ -0,0 +1,194 @@
+/*
+ * Fast LZ block codec
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h> //malloc
+#include <string.h> //memcpy
+#include <stdint.h>
+
+#include "block_codec.h"
+
+/*Compressed block is a list of sequences, every sequence is a token
+ *byte, literals length, literals, match offset and match length. High
+ *4 bits of token keep literals length and low 4 bits keep match length
+ *minus LZ_MIN_MATCH, value 15 means that length continues in the next
+ *bytes, every byte adds up to 255 to length and byte 255 means that
+ *the next byte follows. Offset is 2 bytes little endian. The last
+ *sequence has literals only*/
+#define LZ_MIN_MATCH     4
+#define LZ_HASH_BITS     12
+#define LZ_MAX_OFFSET    0xffff
+#define LZ_TOKEN_MAX_LEN 15
+/*the last bytes are always literals, and match can't start closer
+ *than LZ_MFLIMIT bytes to the end*/
+#define LZ_LAST_LITERALS 5
+#define LZ_MFLIMIT       12
+
+static inline uint32_t
+LzRead32(const char *p){
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline int
+LzHash(uint32_t v){
+    return (int)((v * 2654435761U) >> (32-LZ_HASH_BITS));
+}
+
+static inline char*
+LzWriteLength(char *op, int len){
+    for ( ; len >= 255; len -= 255 )
+	*op++ = (char)255;
+    *op++ = (char)len;
+    return op;
+}
+
+static char*
+LzWriteLiterals(char *op, char *token, const char *anchor, int len){
+    if ( len >= LZ_TOKEN_MAX_LEN ){
+	*token = (char)(LZ_TOKEN_MAX_LEN << 4);
+	op = LzWriteLength(op, len-LZ_TOKEN_MAX_LEN);
+    }
+    else
+	*token = (char)(len << 4);
+    memcpy(op, anchor, len);
+    return op+len;
+}
+
+/*@return false if length is not completely located in input*/
+static inline int
+LzReadLength(const uint8_t **ip, const uint8_t *iend, int *len){
+    uint8_t b;
+    do{
+	if ( *ip >= iend ) return 0;
+	b = *(*ip)++;
+	*len += b;
+	if ( *len > (1 << 30) ) return 0; /*malformed, avoid overflow*/
+    }while( b == 255 );
+    return 1;
+}
+
+static int
+LzBound(int src_size){
+    return src_size + src_size/255 + 16;
+}
+
+static int
+LzCompress(const char *src, int src_size, char *dst, int dst_capacity){
+    const char *ip = src;
+    const char *anchor = src;
+    const char *iend = src+src_size;
+    const char *mflimit = iend-LZ_MFLIMIT;
+    const char *matchlimit = iend-LZ_LAST_LITERALS;
+    char *op = dst;
+    char *token;
+    int *table;
+    int i;
+
+    if ( src_size < 0 || dst_capacity < LzBound(src_size) ) return -1;
+    /*table keeps last position of every hash of 4 bytes; it's not
+     *located on stack as thread stacks are small*/
+    table = malloc(sizeof(int) << LZ_HASH_BITS);
+    if ( !table ) return -1;
+    for ( i=0; i < (1 << LZ_HASH_BITS); i++ )
+	table[i] = -1;
+
+    while ( src_size > LZ_MFLIMIT && ip < mflimit ){
+	int h = LzHash(LzRead32(ip));
+	int ref = table[h];
+	table[h] = (int)(ip-src);
+	if ( ref < 0 || ip-(src+ref) > LZ_MAX_OFFSET
+	     || LzRead32(src+ref) != LzRead32(ip) ){
+	    ip++;
+	    continue;
+	}
+	const char *match = src+ref;
+	int len = LZ_MIN_MATCH;
+	/*extend match backward into literals and forward*/
+	while ( ip > anchor && match > src && ip[-1] == match[-1] ){
+	    ip--; match--; len++;
+	}
+	while ( ip+len < matchlimit && ip[len] == match[len] )
+	    len++;
+
+	token = op++;
+	op = LzWriteLiterals(op, token, anchor, (int)(ip-anchor));
+	int offset = (int)(ip-match);
+	*op++ = (char)(offset & 0xff);
+	*op++ = (char)(offset >> 8);
+	if ( len-LZ_MIN_MATCH >= LZ_TOKEN_MAX_LEN ){
+	    *token |= LZ_TOKEN_MAX_LEN;
+	    op = LzWriteLength(op, len-LZ_MIN_MATCH-LZ_TOKEN_MAX_LEN);
+	}
+	else
+	    *token |= (char)(len-LZ_MIN_MATCH);
+	ip += len;
+	anchor = ip;
+    }
+    /*last literals*/
+    token = op++;
+    op = LzWriteLiterals(op, token, anchor, (int)(iend-anchor));
+    free(table);
+    return (int)(op-dst);
+}
+
+static int
+LzDecompress(const char *src, int src_size, char *dst, int dst_size){
+    const uint8_t *ip = (const uint8_t*)src;
+    const uint8_t *iend = ip+src_size;
+    char *op = dst;
+    char *oend = dst+dst_size;
+
+    while ( ip < iend ){
+	int token = *ip++;
+	int len = token >> 4;
+	if ( len == LZ_TOKEN_MAX_LEN && !LzReadLength(&ip, iend, &len) ) return -1;
+	if ( len > iend-ip || len > oend-op ) return -1;
+	memcpy(op, ip, len);
+	op += len;
+	ip += len;
+	/*the last sequence has no match*/
+	if ( ip == iend ) break;
+
+	if ( iend-ip < 2 ) return -1;
+	int offset = ip[0] | (ip[1] << 8);
+	ip += 2;
+	if ( offset == 0 || offset > op-dst ) return -1;
+	len = token & LZ_TOKEN_MAX_LEN;
+	if ( len == LZ_TOKEN_MAX_LEN && !LzReadLength(&ip, iend, &len) ) return -1;
+	len += LZ_MIN_MATCH;
+	if ( len > oend-op ) return -1;
+	const char *match = op-offset;
+	if ( offset >= len ){
+	    memcpy(op, match, len);
+	    op += len;
+	}
+	else{
+	    /*overlapped match repeats last offset bytes*/
+	    while ( len-- > 0 )
+		*op++ = *match++;
+	}
+    }
+    return op == oend ? dst_size : -1;
+}
+
+const struct BlockCodec LzBlockCodec = {
+    LzBound,
+    LzCompress,
+    LzDecompress
+};
@@ -0,0 +1,42 @@
+/*
+ * Block codec interface used to compress map to reduce traffic, and
+ * built in fast LZ codec
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLOCK_CODEC_H__
+#define __BLOCK_CODEC_H__
+
+/*Codec compresses independent blocks of data, every block is
+ *compressed and decompressed by single call, no state is kept between
+ *calls, so the same codec can be used by any thread*/
+struct BlockCodec{
+    /*@return max size of compressed data for src_size bytes of input*/
+    int (*bound)(int src_size);
+    /*@param dst_capacity should be not less than bound(src_size)
+     *@return size of compressed data written into dst, -1 on error*/
+    int (*compress)(const char *src, int src_size, char *dst, int dst_capacity);
+    /*@param dst_size exact size of uncompressed data
+     *@return dst_size, or -1 if compressed data is malformed*/
+    int (*decompress)(const char *src, int src_size, char *dst, int dst_size);
+};
+
+/*Fast LZ77 codec producing LZ4 block format: sequences of literals and
+ *matches found by hash of 4 bytes, with 64KB window. It has no entropy
+ *coding and decompression is a plain copy of literals and matches*/
+extern const struct BlockCodec LzBlockCodec;
+
+#endif //__BLOCK_CODEC_H__
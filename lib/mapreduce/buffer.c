@@ -24,12 +24,42 @@
 
 #include "buffer.h"
 
+/*Arena is a list of blocks, the current block is the first; data of
+ *block follows its header and is aligned by uint64_t*/
+struct BufferArena{
+    struct BufferArena *next;
+    size_t size;  /*size of data*/
+    size_t used;  /*bytes of data allocated*/
+    uint64_t data[];
+};
+
+static struct BufferArena*
+AllocArenaBlock( size_t size ){
+    struct BufferArena *block = malloc( sizeof(struct BufferArena) + size );
+    if ( block ){
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+    }
+    return block;
+}
+
+static void
+FreeBufferArena( struct BufferArena *arena ){
+    struct BufferArena *next;
+    for ( ; arena != NULL; arena = next ){
+	next = arena->next;
+	free( arena );
+    }
+}
 
 void FreeBufferData(Buffer *buf){
     buf->header.count = 0;
     buf->header.buf_size = 0;
     free( buf->data );
     buf->data = NULL;
+    FreeBufferArena( buf->arena );
+    buf->arena = NULL;
 }
 
 int AllocBuffer( Buffer *buf, int itemsize, uint32_t granularity ){
@@ -37,6 +67,7 @@ int AllocBuffer( Buffer *buf, int itemsize, uint32_t granularity ){
     buf->header.item_size = itemsize;
     assert(itemsize>0);
     buf->header.count = 0;
+    buf->arena = NULL;
     buf->header.buf_size = granularity * buf->header.item_size;
     buf->data = calloc( granularity, buf->header.item_size );
     if ( buf->data )
@@ -57,3 +88,61 @@ int ReallocBuffer( Buffer *buf ){
     return 0;
 }
 
+
+void* BufferArenaAlloc( Buffer *buf, size_t size ){
+    struct BufferArena *block = buf->arena;
+    size = (size + BUFFER_ARENA_ALIGN-1) & ~(size_t)(BUFFER_ARENA_ALIGN-1);
+    if ( block == NULL || block->size - block->used < size ){
+	if ( size > BUFFER_ARENA_BLOCK_SIZE/4 ){
+	    /*big allocation gets own block, it's linked after current
+	     *block so free space of current block still can be used*/
+	    block = AllocArenaBlock( size );
+	    if ( !block ) return NULL;
+	    block->used = size;
+	    if ( buf->arena ){
+		block->next = buf->arena->next;
+		buf->arena->next = block;
+	    }
+	    else
+		buf->arena = block;
+	    return block->data;
+	}
+	block = AllocArenaBlock( BUFFER_ARENA_BLOCK_SIZE );
+	if ( !block ) return NULL;
+	block->next = buf->arena;
+	buf->arena = block;
+    }
+    void *ptr = (char*)block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void* BufferArenaCopy( Buffer *buf, const void *data, size_t size ){
+    void *ptr = BufferArenaAlloc( buf, size );
+    if ( ptr && size )
+	memcpy( ptr, data, size );
+    return ptr;
+}
+
+size_t BufferArenaBytes( const Buffer *buf ){
+    size_t bytes = 0;
+    for ( const struct BufferArena *block = buf->arena; block != NULL; block = block->next )
+	bytes += sizeof(struct BufferArena) + block->size;
+    return bytes;
+}
+
+void MoveBufferArena( Buffer *dest, Buffer *src ){
+    struct BufferArena *tail = src->arena;
+    if ( tail == NULL || dest == src ) return;
+    if ( dest->arena == NULL ){
+	dest->arena = src->arena;
+    }
+    else{
+	/*src blocks are linked after current block of dest*/
+	while ( tail->next != NULL )
+	    tail = tail->next;
+	tail->next = dest->arena->next;
+	dest->arena->next = src->arena;
+    }
+    src->arena = NULL;
+}
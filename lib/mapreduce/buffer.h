@@ -32,11 +32,21 @@ typedef struct BufferHeader{
 	size_t item_size;
 	size_t count;
 } BufferHeader;
+/*Bump allocator block, see BufferArenaAlloc*/
+struct BufferArena;
+
 typedef struct Buffer{
 	BufferHeader header;
 	char *data;
+	/*blocks of arena allocated memory, freed together with data*/
+	struct BufferArena *arena;
 } Buffer;
 
+/*arena block size, bigger allocations get own block*/
+#define BUFFER_ARENA_BLOCK_SIZE 0x10000
+#define BUFFER_ARENA_ALIGN      8
+
+/*Free items array and all memory allocated in arena of buffer*/
 void 
 FreeBufferData(Buffer *buf);
 
@@ -51,6 +61,28 @@ AllocBuffer( Buffer *buf, int itemsize, uint32_t granularity );
 int 
 ReallocBuffer( Buffer *buf );
 
+/*Allocate memory for keys, values of buffer items by moving pointer
+ *inside of arena block, memory is aligned by BUFFER_ARENA_ALIGN and
+ *it's valid until FreeBufferData, single allocations can't be freed;
+ *Items referring arena memory must not be marked as EDataOwned.
+ *@return allocated memory, NULL if no memory*/
+void*
+BufferArenaAlloc( Buffer *buf, size_t size );
+
+/*@return copy of data allocated in arena of buffer, NULL if no memory*/
+void*
+BufferArenaCopy( Buffer *buf, const void *data, size_t size );
+
+/*@return memory occupied by all blocks of arena of buffer, including
+ *unused space of blocks*/
+size_t
+BufferArenaBytes( const Buffer *buf );
+
+/*Move arena of src into dest, it's needed if items of dest refer memory
+ *allocated in arena of src, and src is going to be freed*/
+void
+MoveBufferArena( Buffer *dest, Buffer *src );
+
 /* INLINE void */
 /* GetBufferItem(const Buffer *buf, int index, void *item); */
 
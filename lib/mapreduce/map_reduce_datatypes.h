@@ -27,6 +27,7 @@
 /*forward decl*/
 struct ChannelsConfigInterface;
 struct MapReduceUserIf;
+struct BlockCodec;
 
 /*Histogram - slice of data, where every N-item "step_hist_common" added into
  *histogram buffer. Hash of key is used as histogram item. 
@@ -40,14 +41,44 @@ typedef struct Histogram{
 } Histogram;
 
 
+/*Order of hashes implemented by user ComparatorHash. If order is known
+ *then LocalSort uses radix sort by hash prefix and ComparatorMrItem is
+ *called only for items having equal prefixes, otherwise qsort is used*/
+enum { EHashOrderUnknown=0, /*sort using ComparatorMrItem only*/
+       EHashOrderBytes=1,   /*hashes compared as memcmp does*/
+       EHashOrderUint=2     /*hashes compared as little endian unsigned integers*/
+};
+
+/*Partitioner of map data between reducers, it's computing dividers
+ *list from data of the first chunk of every map node*/
+enum { EPartitionerHistogram=0, /*every N-th hash of sorted map data*/
+       EPartitionerSampling=1   /*weighted reservoir sample of items, items
+				  are weighted by size, detects hot keys*/
+};
+
 struct MapReduceData{
     int mr_item_size;     /*user must provide right mr item structure size*/
     int hash_size;        /*set BufItemElastic::key_hash size*/
     int value_addr_is_data; /*use BufItemElastic::addr as data*/
+    int hash_order;       /*EHashOrderUnknown by default, see enum above*/
+    /*codec compressing baskets sent by map nodes to reducers, NULL by
+     *default and baskets are sent as is; all nodes of job must use the
+     *same codec, see block_codec.h*/
+    const struct BlockCodec *basket_codec;
+    /*traffic of baskets sent by map node or received by reduce node:
+     *raw bytes and bytes actually transferred*/
+    uint64_t   basket_raw_bytes;
+    uint64_t   basket_wire_bytes;
+    int partitioner;      /*EPartitionerHistogram by default, see enum above*/
+    /*non zero if user Combine is associative and reduce results of the
+     *same key produced by different reducers can be combined later; it
+     *lets sampling partitioner split hot key between reducers*/
+    int combine_associative;
     //internals
     Histogram *histograms_list;
     int        histograms_count; /*histograms count is equal to map nodes count*/
     HashBuffer dividers_list; /*divider list is used to divide map data to reducers*/
+    uint64_t  *reducers_bytes; /*raw bytes sent to every reducer, for skew report*/
 };
 
 
@@ -16,6 +16,8 @@
  * limitations under the License.
  */
 
+#define _XOPEN_SOURCE 500 //pread
+
 #include <stdlib.h> //calloc
 #include <stdio.h>  //puts
 #include <string.h> //memcpy
@@ -25,6 +27,8 @@
 #include <fcntl.h> //temp read file
 #include <assert.h> //assert
 #include <alloca.h>
+#include <pthread.h>
+#include <sys/time.h> //gettimeofday
 
 #include "map_reduce_lib.h"
 #include "mr_defines.h"
@@ -35,12 +39,6 @@
 
 #include "buffer.h"
 
-#define BUFFERED_READ_ASSERT(r_bytes_p, r_bio, r_desc, r_buf, r_size ){		\
-	int cur_read = r_bio->read( (r_bio), (r_desc), (void*)(r_buf), (r_size)); \
-	assert(cur_read>0);						\
-	*(r_bytes_p) += cur_read;					\
-    }
-
 
 static size_t 
 MapInputDataProvider( int fd, 
@@ -99,8 +97,165 @@ MapInputDataProvider( int fd,
 }
 
 
+/*64bit prefix of hash and index of item having that hash*/
+struct HashPrefix{
+    uint64_t prefix;
+    uint32_t index;
+};
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1<<RADIX_BITS)
+#define RADIX_PASSES (64/RADIX_BITS)
+
+/*Get first 8 significant bytes of hash as integer, so that integers
+ *compared in the same order as user ComparatorHash compares hashes*/
+static uint64_t
+HashPrefix( const uint8_t* hash, int hash_size, int hash_order ){
+    uint64_t prefix = 0;
+    int bytes = MIN(hash_size, (int)sizeof(uint64_t));
+    int i;
+    if ( hash_order == EHashOrderBytes ){
+	/*most significant byte is first*/
+	for ( i=0; i < bytes; i++ )
+	    prefix |= (uint64_t)hash[i] << (8*(sizeof(uint64_t)-1-i));
+    }
+    else{
+	/*most significant byte is last*/
+	for ( i=0; i < bytes; i++ )
+	    prefix |= (uint64_t)hash[hash_size-1-i] << (8*(sizeof(uint64_t)-1-i));
+    }
+    return prefix;
+}
+
+/*LSD radix sort of prefixes array, passes for bytes that are equal
+ *for all items are skipped, so short hashes are sorted by few passes.
+ *@param temp space for count items
+ *@return pointer to sorted array, it is one of prefixes, temp*/
+static struct HashPrefix*
+RadixSortPrefixes( struct HashPrefix* prefixes, struct HashPrefix* temp, size_t count ){
+    size_t (*histograms)[RADIX_SIZE] = calloc(RADIX_PASSES, sizeof(*histograms));
+    struct HashPrefix* src = prefixes;
+    struct HashPrefix* dst = temp;
+    struct HashPrefix* swap;
+    size_t i, pos, bucket_count;
+    int pass, b;
+    if ( histograms == NULL ) return NULL;
+
+    /*histograms for all passes are calculated by single read of array*/
+    for ( i=0; i < count; i++ ){
+	for ( pass=0; pass < RADIX_PASSES; pass++ )
+	    histograms[pass][(src[i].prefix >> (pass*RADIX_BITS)) & (RADIX_SIZE-1)]++;
+    }
+
+    for ( pass=0; pass < RADIX_PASSES; pass++ ){
+	size_t *histogram = histograms[pass];
+	int shift = pass*RADIX_BITS;
+	/*skip pass if all items are in the same bucket*/
+	if ( histogram[(src[0].prefix >> shift) & (RADIX_SIZE-1)] == count )
+	    continue;
+	/*convert counts into start positions of buckets*/
+	for ( b=0, pos=0; b < RADIX_SIZE; b++ ){
+	    bucket_count = histogram[b];
+	    histogram[b] = pos;
+	    pos += bucket_count;
+	}
+	/*stable scatter keeps order of previous passes*/
+	for ( i=0; i < count; i++ )
+	    dst[ histogram[(src[i].prefix >> shift) & (RADIX_SIZE-1)]++ ] = src[i];
+	swap = src, src = dst, dst = swap;
+    }
+    free(histograms);
+    return src;
+}
+
+/*Reorder items, so item with index prefixes[i].index is moved into i
+ *position. Items are gathered into new data array if memory is enough,
+ *otherwise items are moved in place by cycles, destroying indexes*/
+static void
+PermuteBufferItems( Buffer *buf, struct HashPrefix* prefixes ){
+    size_t item_size = buf->header.item_size;
+    char* data = malloc(buf->header.buf_size);
+    char* temp;
+    uint32_t i, j, k;
+    if ( data != NULL ){
+	for ( i=0; i < buf->header.count; i++ )
+	    memcpy( data + i*item_size, BufferItemPointer(buf, prefixes[i].index), item_size );
+	free(buf->data);
+	buf->data = data;
+	return;
+    }
+    temp = alloca(item_size);
+    for ( i=0; i < buf->header.count; i++ ){
+	if ( prefixes[i].index == i ) continue;
+	/*move items by cycle, slot i is freed first*/
+	memcpy( temp, BufferItemPointer(buf, i), item_size );
+	j = i;
+	while ( prefixes[j].index != i ){
+	    k = prefixes[j].index;
+	    memcpy( (char*)BufferItemPointer(buf, j), BufferItemPointer(buf, k), item_size );
+	    prefixes[j].index = j;
+	    j = k;
+	}
+	memcpy( (char*)BufferItemPointer(buf, j), temp, item_size );
+	prefixes[j].index = j;
+    }
+}
+
+/*@return 0 if sorted, -1 if memory can't be allocated*/
+static int
+RadixSortByHashPrefix( struct MapReduceUserIf *mif, Buffer *sortable ){
+    size_t count = sortable->header.count;
+    struct HashPrefix* prefixes = malloc(count*sizeof(struct HashPrefix));
+    struct HashPrefix* temp = malloc(count*sizeof(struct HashPrefix));
+    struct HashPrefix* sorted = NULL;
+    size_t i, run_start;
+    if ( prefixes != NULL && temp != NULL ){
+	for ( i=0; i < count; i++ ){
+	    const ElasticBufItemData* item 
+		= (const ElasticBufItemData*)BufferItemPointer(sortable, i);
+	    prefixes[i].prefix = HashPrefix( &item->key_hash, 
+					     HASH_SIZE(mif), 
+					     mif->data.hash_order );
+	    prefixes[i].index = i;
+	}
+	sorted = RadixSortPrefixes( prefixes, temp, count );
+    }
+    if ( sorted == NULL ){
+	free(prefixes);
+	free(temp);
+	return -1;
+    }
+    /*release unused array before items moving*/
+    free( sorted == prefixes ? temp : prefixes );
+
+    PermuteBufferItems( sortable, sorted );
+
+    /*items having equal prefixes are sorted by user comparator, it's
+     *also compares hash bytes beyond of prefix and keys if needed*/
+    for ( run_start=0, i=1; i <= count; i++ ){
+	if ( i == count || sorted[i].prefix != sorted[run_start].prefix ){
+	    if ( i - run_start > 1 ){
+		qsort( (char*)BufferItemPointer(sortable, run_start),
+		       i - run_start,
+		       sortable->header.item_size, 
+		       mif->ComparatorMrItem );
+	    }
+	    run_start = i;
+	}
+    }
+    free(sorted);
+    return 0;
+}
+
+
 void 
 LocalSort( struct MapReduceUserIf *mif, Buffer *sortable ){
+    if ( sortable->header.count < 2 ) return;
+    /*radix sort is used only if user declared order of hashes*/
+    if ( mif->data.hash_order != EHashOrderUnknown &&
+	 RadixSortByHashPrefix( mif, sortable ) == 0 ){
+	return;
+    }
     /*sort created array*/
     qsort( sortable->data, 
 	   sortable->header.count, 
@@ -150,6 +305,103 @@ GetHistogram( struct MapReduceUserIf *mif,
     return histogram->buffer.header.count;
 }
 
+/*Sample item is a hash followed by weight aligned by 8 bytes*/
+#define SAMPLE_WEIGHT_OFFSET(mif_p) ((HASH_SIZE(mif_p)+7) & ~7)
+#define SAMPLE_ITEM_SIZE(mif_p) (SAMPLE_WEIGHT_OFFSET(mif_p)+sizeof(uint64_t))
+
+static inline uint64_t
+SampleWeight( struct MapReduceUserIf *mif, const char *sample_item ){
+    uint64_t weight;
+    memcpy( &weight, sample_item+SAMPLE_WEIGHT_OFFSET(mif), sizeof(weight) );
+    return weight;
+}
+
+static inline void
+SetSampleWeight( struct MapReduceUserIf *mif, char *sample_item, uint64_t weight ){
+    memcpy( sample_item+SAMPLE_WEIGHT_OFFSET(mif), &weight, sizeof(weight) );
+}
+
+/*weight of map item is a size of data sent to reducer*/
+static inline uint64_t
+MrItemWeight( struct MapReduceUserIf *mif, const ElasticBufItemData* item ){
+    uint64_t weight = MRITEM_SIZE(mif) + item->key_data.size;
+    if ( !mif->data.value_addr_is_data )
+	weight += item->value.size;
+    return weight;
+}
+
+/*xorshift generator, sample depends only on map data*/
+static inline uint64_t
+SampleRandom( uint64_t *state ){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+size_t
+GetWeightedSample( struct MapReduceUserIf *mif,
+		   const Buffer* map, 
+		   int sample_size, 
+		   Histogram *histogram ){
+    Buffer *sample = &histogram->buffer;
+    char *sample_item = alloca( SAMPLE_ITEM_SIZE(mif) );
+    const ElasticBufItemData* mritem;
+    uint64_t random_state = 0x9E3779B97F4A7C15ULL ^ map->header.count;
+    uint64_t total_weight = 0;
+    uint64_t weight;
+
+    FreeBufferData( sample );
+    int res = AllocBuffer( sample, SAMPLE_ITEM_SIZE(mif), sample_size );
+    IF_ALLOC_ERROR(res);
+    memset( sample_item, '\0', SAMPLE_ITEM_SIZE(mif) );
+    histogram->step_hist_common = histogram->step_hist_last = 0;
+
+    /*Chao's weighted reservoir sampling: reservoir is filled by first
+     *items, then every item replaces random sample item with probability
+     *sample_size*weight/total_weight*/
+    for( int i=0; i < map->header.count; i++ ){
+	mritem = (const ElasticBufItemData*) BufferItemPointer(map, i);
+	weight = MrItemWeight( mif, mritem );
+	total_weight += weight;
+	memcpy( sample_item, &mritem->key_hash, HASH_SIZE(mif) );
+	SetSampleWeight( mif, sample_item, weight );
+	if ( sample->header.count < sample_size )
+	    AddBufferItem( sample, sample_item );
+	else if ( SampleRandom(&random_state) % total_weight < sample_size*weight )
+	    SetBufferItem( sample, SampleRandom(&random_state) % sample_size, sample_item );
+    }
+
+    /*every sample item represents equal share of total weight, except
+     *of items heavier than share that are always sampled*/
+    if ( map->header.count > sample->header.count ){
+	uint64_t share = total_weight / sample->header.count;
+	for( int i=0; i < sample->header.count; i++ ){
+	    char *item = (char*)BufferItemPointer(sample, i);
+	    if ( SampleWeight(mif, item) < share )
+		SetSampleWeight( mif, item, share );
+	}
+    }
+    /*hash is located at the beginning of sample item*/
+    qsort( sample->data, sample->header.count, SAMPLE_ITEM_SIZE(mif), mif->ComparatorHash );
+    WRITE_FMT_LOG("weighted sample: items=%d of %d, total weight=%llu\n", 
+		  (int)sample->header.count, (int)map->header.count, 
+		  (unsigned long long)total_weight );
+    return sample->header.count;
+}
+
+/*read exactly size bytes, assert on eof or error*/
+static void
+ReadAssert( int fdr, void *data, size_t size ){
+    char *dest = (char*)data;
+    while ( size > 0 ){
+	ssize_t bytes = read(fdr, dest, size);
+	assert(bytes>0);
+	dest += bytes;
+	size -= bytes;
+    }
+}
+
 /************************************************************************
  * EachToOtherPattern callback.
  * Every map node read histograms from another nodes*/
@@ -168,16 +420,17 @@ ReadHistogramFromNode( struct EachToOtherPattern *p_this,
     WRITE_FMT_LOG("ReadHistogramFromNode index=%d\n", index);
     /*histogram array should be empty before reading*/
     assert( !histogram->buffer.header.count );
-    if( read(fdr, &temp, sizeof(Histogram) ) <= 0 )
-	assert(0);
+    ReadAssert( fdr, &temp, sizeof(Histogram) );
+    FreeBufferData( &histogram->buffer );
     *histogram = temp;
-    /*alloc buffer and receive data*/
+    /*alloc buffer and receive data, item size of sample differs from
+      hash size*/
     int res = AllocBuffer( &histogram->buffer, 
 		 histogram->buffer.header.item_size, 
 		 temp.buffer.header.count );
     IF_ALLOC_ERROR(res);
-    if ( read(fdr, histogram->buffer.data, histogram->buffer.header.buf_size ) <= 0 )
-	assert(0);
+    ReadAssert( fdr, histogram->buffer.data, 
+		temp.buffer.header.count*temp.buffer.header.item_size );
     histogram->buffer.header.count = temp.buffer.header.count;
     WRITE_FMT_LOG("ReadHistogramFromNode count=%d, step=%d/%d\n", 
 		  histogram->buffer.header.count, 
@@ -203,8 +456,9 @@ WriteHistogramToNode( struct EachToOtherPattern *p_this,
     WRITE_FMT_LOG("WriteHistogramToNode index=%d\n", index);
     /*write Histogram struct, array contains pointer it should be ignored by receiver */
     write(fdw, histogram, sizeof(Histogram));
-    /*write histogram data*/
-    write(fdw, histogram->buffer.data, histogram->buffer.header.buf_size );
+    /*write histogram data, allocated space can be bigger than data*/
+    write(fdw, histogram->buffer.data, 
+	  histogram->buffer.header.count*histogram->buffer.header.item_size );
     WRITE_FMT_LOG( "eachtoother:wrote( count=%d)\n", histogram->buffer.header.count );
 }
 
@@ -370,6 +624,204 @@ SelectNextHistogramWithMinimalHash( struct MapReduceUserIf *mif,
 }
 
 
+void 
+GetReducersDividerArrayBasedOnSamples( struct MapReduceUserIf *mif,
+				       Histogram *samples, 
+				       int samples_count, 
+				       Buffer *divider_array ){
+    assert(divider_array);
+    int dividers_count_max = divider_array->header.buf_size / divider_array->header.item_size;
+    assert(dividers_count_max != 0);
+
+    /*join samples of all map nodes*/
+    Buffer all;
+    uint64_t total_weight = 0;
+    int res = AllocBuffer( &all, SAMPLE_ITEM_SIZE(mif), 
+			   samples_count*PARTITION_SAMPLES_PER_REDUCER*dividers_count_max );
+    IF_ALLOC_ERROR(res);
+    for( int i=0; i < samples_count; i++ ){
+	assert( samples[i].buffer.header.count == 0 ||
+		samples[i].buffer.header.item_size == SAMPLE_ITEM_SIZE(mif) );
+	for( int j=0; j < samples[i].buffer.header.count; j++ ){
+	    const char *item = BufferItemPointer( &samples[i].buffer, j );
+	    total_weight += SampleWeight( mif, item );
+	    AddBufferItem( &all, item );
+	}
+    }
+    qsort( all.data, all.header.count, SAMPLE_ITEM_SIZE(mif), mif->ComparatorHash );
+
+    uint64_t reducer_share = total_weight / dividers_count_max;
+    if ( !reducer_share ) reducer_share = 1;
+    /*share of rest reducers is recalculated after every divider, so data
+      rest after hot key is not get into single reducer*/
+    uint64_t hot_key_weight_min = reducer_share;
+    uint64_t rest_weight = total_weight;
+    uint64_t current_weight = 0;
+    WRITE_FMT_LOG( "samples=%d, total weight=%llu, reducer share=%llu\n", 
+		   (int)all.header.count, (unsigned long long)total_weight,
+		   (unsigned long long)reducer_share );
+
+    /*last divider is added outside loop and has maximum hash value*/
+    int i=0;
+    while( i < all.header.count && divider_array->header.count+1 < dividers_count_max ){
+	/*weight of all samples of the same hash*/
+	const char *hash = BufferItemPointer( &all, i );
+	uint64_t key_weight = 0;
+	for( ; i < all.header.count && HASH_CMP(mif, hash, BufferItemPointer(&all, i)) == 0; i++ )
+	    key_weight += SampleWeight( mif, BufferItemPointer(&all, i) );
+
+	/*hot key alone exceeds reducer share*/
+	int parts = 1;
+	if ( key_weight >= hot_key_weight_min ){
+	    /*share recalculated after previous divider can exceed weight of
+	      hot key, it still needs own divider*/
+	    if ( mif->data.combine_associative )
+		parts = MAX( 1, key_weight / reducer_share );
+	    WRITE_FMT_LOG( "skew: hot key hash=%s, %.1f%% of data, split between %d reducers\n",
+			   PRINTABLE_HASH(mif, (const uint8_t*)hash), 100.0*key_weight/total_weight, 
+			   parts );
+	}
+
+	current_weight += key_weight;
+	if ( parts > 1 || current_weight >= reducer_share ){
+	    /*repeated divider is splitting hot key between reducers*/
+	    int free_dividers = dividers_count_max-1-divider_array->header.count;
+	    parts = MIN( parts, free_dividers );
+	    for( int j=0; j < parts; j++ )
+		AddBufferItem( divider_array, hash );
+	    rest_weight -= current_weight;
+	    current_weight = 0;
+	    if ( divider_array->header.count < dividers_count_max ){
+		reducer_share = rest_weight / (dividers_count_max - divider_array->header.count);
+		if ( !reducer_share ) reducer_share = 1;
+	    }
+	}
+    }
+
+    uint8_t* divider_hash = alloca( HASH_SIZE(mif) );
+    memset( divider_hash, 0xff, HASH_SIZE(mif) );
+    for(int i=divider_array->header.count; i < dividers_count_max; i++)
+	AddBufferItem(divider_array, divider_hash);
+    FreeBufferData( &all );
+
+#ifdef DEBUG
+    WRITE_LOG("\ndivider_array=[");
+    for( int i=0; i < divider_array->header.count; i++ ){
+	const uint8_t* current_hash = (const uint8_t*)BufferItemPointer(divider_array, i);
+	WRITE_FMT_LOG("%s ", PRINTABLE_HASH(mif,current_hash) );
+    }
+    WRITE_LOG("]\n");
+#endif
+}
+
+
+/*free key and value owned by item*/
+static inline void
+FreeMrItemData( struct MapReduceUserIf *mif, ElasticBufItemData* item ){
+    if ( item->own_key == EDataOwned )
+	free((void*)item->key_data.addr), item->key_data.addr=0;
+    if ( item->own_value == EDataOwned && !mif->data.value_addr_is_data )
+	free((void*)item->value.addr), item->value.addr=0;
+}
+
+/*free keys and values owned by items of buffer*/
+static void
+FreeMrItemsData( struct MapReduceUserIf *mif, Buffer *buf ){
+    for ( int i=0; i < buf->header.count; i++ )
+	FreeMrItemData( mif, (ElasticBufItemData*)BufferItemPointer(buf, i) );
+}
+
+/*Slot of hash aggregation table, index of item in map or -1*/
+struct HashAggSlot{
+    uint32_t code;
+    int32_t  index;
+};
+
+/*FNV-1a of key hash bytes*/
+static inline uint32_t
+HashAggCode( const uint8_t* hash, int hash_size ){
+    uint32_t code = 2166136261U;
+    for ( int i=0; i < hash_size; i++ )
+	code = (code ^ hash[i]) * 16777619U;
+    return code;
+}
+
+static inline int
+HashAggKeysEqual( struct MapReduceUserIf *mif, 
+		  const ElasticBufItemData* item1, 
+		  const ElasticBufItemData* item2 ){
+    return HASH_CMP(mif, &item1->key_hash, &item2->key_hash) == 0 &&
+	item1->key_data.size == item2->key_data.size &&
+	!memcmp( (const void*)item1->key_data.addr, 
+		 (const void*)item2->key_data.addr, item1->key_data.size );
+}
+
+/*@return new table of twice capacity with the same items*/
+static struct HashAggSlot*
+HashAggGrow( struct HashAggSlot* table, size_t *capacity ){
+    size_t new_capacity = *capacity*2;
+    struct HashAggSlot* new_table = malloc( sizeof(*new_table)*new_capacity );
+    IF_ALLOC_ERROR( new_table?0:(int)(sizeof(*new_table)*new_capacity) );
+    for ( size_t i=0; i < new_capacity; i++ )
+	new_table[i].index = -1;
+    for ( size_t i=0; i < *capacity; i++ ){
+	if ( table[i].index < 0 ) continue;
+	size_t slot = table[i].code & (new_capacity-1);
+	while ( new_table[slot].index >= 0 )
+	    slot = (slot+1) & (new_capacity-1);
+	new_table[slot] = table[i];
+    }
+    free(table);
+    *capacity = new_capacity;
+    return new_table;
+}
+
+size_t
+HashAggregate( struct MapReduceUserIf *mif, Buffer *map ){
+    assert( mif->MergeValues );
+    /*open addressing with linear probing, load factor is less than 1/2*/
+    size_t capacity = 1024;
+    struct HashAggSlot* table = malloc( sizeof(*table)*capacity );
+    IF_ALLOC_ERROR( table?0:(int)(sizeof(*table)*capacity) );
+    for ( size_t i=0; i < capacity; i++ )
+	table[i].index = -1;
+
+    /*unique items are moved to the beginning of map*/
+    int unique_count = 0;
+    for ( int i=0; i < map->header.count; i++ ){
+	ElasticBufItemData* item = (ElasticBufItemData*)BufferItemPointer(map, i);
+	uint32_t code = HashAggCode( &item->key_hash, HASH_SIZE(mif) );
+	size_t slot = code & (capacity-1);
+	while ( table[slot].index >= 0 ){
+	    ElasticBufItemData* found 
+		= (ElasticBufItemData*)BufferItemPointer(map, table[slot].index);
+	    if ( table[slot].code == code && HashAggKeysEqual(mif, found, item) )
+		break;
+	    slot = (slot+1) & (capacity-1);
+	}
+
+	if ( table[slot].index >= 0 ){
+	    ElasticBufItemData* found 
+		= (ElasticBufItemData*)BufferItemPointer(map, table[slot].index);
+	    mif->MergeValues( found, item );
+	    FreeMrItemData( mif, item );
+	}
+	else{
+	    if ( unique_count != i )
+		SetBufferItem( map, unique_count, item );
+	    table[slot].code = code;
+	    table[slot].index = unique_count++;
+	    if ( (size_t)unique_count*2 > capacity )
+		table = HashAggGrow( table, &capacity );
+	}
+    }
+    WRITE_FMT_LOG( "HashAggregate: items count=%d, aggregated=%d\n", 
+		   (int)map->header.count, unique_count );
+    map->header.count = unique_count;
+    free(table);
+    return unique_count;
+}
+
 size_t
 MapInputDataLocalProcessing( struct MapReduceUserIf *mif, 
 			     const char *buf, 
@@ -384,12 +836,16 @@ MapInputDataLocalProcessing( struct MapReduceUserIf *mif,
     WRITE_FMT_LOG("sbrk()=%p\n", (void*)sbrk(0) );
     WRITE_FMT_LOG("======= new portion of data read: input buffer=%p, buf_size=%u\n", 
 		  buf, (uint32_t)buf_size );
-    /*user Map process input data and allocate keys, values buffers*/
+    /*user Map process input data and allocate keys, values buffers,
+      preferably in arena of sort buffer*/
     unhandled_data_pos = mif->Map( buf, buf_size, last_chunk, &sort );
     WRITE_FMT_LOG("User Map() function result : items count=%u, unhandled pos=%u\n",
 		  (uint32_t)sort.header.count, (uint32_t)unhandled_data_pos );
 
     WRITE_LOG_BUFFER(mif, sort );
+    /*hash combiner shrinks data before sort*/
+    if ( mif->MergeValues )
+	HashAggregate( mif, &sort );
     LocalSort( mif, &sort);
 
     WRITE_FMT_LOG("MapCallEvent:sorted map, count=%u\n", (uint32_t)sort.header.count);
@@ -399,14 +855,19 @@ MapInputDataLocalProcessing( struct MapReduceUserIf *mif,
     IF_ALLOC_ERROR(res);
 
     WRITE_FMT_LOG("MapCallEvent: Combine Start, count=%u\n", (uint32_t)sort.header.count);
-    if ( mif->Combine ){
+    if ( mif->Combine && !mif->MergeValues ){
 	mif->Combine( &sort, result );
+	/*combined items can refer keys, values allocated in sort arena*/
+	MoveBufferArena( result, &sort );
 	FreeBufferData(&sort);
     }
     else{
-	//use sort buffer instead reduced, because user does not defined Combine function
+	/*use sort buffer instead reduced, because user does not defined
+	  Combine function, or items are already aggregated*/
+	FreeBufferData(result);
 	*result = sort;
 	sort.data = NULL;
+	sort.arena = NULL;
     }
 
     WRITE_FMT_LOG("MapCallEvent: Combine Complete, count=%u\n", (uint32_t)result->header.count);
@@ -435,9 +896,16 @@ MapCreateHistogramSendEachToOtherCreateDividersList( struct ChannelsConfigInterf
     struct Histogram* histogram = NULL;
     GET_HISTOGRAM_BY_NODE(mif, current_node_index, histogram);
 
-    size_t hist_step = map->header.count / map_nodes_count / 100;
     /*save histogram for own data always into current_node_index-pos of histograms array*/
-    GetHistogram( mif, map, hist_step, histogram );
+    if ( mif->data.partitioner == EPartitionerSampling ){
+	GetWeightedSample( mif, map, 
+			   reduce_nodes_count*PARTITION_SAMPLES_PER_REDUCER, 
+			   histogram );
+    }
+    else{
+	size_t hist_step = map->header.count / map_nodes_count / 100;
+	GetHistogram( mif, map, hist_step, histogram );
+    }
 
     WRITE_FMT_LOG("MapCallEvent: histogram created. "
 		  "count=%d, fstep=%u, lstep=%u\n",
@@ -459,10 +927,18 @@ MapCreateHistogramSendEachToOtherCreateDividersList( struct ChannelsConfigInterf
     IF_ALLOC_ERROR(res);
     /*From now every map node contain histograms from all map nodes, summarize histograms,
      *to get distribution of all data. Result of summarization write into divider_array.*/
-    GetReducersDividerArrayBasedOnSummarizedHistograms( mif,
-							mif->data.histograms_list,
-							mif->data.histograms_count,
-							&mif->data.dividers_list );
+    if ( mif->data.partitioner == EPartitionerSampling ){
+	GetReducersDividerArrayBasedOnSamples( mif,
+					       mif->data.histograms_list,
+					       mif->data.histograms_count,
+					       &mif->data.dividers_list );
+    }
+    else{
+	GetReducersDividerArrayBasedOnSummarizedHistograms( mif,
+							    mif->data.histograms_list,
+							    mif->data.histograms_count,
+							    &mif->data.dividers_list );
+    }
     free(map_nodes_list);
     free(reduce_nodes_list);
 }
@@ -494,72 +970,148 @@ BufferedWriteSingleMrItem( BufferedIOWrite* bio,
     return bytes;
 }
 
-static int
-BufferedReadSingleMrItem( BufferedIORead* bio, 
-			  int fdr,
-			  ElasticBufItemData* item,
-			  int hashsize,
-			  int value_addr_is_data){
-    int bytes=0;
-    /*key size*/
-    BUFFERED_READ_ASSERT( &bytes, bio, fdr, (void*)&item->key_data.size, sizeof(item->key_data.size) );
-    /*key data*/
-    item->key_data.addr = (uintptr_t)malloc(item->key_data.size);
-    item->own_key = EDataOwned;
-    BUFFERED_READ_ASSERT( &bytes, bio, fdr, (void*)item->key_data.addr, item->key_data.size );
-    if ( value_addr_is_data ){
-	/*ElasticBufItemData::key_data::addr used as data, key_data::size not used*/
-	BUFFERED_READ_ASSERT( &bytes, bio, fdr, (void*)&item->value.addr, sizeof(item->value.addr) );
-	item->own_value = EDataNotOwned;
-	item->value.size = 0;
-    }
-    else{
-
-	/*value size*/
-	BUFFERED_READ_ASSERT( &bytes, bio, fdr, (void*)&item->value.size, sizeof(item->value.size) );
-	/*value data*/
-	item->value.addr = (uintptr_t)malloc(item->value.size);
-	item->own_value=EDataOwned;
-	BUFFERED_READ_ASSERT( &bytes, bio, fdr, (void*)item->value.addr, item->value.size );
-    }
-    /*key hash*/
-    BUFFERED_READ_ASSERT( &bytes, bio, fdr, (void*)&item->key_hash, hashsize );
-    return bytes;
-}
- 
+/*Basket wire format: header, array of items, arena. Items are sent as
+ *is, but key_data.addr and value.addr (if value is not a data) are
+ *offsets in arena, where keys and values data are located. Receiver
+ *reads array of items directly into Buffer and arena by single read,
+ *and only relocates offsets into addresses. If basket codec is set then
+ *items array and arena are compressed separately, every of them is
+ *sent as is if compression doesn't make it smaller*/
+struct BasketHeader{
+    int last_data_flag;
+    int items_count;
+    int arena_size;
+    /*sizes of compressed items array and arena, 0 if sent as is*/
+    int items_packed_size;
+    int arena_packed_size;
+};
 
 static size_t
-CalculateSendingDataSize(const Buffer *map, 
-			 int data_start_index, 
-			 int items_count,
-			 int hashsize,
-			 int value_addr_is_data)
+CalculateArenaSize(const Buffer *map, 
+		   int data_start_index, 
+		   int items_count,
+		   int value_addr_is_data)
 {
-    /*calculate sending data of size */
-    size_t senddatasize= 0;
-    senddatasize += sizeof(int) + sizeof(int); //last_data_flag,items count
+    size_t arena_size= 0;
     int loop_up_to_count = data_start_index+items_count;
     const ElasticBufItemData* item;
 
     for( int i=data_start_index; i < loop_up_to_count; i++ ){
 	item = (const ElasticBufItemData*)BufferItemPointer( map, i );
-	senddatasize+= item->key_data.size;     /*size of key data*/
+	arena_size+= item->key_data.size;     /*size of key data*/
 	if ( !value_addr_is_data )
-	    senddatasize+= item->value.size;    /*size of value data*/
+	    arena_size+= item->value.size;    /*size of value data*/
+    }
+    WRITE_FMT_LOG( "arena_size=%d\n", (int)arena_size );
+    return arena_size;
+}
+
+/*Get copy of map item with addresses replaced by offsets in arena
+ *@param arena_offset offset of item data, it's advanced by data size*/
+static inline void
+GetBasketItem( struct MapReduceUserIf *mif,
+	       const Buffer *map, 
+	       int index,
+	       ElasticBufItemData* item,
+	       uintptr_t *arena_offset ){
+    GetBufferItem( map, index, item );
+    item->key_data.addr = *arena_offset;
+    *arena_offset += item->key_data.size;
+    if ( !mif->data.value_addr_is_data ){
+	item->value.addr = *arena_offset;
+	*arena_offset += item->value.size;
+    }
+}
+
+/*Copy keys and values data of items into arena
+ *@return pointer to arena end*/
+static char*
+FillBasketArena( struct MapReduceUserIf *mif,
+		 const Buffer *map, 
+		 int data_start_index, 
+		 int items_count,
+		 char *arena ){
+    for( int i=data_start_index; i < data_start_index+items_count; i++ ){
+	const ElasticBufItemData* item = 
+	    (const ElasticBufItemData*)BufferItemPointer( map, i );
+	memcpy( arena, (void*)item->key_data.addr, item->key_data.size );
+	arena += item->key_data.size;
+	if ( !mif->data.value_addr_is_data ){
+	    memcpy( arena, (void*)item->value.addr, item->value.size );
+	    arena += item->value.size;
+	}
+    }
+    return arena;
+}
+
+/*@return compressed block, or NULL if compression doesn't make block
+ *smaller and it should be sent as is*/
+static char*
+PackBasketBlock( const struct BlockCodec *codec, 
+		 const char *block, 
+		 int size, 
+		 int *packed_size ){
+    *packed_size = 0;
+    if ( size == 0 ) return NULL;
+    int bound = codec->bound(size);
+    char *packed = malloc(bound);
+    IF_ALLOC_ERROR(packed?0:bound);
+    int res = codec->compress(block, size, packed, bound);
+    if ( res <= 0 || res >= size ){
+	free(packed);
+	return NULL;
+    }
+    *packed_size = res;
+    return packed;
+}
+
+/*Write items array and arena compressed by basket codec, header
+ *sizes of compressed blocks are set here
+ *@return bytes written including header*/
+static int
+WritePackedBasket( struct MapReduceUserIf *mif,
+		   BufferedIOWrite* bio, 
+		   int fdw, 
+		   const Buffer *map, 
+		   int data_start_index, 
+		   struct BasketHeader *header ){
+    const struct BlockCodec *codec = mif->data.basket_codec;
+    int items_size = header->items_count*MRITEM_SIZE(mif);
+    int bytes=0;
+
+    /*compressor needs contiguous blocks*/
+    char *items = malloc(items_size+header->arena_size);
+    IF_ALLOC_ERROR(items?0:items_size+header->arena_size);
+    char *arena = items+items_size;
+    uintptr_t arena_offset = 0;
+    for( int i=0; i < header->items_count; i++ ){
+	GetBasketItem( mif, map, data_start_index+i, 
+		       (ElasticBufItemData*)(items+i*MRITEM_SIZE(mif)), &arena_offset );
     }
-    /*size of value data / value size*/
-    //value data/size
-    if ( value_addr_is_data )
-	senddatasize+= items_count * sizeof(((struct BinaryData*)0)->addr);
+    FillBasketArena( mif, map, data_start_index, header->items_count, arena );
+
+    char *packed_items = PackBasketBlock( codec, items, items_size, 
+					  &header->items_packed_size );
+    char *packed_arena = PackBasketBlock( codec, arena, header->arena_size, 
+					  &header->arena_packed_size );
+    WRITE_FMT_LOG( "basket packed: items %d->%d, arena %d->%d\n", 
+		   items_size, header->items_packed_size, 
+		   header->arena_size, header->arena_packed_size );
+
+    bytes+= bio->write( bio, fdw, header, sizeof(*header) );
+    if ( packed_items )
+	bytes+= bio->write( bio, fdw, packed_items, header->items_packed_size );
+    else
+	bytes+= bio->write( bio, fdw, items, items_size );
+    if ( packed_arena )
+	bytes+= bio->write( bio, fdw, packed_arena, header->arena_packed_size );
     else
-	senddatasize+= items_count * sizeof(((struct BinaryData*)0)->size);
-    /*size of hash*/
-    senddatasize+= items_count * hashsize;
-    /*size of key size*/
-    senddatasize+= items_count * sizeof(((struct BinaryData*)0)->size);
-    /*************************************/
-    WRITE_FMT_LOG( "senddatasize=%d\n", senddatasize );
-    return senddatasize;
+	bytes+= bio->write( bio, fdw, arena, header->arena_size );
+
+    free(packed_items);
+    free(packed_arena);
+    free(items);
+    return bytes;
 }
  
 void 
@@ -575,60 +1127,68 @@ WriteDataToReduce( struct MapReduceUserIf *mif,
     int loop_up_to_count = data_start_index+items_count;
     assert( loop_up_to_count <= map->header.count );
 
-    int senddatasize = CalculateSendingDataSize(map, 
-						data_start_index, 
-						items_count, 
-						HASH_SIZE(mif),
-						mif->data.value_addr_is_data);
+    struct BasketHeader header;
+    /*write last data flag 0 | 1, if reducer receives 1 then it
+      should exclude this map node from communications*/
+    header.last_data_flag = last_data_flag;
+    /*items count we want send to a single reducer*/
+    header.items_count = items_count;
+    header.arena_size = CalculateArenaSize(map, 
+					   data_start_index, 
+					   items_count, 
+					   mif->data.value_addr_is_data);
+    header.items_packed_size = 0;
+    header.arena_packed_size = 0;
 
     /*log first and last hashes of range to send */
 #ifdef DEBUG
     WRITE_FMT_LOG( "data_start_index=%d, items_count=%d\n", 
 		   data_start_index, items_count );
-    ElasticBufItemData* temp = alloca( MRITEM_SIZE(mif) );
-    GetBufferItem( map, data_start_index, current );
-    GetBufferItem( map, data_start_index+items_count-1, temp ); /*last item from range*/
-    WRITE_FMT_LOG( "send range of hashes [%s - %s]",
-		   PRINTABLE_HASH(mif, &current->key_hash), 
-		   PRINTABLE_HASH(mif, &temp->key_hash) );
+    if ( items_count > 0 ){
+	ElasticBufItemData* temp = alloca( MRITEM_SIZE(mif) );
+	GetBufferItem( map, data_start_index, current );
+	GetBufferItem( map, data_start_index+items_count-1, temp ); /*last item from range*/
+	WRITE_FMT_LOG( "send range of hashes [%s - %s]",
+		       PRINTABLE_HASH(mif, &current->key_hash), 
+		       PRINTABLE_HASH(mif, &temp->key_hash) );
+    }
     WRITE_FMT_LOG( "fdw=%d, last_data_flag=%d, items_count=%d\n", 
 		   fdw, last_data_flag, items_count );
 #endif //DEBUG
 
-    bio->write( bio, fdw, &senddatasize, sizeof(int) );
-    
-    /*write last data flag 0 | 1, if reducer receives 1 then it
-      should exclude this map node from communications*/
-    bytes+= bio->write( bio, fdw, &last_data_flag, sizeof(int) );
-    /*items count we want send to a single reducer*/
-    bytes+= bio->write( bio, fdw, &items_count, sizeof(int) );
-
-    for( int i=data_start_index; i < loop_up_to_count; i++ ){
-	GetBufferItem( map, i, current );
-	bytes+= BufferedWriteSingleMrItem( bio, fdw, current, 
-					   HASH_SIZE(mif),
-					   mif->data.value_addr_is_data);
+    if ( mif->data.basket_codec != NULL ){
+	bytes+= WritePackedBasket( mif, bio, fdw, map, data_start_index, &header );
+    }
+    else{
+	bytes+= bio->write( bio, fdw, &header, sizeof(header) );
+	/*items array, addresses are replaced by offsets in arena*/
+	uintptr_t arena_offset = 0;
+	for( int i=data_start_index; i < loop_up_to_count; i++ ){
+	    GetBasketItem( mif, map, i, current, &arena_offset );
+	    bytes+= bio->write( bio, fdw, current, MRITEM_SIZE(mif) );
+	}
+	/*arena*/
+	for( int i=data_start_index; i < loop_up_to_count; i++ ){
+	    const ElasticBufItemData* item = 
+		(const ElasticBufItemData*)BufferItemPointer( map, i );
+	    bytes+= bio->write( bio, fdw, (void*)item->key_data.addr, item->key_data.size);
+	    if ( !mif->data.value_addr_is_data )
+		bytes+= bio->write( bio, fdw, (void*)item->value.addr, item->value.size);
+	}
+	assert(bytes == sizeof(header) + items_count*MRITEM_SIZE(mif) + header.arena_size);
     }
     bio->flush_write(bio, fdw);
-    assert(bytes ==senddatasize);
+    mif->data.basket_raw_bytes += 
+	sizeof(header) + items_count*MRITEM_SIZE(mif) + header.arena_size;
+    mif->data.basket_wire_bytes += bytes;
 }
 
-/*struct to be used inside MapSendToAllReducers*/
-struct BasketInfo{
-    int data_start_index;
-    int count_in_section;
-};
-
 static void 
 MapSendToAllReducers( struct ChannelsConfigInterface *ch_if, 
 		      struct MapReduceUserIf *mif,
 		      int last_data, 
 		      const Buffer *map){
     /*Distribute data to Reducer nodes, using dividers data*/
-    struct BasketInfo* DistributeDataIntoBaskets(struct MapReduceUserIf *mif, 
-						 const Buffer *map,
-						 int basket_count);
-
     int basket_count = mif->data.dividers_list.header.count;
     struct BasketInfo* basket_array = DistributeDataIntoBaskets( mif, map, basket_count);
     last_data = last_data ? MAP_NODE_EXCLUDE : MAP_NODE_NO_EXCLUDE; 
@@ -646,8 +1206,13 @@ MapSendToAllReducers( struct ChannelsConfigInterface *ch_if,
     IF_ALLOC_ERROR(send_buffer?0:SEND_BUFFER_SIZE);
     BufferedIOWrite* bio = AllocBufferedIOWrite( send_buffer, SEND_BUFFER_SIZE, NULL);
     IF_ALLOC_ERROR( bio?0:SEND_BUFFER_SIZE );
+    if ( !mif->data.reducers_bytes ){
+	mif->data.reducers_bytes = calloc( basket_count, sizeof(uint64_t) );
+	IF_ALLOC_ERROR( mif->data.reducers_bytes?0:basket_count*(int)sizeof(uint64_t) );
+    }
 
     for( int i=0; i < basket_count; i++ ){
+	uint64_t raw_bytes = mif->data.basket_raw_bytes;
 	/*send to reducer with current_divider_index index*/
 	struct UserChannel *channel 
 	    = ch_if->Channel(ch_if, EReduceNode, reduce_nodes_list[i], EChannelModeWrite);
@@ -662,6 +1227,7 @@ MapSendToAllReducers( struct ChannelsConfigInterface *ch_if,
 			   basket_array[i].data_start_index, 
 			   basket_array[i].count_in_section, 
 			   last_data );
+	mif->data.reducers_bytes[i] += mif->data.basket_raw_bytes - raw_bytes;
     }
 
     free(bio);
@@ -670,98 +1236,83 @@ MapSendToAllReducers( struct ChannelsConfigInterface *ch_if,
 }
 
 
-/*Depend on mif->data.dividers_list calculate inex of beginning item index and items
- *count of buffer map to be send into reducer node in further, 
- *@param resulted array with calculation info*/
-struct BasketInfo* DistributeDataIntoBaskets(struct MapReduceUserIf *mif, 
-					     const Buffer *map,
-					     int basket_count){
-
-#define LOG_ADD_TO_NEW_BASKET(mif_p, map_p, itemindex, basketindex, dataindex, countsection, \
-			      currentdivider)				\
-	{								\
-	    if ( itemindex > 0 ){					\
-		ElasticBufItemData* previtem				\
-		    = (ElasticBufItemData*)BufferItemPointer( map_p, itemindex-1); \
-		WRITE_FMT_LOG( "reducer #%d divider_hash=%s, [%d]=%s\n", \
-			       basketindex,				\
-			       PRINTABLE_HASH(mif_p, currentdivider),	\
-			       itemindex-1, PRINTABLE_HASH(mif, &previtem->key_hash) );	\
-	    }								\
-	    WRITE_FMT_LOG( "reducer #%d divider_hash=%s, [%d]=%s\n",	\
-			   basketindex,					\
-			   PRINTABLE_HASH(mif_p, currentdivider),	\
-			   itemindex, PRINTABLE_HASH(mif_p, &current->key_hash) ); \
-	    WRITE_FMT_LOG( "Basket #%d start_index=%d, count=%d\n",	\
-			   basketindex, dataindex, countsection );	\
-	}								\
-
-    int switchbasket=0;
-    int basket_index=0;
-    int data_start_index = 0;
-    int count_in_section = 0;
-    int current_divider_index = 0;
-    ElasticBufItemData* current = alloca( MRITEM_SIZE(mif) );
-    void*  current_divider_hash = alloca( HASH_SIZE(mif) );
+struct BasketInfo* 
+DistributeDataIntoBaskets( struct MapReduceUserIf *mif, 
+			   const Buffer *map,
+			   int basket_count ){
+    const Buffer *dividers = &mif->data.dividers_list;
     struct BasketInfo* basket_array;
     basket_array = malloc(sizeof(struct BasketInfo)*basket_count);
-
-    /*Get first divider hash*/
-    GetBufferItem(&mif->data.dividers_list, 0, current_divider_hash);
-
-    /*loop for data +1, no out of bounds can be because handle it*/
-    for ( int j=0; j < map->header.count+1; j++ ){
-	if ( j < map->header.count ){
-	    /*get item by valid index*/
-	    GetBufferItem( map, j, current);
-	    if ( HASH_CMP(mif, &current->key_hash, current_divider_hash ) <= 0 ){
-		switchbasket=0;
-		count_in_section++;
-	    }
-	    /*switch to new basket, cuurent hash more than divider*/
-	    else{
-		switchbasket=1;
-	    }
-	}
+    IF_ALLOC_ERROR( basket_array?0:(int)sizeof(struct BasketInfo)*basket_count );
+    assert( basket_count <= dividers->header.count );
+
+    int item_index = 0;
+    int basket_index = 0;
+    while( basket_index < basket_count ){
+	const void* divider_hash = BufferItemPointer( dividers, basket_index );
+	/*divider is repeated for hot key split between reducers*/
+	int repeats = 1;
+	while( basket_index+repeats < basket_count &&
+	       HASH_CMP(mif, divider_hash, 
+			BufferItemPointer(dividers, basket_index+repeats)) == 0 )
+	    ++repeats;
+
+	/*items having hash less or equal to divider, the last basket gets
+	  the rest of items*/
+	int data_start_index = item_index;
+	if ( basket_index+repeats == basket_count )
+	    item_index = map->header.count;
 	else{
-	    switchbasket=1;
+	    while( item_index < map->header.count &&
+		   HASH_CMP(mif, 
+			    &((const ElasticBufItemData*)BufferItemPointer(map, item_index))->key_hash,
+			    divider_hash) <= 0 )
+		++item_index;
 	}
 
-	/*if current item is last OR current hash more than current divider key*/
-	if ( switchbasket != 0 ){
-#ifdef DEBUG
-	    LOG_ADD_TO_NEW_BASKET(mif, map, j, basket_index, data_start_index, 
-				  count_in_section, current_divider_hash);
-#endif
+	/*items of divider hash are located at the end of range, split them
+	  evenly if user allowed it*/
+	int hot_start_index = item_index;
+	if ( repeats > 1 && mif->data.combine_associative ){
+	    while( hot_start_index > data_start_index &&
+		   HASH_CMP(mif, 
+			    &((const ElasticBufItemData*)BufferItemPointer(map, hot_start_index-1))->key_hash,
+			    divider_hash) == 0 )
+		--hot_start_index;
+	}
+	int hot_count = item_index - hot_start_index;
+	for( int i=0; i < repeats; i++ ){
 	    struct BasketInfo info;
-	    info.data_start_index = data_start_index;
-	    info.count_in_section = count_in_section;
-	    basket_array[basket_index++] = info;
-
-	    /*switch to next divider, do increment if it's not last handling item*/
-	    current_divider_index++;
-	    if ( current_divider_index < mif->data.dividers_list.header.count ){
-		/*retrieve hash value by updated index*/
-		GetBufferItem( &mif->data.dividers_list, 
-			       current_divider_index, 
-			       current_divider_hash);
-	    }
-	    /*update data start index for new divider*/
-	    data_start_index = j;
-	    /*reset count for next divider, also count current item */
-	    count_in_section = 1;
+	    int part_end = hot_start_index + (int)((int64_t)hot_count*(i+1)/repeats);
+	    info.data_start_index = i == 0 ? data_start_index 
+		: hot_start_index + (int)((int64_t)hot_count*i/repeats);
+	    info.count_in_section = part_end - info.data_start_index;
+	    basket_array[basket_index+i] = info;
+	    WRITE_FMT_LOG( "Basket #%d start_index=%d, count=%d\n",	
+			   basket_index+i, info.data_start_index, info.count_in_section );
 	}
+	basket_index += repeats;
     }
+    return basket_array;
+}
 
-    /*add info about empty data to the rest of baskets*/
-    for(int i=basket_index; i < basket_count; i++ ){
-	struct BasketInfo info;
-	info.data_start_index = 0;
-	info.count_in_section = 0;
-	basket_array[basket_index++] = info;
+/*Log raw bytes sent to every reducer and max/mean ratio*/
+static void
+LogReducersSkew( struct MapReduceUserIf *mif ){
+    int count = mif->data.dividers_list.header.count;
+    uint64_t all_bytes = 0, max_bytes = 0;
+    if ( !mif->data.reducers_bytes || !count ) return;
+    for( int i=0; i < count; i++ ){
+	WRITE_FMT_LOG( "skew report: reducer #%d got %llu bytes\n", 
+		       i, (unsigned long long)mif->data.reducers_bytes[i] );
+	all_bytes += mif->data.reducers_bytes[i];
+	if ( mif->data.reducers_bytes[i] > max_bytes )
+	    max_bytes = mif->data.reducers_bytes[i];
     }
-
-    return basket_array;
+    WRITE_FMT_LOG( "skew report: reducers=%d, mean=%llu bytes, max=%llu bytes, "
+		   "max/mean=%.2f\n", count, (unsigned long long)(all_bytes/count), 
+		   (unsigned long long)max_bytes, 
+		   all_bytes ? (double)max_bytes*count/all_bytes : 1.0 );
 }
 
 
@@ -812,6 +1363,141 @@ PrintDebugInfo(struct MapReduceUserIf *mif, struct ChannelsConfigInterface *chif
 }
 
 
+/*time spent by map node stages, usec*/
+struct MapStageTimes{
+    double read;      /*input data reading*/
+    double map;       /*Map, sort, Combine*/
+    double histogram; /*histograms exchange, dividers calculation*/
+    double send;      /*distribution of data to reducers*/
+    double wait;      /*waiting for sender in pipelined mode*/
+    int    chunks;
+};
+
+static double
+ElapsedUsec( const struct timeval *start ){
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec)*1000000.0 + (now.tv_usec - start->tv_usec);
+}
+
+/*Send map data of single chunk to reducers and free map data and input
+ *buffer, map items can refer to input buffer, so it's freed after send*/
+static void
+MapSendChunk( struct ChannelsConfigInterface *chif,
+	      struct MapReduceUserIf *mif,
+	      struct MapNodeEvents* events,
+	      Buffer *map_buffer,
+	      char *input_buffer,
+	      int last_chunk ){
+    /*based on dividers list which helps easy distribute data to reduce nodes*/
+    events->MapSendToAllReducers( chif, 
+				  mif,
+				  last_chunk, 
+				  map_buffer);
+
+    /*keys, values allocated in arena are freed together with buffer,
+      items owning data are freed one by one*/
+    FreeMrItemsData( mif, map_buffer );
+    FreeBufferData(map_buffer);
+    free(input_buffer);
+}
+
+/*Sender thread of pipelined map node, it distributes chunk N to
+ *reducers while main thread reads and maps chunk N+1. Threads are
+ *cooperative, sender runs only when main thread yields at blocking I/O
+ *or waits for sender*/
+struct MapSender{
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    /*job, it's valid if job_ready is set*/
+    Buffer          map_buffer;
+    char           *input_buffer;
+    int             last_chunk;
+    int             job_ready;
+    int             busy;     /*sender is sending a job*/
+    struct ChannelsConfigInterface *chif;
+    struct MapReduceUserIf *mif;
+    struct MapNodeEvents   *events;
+    double          send_usec;
+};
+
+static void*
+MapSenderThread( void *arg ){
+    struct MapSender *sender = (struct MapSender *)arg;
+    Buffer map_buffer;
+    char *input_buffer;
+    int last_chunk;
+    struct timeval start;
+    do{
+	pthread_mutex_lock( &sender->mutex );
+	while ( !sender->job_ready )
+	    pthread_cond_wait( &sender->cond, &sender->mutex );
+	map_buffer = sender->map_buffer;
+	input_buffer = sender->input_buffer;
+	last_chunk = sender->last_chunk;
+	sender->job_ready = 0;
+	sender->busy = 1;
+	pthread_mutex_unlock( &sender->mutex );
+
+	gettimeofday(&start, NULL);
+	MapSendChunk( sender->chif, sender->mif, sender->events, 
+		      &map_buffer, input_buffer, last_chunk );
+	sender->send_usec += ElapsedUsec(&start);
+
+	pthread_mutex_lock( &sender->mutex );
+	sender->busy = 0;
+	pthread_cond_signal( &sender->cond );
+	pthread_mutex_unlock( &sender->mutex );
+    }while( last_chunk == 0 );
+    return NULL;
+}
+
+static void
+MapSenderStart( struct MapSender *sender,
+		struct ChannelsConfigInterface *chif,
+		struct MapReduceUserIf *mif,
+		struct MapNodeEvents* events ){
+    memset( sender, '\0', sizeof(*sender) );
+    sender->chif = chif;
+    sender->mif = mif;
+    sender->events = events;
+    pthread_mutex_init( &sender->mutex, NULL );
+    pthread_cond_init( &sender->cond, NULL );
+    int ret = pthread_create( &sender->thread, NULL, MapSenderThread, sender );
+    assert( ret == 0 );
+}
+
+/*Pass job to sender, wait while previous job is being sent, so only two
+ *chunks are in memory: one is being sent and another is being mapped.
+ *@return wait time, usec*/
+static double
+MapSenderSubmit( struct MapSender *sender,
+		 Buffer *map_buffer,
+		 char *input_buffer,
+		 int last_chunk ){
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    pthread_mutex_lock( &sender->mutex );
+    while ( sender->job_ready || sender->busy )
+	pthread_cond_wait( &sender->cond, &sender->mutex );
+    sender->map_buffer = *map_buffer;
+    sender->input_buffer = input_buffer;
+    sender->last_chunk = last_chunk;
+    sender->job_ready = 1;
+    pthread_cond_signal( &sender->cond );
+    pthread_mutex_unlock( &sender->mutex );
+    return ElapsedUsec(&start);
+}
+
+/*wait until last chunk sent*/
+static void
+MapSenderStop( struct MapSender *sender ){
+    pthread_join( sender->thread, NULL );
+    pthread_mutex_destroy( &sender->mutex );
+    pthread_cond_destroy( &sender->cond );
+}
+
 int 
 MapNodeMain( struct MapReduceUserIf *mif, 
 	     struct ChannelsConfigInterface *chif ){
@@ -841,12 +1527,25 @@ MapNodeMain( struct MapReduceUserIf *mif,
     if ( getenv(MAP_CHUNK_SIZE_ENV) )
 	split_input_size = atoi(getenv(MAP_CHUNK_SIZE_ENV));
     WRITE_FMT_LOG( "MAP_CHUNK_SIZE_BYTES=%d\n", split_input_size );
+
+    /*pipelined mode: send chunk N by sender thread while chunk N+1 is mapped*/
+    int pipeline = 0;
+    if ( getenv(MAP_PIPELINE_ENV) )
+	pipeline = atoi(getenv(MAP_PIPELINE_ENV));
+    WRITE_FMT_LOG( "MAP_PIPELINE=%d\n", pipeline );
 	
     /*by default can set any number, but actually it should be point to start of unhandled data,
      * for fully handled data it should be set to data size*/
     size_t current_unhandled_data_pos = 0;
     int last_chunk = 0;
 
+    struct MapStageTimes times;
+    memset( &times, '\0', sizeof(times) );
+    struct timeval start;
+    struct MapSender sender;
+    if ( pipeline )
+	MapSenderStart( &sender, chif, mif, &events );
+
     /*get input channel*/
     struct UserChannel *channel = chif->Channel(chif,
 						EInputOutputNode, 
@@ -858,6 +1557,7 @@ MapNodeMain( struct MapReduceUserIf *mif,
     do{
 	free(buffer), buffer=NULL;
 
+	gettimeofday(&start, NULL);
 	/*last parameter is not used for first call, 
 	  for another calls it should be assigned by user returned value of Map call*/
 	returned_buf_size = events.MapInputDataProvider(
@@ -866,6 +1566,7 @@ MapNodeMain( struct MapReduceUserIf *mif,
 							split_input_size,
 							current_unhandled_data_pos
 							);
+	times.read += ElapsedUsec(&start);
 	last_chunk = returned_buf_size < split_input_size? 1 : 0; //last chunk flag
 	if ( last_chunk != 0 ){
 	    WRITE_LOG( "MapInputDataProvider last chunk data" );
@@ -873,8 +1574,10 @@ MapNodeMain( struct MapReduceUserIf *mif,
 
 	/*prepare Buffer before using by user Map function*/
 	Buffer map_buffer;
+	memset( &map_buffer, '\0', sizeof(map_buffer) );
 
 	if ( returned_buf_size ){
+	    gettimeofday(&start, NULL);
 	    /*call users Map, Combine functions only for non empty data set*/
 	    current_unhandled_data_pos = 
 		events.MapInputDataLocalProcessing( mif,
@@ -882,42 +1585,102 @@ MapNodeMain( struct MapReduceUserIf *mif,
 						    returned_buf_size,
 						    last_chunk,
 						    &map_buffer );
+	    times.map += ElapsedUsec(&start);
 	}
 
 	if ( !mif->data.dividers_list.header.count ){
+	    gettimeofday(&start, NULL);
 	    events.MapCreateHistogramSendEachToOtherCreateDividersList( chif, 
 									mif, 
 									&map_buffer );
+	    times.histogram += ElapsedUsec(&start);
 	}
 
-	/*based on dividers list which helps easy distribute data to reduce nodes*/
-	events.MapSendToAllReducers( chif, 
-				     mif,
-				     last_chunk, 
-				     &map_buffer);
-
-	for(int i=0; i < map_buffer.header.count; i++){
-	    TRY_FREE_MRITEM_DATA( (ElasticBufItemData*) 
-				  BufferItemPointer(&map_buffer, i ) );
+	if ( pipeline ){
+	    /*ownership of map data and input buffer goes to sender*/
+	    times.wait += MapSenderSubmit( &sender, &map_buffer, buffer, last_chunk );
+	    buffer = NULL;
+	}
+	else{
+	    gettimeofday(&start, NULL);
+	    MapSendChunk( chif, mif, &events, &map_buffer, buffer, last_chunk );
+	    buffer = NULL;
+	    times.send += ElapsedUsec(&start);
 	}
-	FreeBufferData(&map_buffer);
+	times.chunks++;
     }while( last_chunk == 0 );
 
+    if ( pipeline ){
+	gettimeofday(&start, NULL);
+	MapSenderStop( &sender );
+	times.wait += ElapsedUsec(&start);
+	times.send = sender.send_usec;
+    }
+
+    WRITE_FMT_LOG( "MapNodeMain stages time, ms: chunks=%d, read=%.0f, map=%.0f, "
+		   "histogram=%.0f, send=%.0f, wait for send=%.0f\n",
+		   times.chunks, times.read/1000, times.map/1000, 
+		   times.histogram/1000, times.send/1000, times.wait/1000 );
+    WRITE_FMT_LOG( "MapNodeMain sent baskets: raw bytes=%llu, wire bytes=%llu\n",
+		   (unsigned long long)mif->data.basket_raw_bytes, 
+		   (unsigned long long)mif->data.basket_wire_bytes );
+    LogReducersSkew( mif );
+    free( mif->data.reducers_bytes );
+    mif->data.reducers_bytes = NULL;
     WRITE_LOG("MapNodeMain Complete\n");
 
     return 0;
 }
 
-/*Copy into dest buffer items from source_arrays buffers in sorted order*/
+/*Merge heap item is a source index, source with minimal hash of
+ *current item is on top; for equal hashes source with bigger index goes
+ *first. current - array of current items of all sources*/
+static inline int
+MergeHeapLess( struct MapReduceUserIf *mif,
+	       const ElasticBufItemData* const *current,
+	       int source1, 
+	       int source2 ){
+    int cmp = HASH_CMP( mif, &current[source1]->key_hash, &current[source2]->key_hash );
+    return cmp != 0 ? cmp < 0 : source1 > source2;
+}
+
+static void
+MergeHeapSiftDown( struct MapReduceUserIf *mif,
+		   const ElasticBufItemData* const *current,
+		   int *heap, 
+		   int heap_size, 
+		   int i ){
+    int top = heap[i];
+    int child;
+    while ( (child = 2*i+1) < heap_size ){
+	if ( child+1 < heap_size &&
+	     MergeHeapLess(mif, current, heap[child+1], heap[child]) )
+	    child++;
+	if ( !MergeHeapLess(mif, current, heap[child], top) )
+	    break;
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = top;
+}
+
+static void
+MergeHeapBuild( struct MapReduceUserIf *mif,
+		const ElasticBufItemData* const *current,
+		int *heap, 
+		int heap_size ){
+    for(int i=heap_size/2-1; i >= 0; i-- ){
+	MergeHeapSiftDown( mif, current, heap, heap_size, i );
+    }
+}
+
+/*Copy into dest buffer items from source_arrays buffers in sorted order,
+ *binary heap of source buffers is used, so merge is O(n*log(k))*/
 void 
 MergeBuffersToNew( struct MapReduceUserIf *mif,
 		   Buffer *dest,
 		   const Buffer *source_arrays, 
 		   int arrays_count ){
-    int SearchMinimumHashAmongCurrentItemsOfAllMergeBuffers( struct MapReduceUserIf *mif,
-							     const Buffer* merge_buffers, 
-							     int *current_indexes_array,
-							     int count);
     int all_items_count=0;
     /*List of items count of every merging item before merge*/
     int i;
@@ -932,133 +1695,646 @@ MergeBuffersToNew( struct MapReduceUserIf *mif,
 
     int merge_pos[arrays_count];
     memset(merge_pos, '\0', sizeof(merge_pos) );
-    int min_key_array;
-    ElasticBufItemData* current;
-
-    /*search minimal key among current items of source_arrays*/
-    min_key_array =
-	SearchMinimumHashAmongCurrentItemsOfAllMergeBuffers( mif,
-							     source_arrays, 
-							     merge_pos,
-							     arrays_count);
+    const ElasticBufItemData* current[arrays_count];
+    int heap[arrays_count];
+    int heap_size = 0;
+    char* dest_item = dest->data;
+    size_t item_size = dest->header.item_size;
+
+    /*non empty source buffers only are added into heap*/
+    for(i=0; i < arrays_count; i++ ){
+	if ( source_arrays[i].header.count > 0 ){
+	    current[i] = (const ElasticBufItemData*)BufferItemPointer( &source_arrays[i], 0 );
+	    heap[heap_size++] = i;
+	}
+    }
+    MergeHeapBuild( mif, current, heap, heap_size );
+
     uint32_t merge_result_bytes_occupied=0;
-    while( min_key_array !=-1 ){
-	/*copy item data with minimal key into destination buffer*/
-	current = (ElasticBufItemData*)
-	    BufferItemPointer( &source_arrays[min_key_array], merge_pos[min_key_array] );
-	AddBufferItem( dest, current );
-	merge_pos[min_key_array]++;
-	min_key_array =
-	    SearchMinimumHashAmongCurrentItemsOfAllMergeBuffers( mif,
-								 source_arrays, 
-								 merge_pos,
-								 arrays_count);
-	merge_result_bytes_occupied += mif->data.mr_item_size + current->key_data.size;
+    while( heap_size > 0 ){
+	/*copy item data with minimal key directly into preallocated destination*/
+	int min_key_array = heap[0];
+	const ElasticBufItemData* item = current[min_key_array];
+	memcpy( dest_item, item, item_size );
+	dest_item += item_size;
+	merge_result_bytes_occupied += mif->data.mr_item_size + item->key_data.size;
 	if( !mif->data.value_addr_is_data )
-	    merge_result_bytes_occupied += current->value.size;
+	    merge_result_bytes_occupied += item->value.size;
+
+	/*remove exhausted buffer from heap*/
+	if ( ++merge_pos[min_key_array] == source_arrays[min_key_array].header.count )
+	    heap[0] = heap[--heap_size];
+	else
+	    current[min_key_array] = (const ElasticBufItemData*)
+		BufferItemPointer( &source_arrays[min_key_array], merge_pos[min_key_array] );
+	MergeHeapSiftDown( mif, current, heap, heap_size, 0 );
     }
+    dest->header.count = all_items_count;
     WRITE_FMT_LOG("Merged Items memory occupied=%u\n", merge_result_bytes_occupied);
 }
 
-int
-SearchMinimumHashAmongCurrentItemsOfAllMergeBuffers( struct MapReduceUserIf *mif,
-						     const Buffer* merge_buffers, 
-						     int *current_indexes_array,
-						     int count){ 
-    int res = -1;
+
+/*Read block of basket into dest, decompress it if it's packed
+ *@return bytes read*/
+static int
+ReadBasketBlock( struct MapReduceUserIf *mif, 
+		 int fdr, 
+		 char *dest, 
+		 int size, 
+		 int packed_size ){
+    if ( packed_size == 0 ){
+	ReadAssert( fdr, dest, size );
+	return size;
+    }
+    /*sender compresses blocks only if codec is set, so codec must be
+      set for receiver too*/
+    assert( mif->data.basket_codec != NULL );
+    char *packed = malloc(packed_size);
+    IF_ALLOC_ERROR(packed?0:packed_size);
+    ReadAssert( fdr, packed, packed_size );
+    int res = mif->data.basket_codec->decompress( packed, packed_size, dest, size );
+    assert( res == size );
+    free(packed);
+    return packed_size;
+}
+
+/*Receive basket sent by WriteDataToReduce. Items array is read directly
+ *into map buffer, keys and values are located in arena of map buffer
+ *and not owned by items*/
+exclude_flag_t
+RecvDataFromSingleMap( struct MapReduceUserIf *mif,
+		       int fdr,
+		       Buffer *map ) {
+    struct BasketHeader header;
+    int bytes = sizeof(header);
+    ReadAssert( fdr, &header, sizeof(header) );
+    /*read last data flag 0 | 1, if reducer receives 1 then it should
+     * exclude sender map node from communications in further*/
+    WRITE_FMT_LOG( "readmap exclude flag=%d, items_count=%d, arena_size=%d, "
+		   "packed items=%d, packed arena=%d\n", 
+		   header.last_data_flag, header.items_count, header.arena_size,
+		   header.items_packed_size, header.arena_packed_size );
+
+    /*alloc memory for all array cells expected to receive, if no items will recevied
+     *initialize buffer anyway*/
+    int res = AllocBuffer(map, MRITEM_SIZE(mif), header.items_count);
+    IF_ALLOC_ERROR(res);
+    bytes+= ReadBasketBlock( mif, fdr, map->data, 
+			     header.items_count*MRITEM_SIZE(mif),
+			     header.items_packed_size );
+    map->header.count = header.items_count;
+
+    /*keys, values of basket are read into arena of received buffer*/
+    char *arena = NULL;
+    if ( header.arena_size > 0 ){
+	arena = BufferArenaAlloc(map, header.arena_size);
+	IF_ALLOC_ERROR(arena?0:header.arena_size);
+	bytes+= ReadBasketBlock( mif, fdr, arena, header.arena_size,
+				 header.arena_packed_size );
+    }
+    mif->data.basket_raw_bytes += 
+	sizeof(header) + header.items_count*MRITEM_SIZE(mif) + header.arena_size;
+    mif->data.basket_wire_bytes += bytes;
+
+    /*relocate offsets into arena addresses*/
     ElasticBufItemData* item;
-    const uint8_t* current_hash;
-    const uint8_t* minimal_hash = NULL;
-    for ( int i=0; i < count; i++ ){ /*loop for merge arrays*/
-	/*check bounds of current buffer*/
-	if ( BOUNDS_OK(current_indexes_array[i],merge_buffers[i].header.count) ){
-	    /*get minimal value among currently indexed histogram values*/ 
-		item = (ElasticBufItemData*)BufferItemPointer( &merge_buffers[i],
-							       current_indexes_array[i]);
-		current_hash =  (const uint8_t*)&item->key_hash;
-	    if ( minimal_hash == NULL || HASH_CMP( mif, current_hash, minimal_hash ) <= 0 ){
-		res = i;
-		minimal_hash = current_hash;
-	    }
+    for( int i=0; i < header.items_count; i++ ){
+	item = (ElasticBufItemData*)BufferItemPointer( map, i );
+	item->key_data.addr += (uintptr_t)arena;
+	item->own_key = EDataNotOwned;
+	if ( !mif->data.value_addr_is_data ){
+	    item->value.addr += (uintptr_t)arena;
+	    item->own_value = EDataNotOwned;
 	}
     }
-    return res;
+    WRITE_FMT_LOG( "readed %d items from Map node, fdr=%d\n", 
+		   (int)map->header.count, fdr );
+    WRITE_LOG_BUFFER( mif, *map );
+    return header.last_data_flag;
 }
 
+/*Sorted runs received by reducer node. Every run has a level: received
+ *runs are of level 0, and result of merge and Combine of runs of level
+ *N has level N+1, so every item is merged log(items) times at most
+ *instead of merging all previous data with every new portion*/
+struct ReduceRuns{
+    Buffer *runs;
+    int    *levels;
+    size_t *bytes;  /*memory occupied by every run, see ReduceRunBytes*/
+    int     count;
+    size_t  all_bytes;
+    /*count of runs of the same level to be merged*/
+    int     merge_runs;
+    /*memory for runs, if exceeded all runs are merged, 0 - not limited*/
+    size_t  memory_budget;
+    /*runs spilled into file when memory budget exceeded*/
+    int     spill_fd; /*-1 if spill is not used*/
+    off_t   spill_size;
+    struct SpilledRun *spilled;
+    int     spilled_count;
+};
 
-static exclude_flag_t
-RecvDataFromSingleMap( struct MapReduceUserIf *mif,
-		       int fdr,
-		       Buffer *map) {
-    exclude_flag_t excl_flag=0;
-    int items_count;
-    char* recv_buffer;
-    int bytes;
-    /*read exact packet size and allocate buffer to read a whole data by single read i/o*/
-    if ( read(fdr, &bytes, sizeof(int) ) <= 0 )
-	assert(0);
-    WRITE_FMT_LOG( "packet size=%d\n", bytes );
-    if ( bytes > 0 ){
-	recv_buffer = malloc(bytes);
-	IF_ALLOC_ERROR(recv_buffer?0:bytes);
-
-	BufferedIORead* bio = AllocBufferedIORead( recv_buffer, bytes, NULL);
-	IF_ALLOC_ERROR(bio?0:bytes);
-	/*read last data flag 0 | 1, if reducer receives 1 then it should
-	 * exclude sender map node from communications in further*/
-	bytes=0;
-	BUFFERED_READ_ASSERT( &bytes, bio, fdr, &excl_flag, sizeof(int) );
-	/*read items count*/
-	BUFFERED_READ_ASSERT( &bytes, bio, fdr, &items_count, sizeof(int) );
-	WRITE_FMT_LOG( "readmap exclude flag=%d, items_count=%d\n", excl_flag, items_count );
-
-	/*alloc memory for all array cells expected to receive, if no items will recevied
-	 *initialize buffer anyway*/
-	int res = AllocBuffer(map, MRITEM_SIZE(mif), items_count);
-	IF_ALLOC_ERROR(res);
+/*sorted run written into spill file*/
+struct SpilledRun{
+    off_t offset;
+    off_t size;
+    int   count;
+};
 
-	if ( items_count > 0 ){
-	    /*read items_count items*/
-	    ElasticBufItemData* item;
-	    for( int i=0; i < items_count; i++ ){
-		/*add item manually, no excesive copy doing*/
-		AddBufferItemVirtually(map);
-		item = (ElasticBufItemData*)BufferItemPointer( map, i );
-		/*save directly into array*/
-		bytes+=BufferedReadSingleMrItem( bio, fdr, item, 
-						 HASH_SIZE(mif),
-						 mif->data.value_addr_is_data);
-	    }
+/*reader of spilled run, it reads file by pread, so readers of all runs
+ *share the same spill file descriptor*/
+struct SpillReader{
+    int   fd;
+    off_t pos;    /*file position of data not yet read into buffer*/
+    off_t end;
+    int   items_left;
+    char* buf;
+    int   cursor;
+    int   datasize;
+};
+
+/*@return memory occupied by run: items array, arena blocks kept alive
+ *by run even if items don't refer them anymore, and keys, values owned
+ *by items; data not owned by items is located in arena or belongs to
+ *user*/
+static size_t
+ReduceRunBytes( struct MapReduceUserIf *mif, const Buffer *run ){
+    size_t bytes = run->header.buf_size + BufferArenaBytes(run);
+    const ElasticBufItemData* item;
+    for ( int i=0; i < run->header.count; i++ ){
+	item = (const ElasticBufItemData*)BufferItemPointer(run, i);
+	if ( item->own_key == EDataOwned )
+	    bytes += item->key_data.size;
+	if ( !mif->data.value_addr_is_data && item->own_value == EDataOwned )
+	    bytes += item->value.size;
+    }
+    return bytes;
+}
+
+/*get ownership of run data and add it into runs list*/
+static void
+ReduceRunsAdd( struct MapReduceUserIf *mif, struct ReduceRuns *runs, 
+	       Buffer *run, int level ){
+    int count = runs->count+1;
+    runs->runs = realloc( runs->runs, count*sizeof(*runs->runs) );
+    runs->levels = realloc( runs->levels, count*sizeof(*runs->levels) );
+    runs->bytes = realloc( runs->bytes, count*sizeof(*runs->bytes) );
+    IF_ALLOC_ERROR( runs->runs && runs->levels && runs->bytes ? 0 : count );
+    runs->runs[runs->count] = *run;
+    runs->levels[runs->count] = level;
+    runs->bytes[runs->count] = ReduceRunBytes(mif, run);
+    runs->all_bytes += runs->bytes[runs->count];
+    runs->count = count;
+    memset( run, '\0', sizeof(*run) );
+}
+
+/*Copy keys, values not owned by items of run into new arena of run and
+ *free old arena. Combine drops most of merged items, but their data
+ *stays in arenas of merged runs, so arenas are replaced if they are
+ *mostly not referred anymore*/
+static void
+CompactRunArena( struct MapReduceUserIf *mif, Buffer *run ){
+    size_t referred = 0;
+    ElasticBufItemData* item;
+    for ( int i=0; i < run->header.count; i++ ){
+	item = (ElasticBufItemData*)BufferItemPointer(run, i);
+	if ( item->own_key != EDataOwned )
+	    referred += item->key_data.size;
+	if ( !mif->data.value_addr_is_data && item->own_value != EDataOwned )
+	    referred += item->value.size;
+    }
+    size_t arena_bytes = BufferArenaBytes(run);
+    if ( arena_bytes == 0 || arena_bytes <= 2*referred ) return;
+    WRITE_FMT_LOG( "compact arena of run: %u bytes, referred %u\n", 
+		   (uint32_t)arena_bytes, (uint32_t)referred );
+
+    Buffer old_arena; memset( &old_arena, '\0', sizeof(old_arena) );
+    MoveBufferArena( &old_arena, run );
+    for ( int i=0; i < run->header.count; i++ ){
+	item = (ElasticBufItemData*)BufferItemPointer(run, i);
+	if ( item->own_key != EDataOwned ){
+	    item->key_data.addr = (uintptr_t)
+		BufferArenaCopy( run, (void*)item->key_data.addr, item->key_data.size );
+	    IF_ALLOC_ERROR( item->key_data.addr ? 0 : item->key_data.size );
+	}
+	if ( !mif->data.value_addr_is_data && item->own_value != EDataOwned ){
+	    item->value.addr = (uintptr_t)
+		BufferArenaCopy( run, (void*)item->value.addr, item->value.size );
+	    IF_ALLOC_ERROR( item->value.addr ? 0 : item->value.size );
+	}
+    }
+    FreeBufferData( &old_arena );
+}
+
+/*Merge runs of specified level into single run and apply Combine if
+ *defined, merged runs are removed from list.
+ *@param level level of runs to merge, -1 to merge all runs
+ *@param result merged run*/
+static void
+ReduceRunsMerge( struct MapReduceUserIf *mif, struct ReduceRuns *runs, 
+		 int level, Buffer *result ){
+    Buffer merge_buffers[runs->count];
+    Buffer merged;
+    int merge_count=0;
+    int kept=0;
+    /*move runs to be merged into merge array, keep the rest*/
+    for ( int i=0; i < runs->count; i++ ){
+	if ( level < 0 || runs->levels[i] == level ){
+	    merge_buffers[merge_count++] = runs->runs[i];
+	    runs->all_bytes -= runs->bytes[i];
+	}
+	else{
+	    runs->runs[kept] = runs->runs[i];
+	    runs->levels[kept] = runs->levels[i];
+	    runs->bytes[kept] = runs->bytes[i];
+	    kept++;
 	}
-	WRITE_FMT_LOG( "readed %d bytes from Map node, fdr=%d, item count=%d\n", 
-		       bytes, fdr, map->header.count );
-	WRITE_LOG_BUFFER( mif, *map );
-	free(bio);
-	free(recv_buffer);
-    }
-    return excl_flag;
-}
-
-/*into newbuf_p will be added all from merge_buffers_p and from all buffer in sort order*/
-#define MERGE_PREVIOUS_AND_NEW(mif_p, merge_buffers_p, count_buffers, prevbuf, newbuf ){ \
-	/*grow array of buffers, and add previous merge result into merge array*/ \
-	merge_buffers_p = realloc( merge_buffers_p,			\
-				   (++count_buffers)*sizeof(Buffer) );	\
-	merge_buffers_p[count_buffers-1] = prevbuf;			\
-	memset( &prevbuf, '\0', sizeof(prevbuf) );			\
-	WRITE_LOG( "Data received from mappers, merge it" );		\
-	/*Alloc buffers for merge results, and merge previous and new data*/ \
-	MergeBuffersToNew(mif_p, &newbuf, merge_buffers_p, count_buffers ); \
-	WRITE_FMT_LOG( "merge complete, keys count %d, data=%p\n", newbuf.header.count, newbuf.data ); \
-	/*Merge complete, free source recv buffers*/			\
-	for ( int i=0; i < count_buffers; i++ ){			\
-	    FreeBufferData(&merge_buffers_p[i]);			\
+    }
+    runs->count = kept;
+    WRITE_FMT_LOG( "merge %d runs of level %d\n", merge_count, level );
+
+    MergeBuffersToNew( mif, &merged, merge_buffers, merge_count );
+    /*Merge complete, free source buffers, merged items still refer
+      keys, values of source arenas*/
+    for ( int i=0; i < merge_count; i++ ){
+	MoveBufferArena( &merged, &merge_buffers[i] );
+	FreeBufferData(&merge_buffers[i]);
+    }
+    WRITE_FMT_LOG( "merge complete, keys count %d, data=%p\n", 
+		   (int)merged.header.count, merged.data );
+    if ( mif->Combine ){
+	int granularity = merged.header.count>0? merged.header.count/3 : 1000;
+	int ret = AllocBuffer( result, MRITEM_SIZE(mif), granularity );
+	IF_ALLOC_ERROR(ret);
+	WRITE_LOG_BUFFER(mif,merged);
+	WRITE_FMT_LOG( "keys count before Combine: %d\n", (int)merged.header.count );
+	mif->Combine( &merged, result );
+	MoveBufferArena( result, &merged );
+	FreeBufferData( &merged );
+	CompactRunArena( mif, result );
+	WRITE_FMT_LOG( "keys count after Combine: %d\n", (int)result->header.count );
+	WRITE_LOG_BUFFER(mif,*result);
+    }
+    else{
+	*result = merged;
+    }
+}
+
+/*Write run into the end of spill file and free run with its data and
+ *arena*/
+static void
+ReduceRunsSpill( struct MapReduceUserIf *mif, struct ReduceRuns *runs, Buffer *run ){
+    struct SpilledRun spilled;
+    int bytes=0;
+    void *write_buffer = malloc(SEND_BUFFER_SIZE);
+    IF_ALLOC_ERROR(write_buffer?0:SEND_BUFFER_SIZE);
+    BufferedIOWrite* bio = AllocBufferedIOWrite( write_buffer, SEND_BUFFER_SIZE, NULL);
+    IF_ALLOC_ERROR( bio?0:SEND_BUFFER_SIZE );
+
+    spilled.offset = runs->spill_size;
+    spilled.count = run->header.count;
+    for( int i=0; i < run->header.count; i++ ){
+	bytes+= BufferedWriteSingleMrItem( bio, runs->spill_fd, 
+					   (const ElasticBufItemData*)BufferItemPointer(run, i),
+					   HASH_SIZE(mif),
+					   mif->data.value_addr_is_data);
+    }
+    bio->flush_write(bio, runs->spill_fd);
+    free(bio);
+    free(write_buffer);
+    spilled.size = bytes;
+    runs->spill_size += bytes;
+    WRITE_FMT_LOG( "spill run: %d items, %d bytes at offset %lld\n", 
+		   spilled.count, bytes, (long long)spilled.offset );
+
+    runs->spilled = realloc( runs->spilled, (runs->spilled_count+1)*sizeof(*runs->spilled) );
+    IF_ALLOC_ERROR( runs->spilled ? 0 : runs->spilled_count+1 );
+    runs->spilled[runs->spilled_count++] = spilled;
+
+    FreeMrItemsData( mif, run );
+    FreeBufferData( run );
+}
+
+/*@return 0 if ok, -1 if no data*/
+static int
+SpillReaderRead( struct SpillReader *reader, void *data, int size ){
+    char *dest = (char*)data;
+    while ( size > 0 ){
+	if ( reader->cursor == reader->datasize ){
+	    /*buffer is empty, read next portion of run*/
+	    int count = MIN((off_t)SPILL_READ_BUFFER_SIZE, reader->end - reader->pos);
+	    if ( count <= 0 ) return -1;
+	    count = pread( reader->fd, reader->buf, count, reader->pos );
+	    if ( count <= 0 ) return -1;
+	    reader->pos += count;
+	    reader->cursor = 0;
+	    reader->datasize = count;
+	}
+	int part = MIN(size, reader->datasize - reader->cursor);
+	memcpy( dest, reader->buf + reader->cursor, part );
+	reader->cursor += part;
+	dest += part;
+	size -= part;
+    }
+    return 0;
+}
+
+/*read data of spilled item, log error and return -1 from caller if
+ *spill file can't be read*/
+#define SPILL_READ_OR_FAIL(reader, data, size )				\
+    do{									\
+	if ( SpillReaderRead( (reader), (data), (size) ) != 0 ){	\
+	    WRITE_FMT_LOG( "spill file read error at %lld, %d bytes\n",	\
+			   (long long)(reader)->pos, (int)(size) );	\
+	    return -1;							\
 	}								\
-	/*reset merge buffers*/						\
-	free(merge_buffers_p), merge_buffers_p = NULL;			\
-	count_buffers=0;						\
+    }while(0)
+
+/*Read next item of spilled run, format is the same as used by
+ *BufferedWriteSingleMrItem, key and value are owned by item.
+ *@return 1 if item was read, 0 if run is complete, -1 if spill file
+ *can't be read, then item data must be freed by FreeMrItemData*/
+static int
+SpillReaderNextItem( struct MapReduceUserIf *mif, struct SpillReader *reader, 
+		     ElasticBufItemData* item ){
+    if ( !reader->items_left ) return 0;
+    reader->items_left--;
+    item->own_key = item->own_value = EDataNotOwned;
+    SPILL_READ_OR_FAIL( reader, &item->key_data.size, sizeof(item->key_data.size) );
+    item->key_data.addr = (uintptr_t)malloc(item->key_data.size);
+    item->own_key = EDataOwned;
+    SPILL_READ_OR_FAIL( reader, (void*)item->key_data.addr, item->key_data.size );
+    if ( mif->data.value_addr_is_data ){
+	SPILL_READ_OR_FAIL( reader, &item->value.addr, sizeof(item->value.addr) );
+	item->value.size = 0;
+    }
+    else{
+	SPILL_READ_OR_FAIL( reader, &item->value.size, sizeof(item->value.size) );
+	item->value.addr = (uintptr_t)malloc(item->value.size);
+	item->own_value = EDataOwned;
+	SPILL_READ_OR_FAIL( reader, (void*)item->value.addr, item->value.size );
+    }
+    SPILL_READ_OR_FAIL( reader, &item->key_hash, HASH_SIZE(mif) );
+    return 1;
+}
+
+/*Apply Combine, Reduce to sorted batch and free batch data*/
+static void
+ReduceBatch( struct MapReduceUserIf *mif, Buffer *batch ){
+    WRITE_FMT_LOG( "Reduce batch : %d items\n", (int)batch->header.count );
+    if ( mif->Combine ){
+	Buffer combined;
+	int granularity = batch->header.count>0? batch->header.count/3 : 1000;
+	int ret = AllocBuffer( &combined, MRITEM_SIZE(mif), granularity );
+	IF_ALLOC_ERROR(ret);
+	mif->Combine( batch, &combined );
+	if ( mif->Reduce )
+	    mif->Reduce( &combined );
+	FreeBufferData( &combined );
+    }
+    else if ( mif->Reduce ){
+	mif->Reduce( batch );
+    }
+    FreeMrItemsData( mif, batch );
+    batch->header.count = 0;
+}
+
+/*Merge spilled runs reading them by portions, and pass merged data to
+ *Combine and Reduce by sorted batches of batch_bytes size, items with
+ *equal hashes are never divided between batches
+ *@return 0 if ok, -1 if spill file can't be read*/
+static int
+ReduceSpilledRuns( struct MapReduceUserIf *mif, struct ReduceRuns *runs, 
+		   size_t batch_bytes ){
+    int count = runs->spilled_count;
+    struct SpillReader readers[count];
+    const ElasticBufItemData* current[count];
+    int heap[count];
+    int heap_size = 0;
+    int reduce_calls = 0;
+    int res = 0;
+    size_t item_size = MRITEM_SIZE(mif);
+    char *items = malloc( count*item_size );
+    char *read_buffers = malloc( count*SPILL_READ_BUFFER_SIZE );
+    IF_ALLOC_ERROR( items && read_buffers ? 0 : count*SPILL_READ_BUFFER_SIZE );
+
+    Buffer batch;
+    size_t batch_size = 0;
+    int ret = AllocBuffer( &batch, item_size, 1000 );
+    IF_ALLOC_ERROR(ret);
+
+    for ( int i=0; i < count; i++ ){
+	readers[i].fd = runs->spill_fd;
+	readers[i].pos = runs->spilled[i].offset;
+	readers[i].end = runs->spilled[i].offset + runs->spilled[i].size;
+	readers[i].items_left = runs->spilled[i].count;
+	readers[i].buf = read_buffers + i*SPILL_READ_BUFFER_SIZE;
+	readers[i].cursor = readers[i].datasize = 0;
+	current[i] = (const ElasticBufItemData*)(items + i*item_size);
+	res = SpillReaderNextItem( mif, &readers[i], (ElasticBufItemData*)current[i] );
+	if ( res < 0 ){
+	    FreeMrItemData( mif, (ElasticBufItemData*)current[i] );
+	    break;
+	}
+	if ( res > 0 )
+	    heap[heap_size++] = i;
+	res = 0;
     }
+    if ( res == 0 )
+	MergeHeapBuild( mif, current, heap, heap_size );
+
+    while( res == 0 && heap_size > 0 ){
+	int min_run = heap[0];
+	const ElasticBufItemData* item = current[min_run];
+	/*batch is complete, if next item has another hash*/
+	if ( batch_size >= batch_bytes && 
+	     HASH_CMP( mif, 
+		       &((const ElasticBufItemData*)
+			 BufferItemPointer(&batch, batch.header.count-1))->key_hash,
+		       &item->key_hash ) != 0 ){
+	    ReduceBatch( mif, &batch );
+	    reduce_calls++;
+	    batch_size = 0;
+	}
+	AddBufferItem( &batch, item );
+	batch_size += item_size + item->key_data.size;
+	if( !mif->data.value_addr_is_data )
+	    batch_size += item->value.size;
 
+	/*remove complete run from heap*/
+	res = SpillReaderNextItem( mif, &readers[min_run], (ElasticBufItemData*)item );
+	if ( res < 0 ){
+	    FreeMrItemData( mif, (ElasticBufItemData*)item );
+	    heap[0] = heap[--heap_size];
+	    break;
+	}
+	if ( res == 0 )
+	    heap[0] = heap[--heap_size];
+	res = 0;
+	MergeHeapSiftDown( mif, current, heap, heap_size, 0 );
+    }
+    if ( res < 0 ){
+	/*spill is broken, drop read data without reducing it*/
+	WRITE_FMT_LOG( "reduce of %d spilled runs failed\n", count );
+	for ( int i=0; i < heap_size; i++ )
+	    FreeMrItemData( mif, (ElasticBufItemData*)current[heap[i]] );
+	FreeMrItemsData( mif, &batch );
+    }
+    else if ( batch.header.count > 0 || !reduce_calls ){
+	ReduceBatch( mif, &batch );
+	reduce_calls++;
+    }
+    WRITE_FMT_LOG( "%d spilled runs reduced by %d batches\n", count, reduce_calls );
+    FreeBufferData( &batch );
+    free(items);
+    free(read_buffers);
+    return res;
+}
+
+/*Merge and combine runs while any level has merge_runs runs. If memory
+ *budget exceeded then merge all runs into single one and spill it into
+ *file if spill is used. Runs are merged only if Combine defined or spill
+ *is used, otherwise merge doesn't reduce data and single merge will done
+ *at the end*/
+static void
+ReduceRunsCompact( struct MapReduceUserIf *mif, struct ReduceRuns *runs ){
+    Buffer merged;
+    int level, level_count, max_level;
+    int merge_runs = runs->merge_runs;
+    size_t memory_budget = runs->memory_budget;
+    int spill = runs->spill_fd >= 0;
+    if ( !mif->Combine && !spill ){
+	/*merge doesn't reduce data, so budget can't be kept*/
+	if ( memory_budget > 0 && runs->all_bytes > memory_budget )
+	    WRITE_FMT_LOG( "runs occupied %u bytes, memory budget %u exceeded, "
+			   "it can't be kept without Combine or spill\n", 
+			   (uint32_t)runs->all_bytes, (uint32_t)memory_budget );
+	return;
+    }
+
+    for ( level=0; mif->Combine; level++ ){
+	level_count = max_level = 0;
+	for ( int i=0; i < runs->count; i++ ){
+	    if ( runs->levels[i] == level ) level_count++;
+	    if ( runs->levels[i] > max_level ) max_level = runs->levels[i];
+	}
+	if ( level > max_level ) break;
+	if ( level_count >= merge_runs ){
+	    ReduceRunsMerge( mif, runs, level, &merged );
+	    ReduceRunsAdd( mif, runs, &merged, level+1 );
+	}
+    }
+
+    if ( memory_budget > 0 && runs->all_bytes > memory_budget && 
+	 (runs->count > 1 || spill) ){
+	WRITE_FMT_LOG( "runs occupied %u bytes, memory budget %u exceeded\n", 
+		       (uint32_t)runs->all_bytes, (uint32_t)memory_budget );
+	max_level = 0;
+	for ( int i=0; i < runs->count; i++ ){
+	    if ( runs->levels[i] > max_level ) max_level = runs->levels[i];
+	}
+	ReduceRunsMerge( mif, runs, -1, &merged );
+	if ( spill )
+	    ReduceRunsSpill( mif, runs, &merged );
+	else{
+	    ReduceRunsAdd( mif, runs, &merged, max_level+1 );
+	    if ( runs->all_bytes > memory_budget )
+		WRITE_FMT_LOG( "combined run occupied %u bytes, memory budget %u "
+			       "can't be kept without spill\n", 
+			       (uint32_t)runs->all_bytes, (uint32_t)memory_budget );
+	}
+    }
+}
+
+
+/*Init empty runs list, settings of merge and spill are read from
+ *environment variables*/
+static void
+ReduceRunsInit( struct ReduceRuns *runs ){
+    memset( runs, '\0', sizeof(*runs) );
+    runs->merge_runs = DEFAULT_REDUCE_MERGE_RUNS;
+    if ( getenv(REDUCE_MERGE_RUNS_ENV) )
+	runs->merge_runs = atoi(getenv(REDUCE_MERGE_RUNS_ENV));
+    if ( runs->merge_runs < 2 )
+	runs->merge_runs = 2;
+    if ( getenv(REDUCE_MEMORY_BUDGET_ENV) )
+	runs->memory_budget = strtoul(getenv(REDUCE_MEMORY_BUDGET_ENV), NULL, 10);
+    WRITE_FMT_LOG( "REDUCE_MERGE_RUNS=%d, REDUCE_MEMORY_BUDGET=%u\n", 
+		   runs->merge_runs, (uint32_t)runs->memory_budget );
+
+    runs->spill_fd = -1;
+    /*spill is used only under memory budget*/
+    if ( getenv(REDUCE_SPILL_PATH_ENV) && runs->memory_budget > 0 ){
+	/*data of previous session is dropped; channels can't be
+	  truncated, spilled data is read only at offsets written*/
+	runs->spill_fd = open( getenv(REDUCE_SPILL_PATH_ENV), O_RDWR|O_CREAT|O_TRUNC, 
+			       S_IRUSR|S_IWUSR );
+	if ( runs->spill_fd < 0 )
+	    runs->spill_fd = open( getenv(REDUCE_SPILL_PATH_ENV), O_RDWR );
+	WRITE_FMT_LOG( "REDUCE_SPILL_PATH=%s, fd=%d\n", 
+		       getenv(REDUCE_SPILL_PATH_ENV), runs->spill_fd );
+	assert( runs->spill_fd >= 0 );
+    }
+}
+
+/*Final merge of all runs and Reduce, runs list is freed
+ *@return 0 if ok, -1 if spilled runs can't be read*/
+static int
+ReduceRunsFinish( struct MapReduceUserIf *mif, struct ReduceRuns *runs ){
+    /*Buffer for sorted*/
+    Buffer all; memset( &all, '\0', sizeof(all) );
+    int res = 0;
+    if ( runs->spilled_count > 0 ){
+	/*data doesn't fit memory, spill the rest of runs and reduce all
+	 *spilled runs by sorted batches, Reduce is called for every batch*/
+	if ( runs->count > 0 ){
+	    ReduceRunsMerge( mif, runs, -1, &all );
+	    ReduceRunsSpill( mif, runs, &all );
+	}
+	res = ReduceSpilledRuns( mif, runs, runs->memory_budget );
+    }
+    else{
+	/*final merge of all runs, single already combined run is used as is*/
+	if ( runs->count == 1 && mif->Combine && runs->levels[0] > 0 ){
+	    all = runs->runs[0];
+	    runs->count = 0;
+	}
+	else{
+	    ReduceRunsMerge( mif, runs, -1, &all );
+	}
+
+	if( mif->Reduce ){
+	    /*user should output data into output file/s*/
+	    WRITE_FMT_LOG( "Reduce : %d items, data=%p\n", (int)all.header.count, all.data );
+	    mif->Reduce( &all );
+	}
+    }
+    if ( runs->spill_fd >= 0 )
+	close( runs->spill_fd );
+    free(runs->runs);
+    free(runs->levels);
+    free(runs->bytes);
+    free(runs->spilled);
+    FreeBufferData(&all);
+    return res;
+}
+
+int
+ReduceRunsLocalProcessing( struct MapReduceUserIf *mif, 
+			   Buffer *runs_array, int runs_count, int runs_per_round ){
+    struct ReduceRuns runs;
+    ReduceRunsInit( &runs );
+    for ( int i=0; i < runs_count; i++ ){
+	if ( runs_array[i].header.count > 0 )
+	    ReduceRunsAdd( mif, &runs, &runs_array[i], 0 );
+	else
+	    FreeBufferData(&runs_array[i]);
+	/*compact runs after every round as reducer node does*/
+	if ( (i+1) % runs_per_round == 0 || i+1 == runs_count )
+	    ReduceRunsCompact( mif, &runs );
+    }
+    return ReduceRunsFinish( mif, &runs );
+}
 
 int 
 ReduceNodeMain( struct MapReduceUserIf *mif, 
@@ -1082,14 +2358,11 @@ ReduceNodeMain( struct MapReduceUserIf *mif,
     int *map_nodes_list = NULL;
     int map_nodes_count = chif->GetNodesListByType( chif, EMapNode, &map_nodes_list);
 
-    /*buffers_for_merge is an arrays received from Mappers to be merged 
-     *it will grow runtime */
-    Buffer *merge_buffers = NULL;
-    int merge_buffers_count=0;
-    /*Buffer for merge*/
-    Buffer merged;
-    /*Buffer for sorted*/
-    Buffer all; memset( &all, '\0', sizeof(all) );
+    /*sorted runs received from Mappers, it will grow runtime*/
+    struct ReduceRuns runs;
+    ReduceRunsInit( &runs );
+    /*Buffer received from map node, its keys, values are in its arena*/
+    Buffer received;
 
     int excluded_map_nodes[map_nodes_count];
     memset( excluded_map_nodes, '\0', sizeof(excluded_map_nodes) );
@@ -1107,13 +2380,16 @@ ReduceNodeMain( struct MapReduceUserIf *mif,
 		WRITE_FMT_LOG( "Read [%d]map#%d, fdr=%d\n", 
 			       i, map_nodes_list[i], channel->fd );
 
-		/*grow array of buffers, and always receive items into new buffer*/
-		merge_buffers = realloc( merge_buffers, 
-					 (++merge_buffers_count)*sizeof(Buffer) );
+		/*always receive items into new buffer*/
 		excluded_map_nodes[i] 
 		    = RecvDataFromSingleMap( mif, 
 					     channel->fd, 
-					     &merge_buffers[merge_buffers_count-1] );
+					     &received );
+		/*received data is sorted run, empty data is not needed*/
+		if ( received.header.count > 0 )
+		    ReduceRunsAdd( mif, &runs, &received, 0 );
+		else
+		    FreeBufferData(&received);
 		
 		/*set next wait loop condition*/
 		if ( excluded_map_nodes[i] != MAP_NODE_EXCLUDE ){
@@ -1124,45 +2400,20 @@ ReduceNodeMain( struct MapReduceUserIf *mif,
 	}//for
 
 	/**********************************************************/
-	/*combine data every time while it receives from map nodes*/
-	if ( mif->Combine ){
-	    MERGE_PREVIOUS_AND_NEW(mif, merge_buffers, merge_buffers_count, all, merged );
-
-	    int granularity = all.header.count>0? all.header.count/3 : 1000;
-	    int ret = AllocBuffer( &all, MRITEM_SIZE(mif), granularity );
-	    IF_ALLOC_ERROR(ret);
-
-	    WRITE_LOG_BUFFER(mif,merged);
-	    WRITE_FMT_LOG( "keys count before Combine: %d\n", 
-			   (int)merged.header.count );
-	    mif->Combine( &merged, &all );
-	    FreeBufferData( &merged );
-	    WRITE_FMT_LOG( "keys count after Combine: %d\n", (int)all.header.count );
-	    WRITE_LOG_BUFFER(mif,all);
-	}else{
-	    WRITE_LOG( "Combine function not defined and skipped" );
-	}
+	/*combine data only when enough runs received from map nodes*/
+	ReduceRunsCompact( mif, &runs );
+	WRITE_FMT_LOG( "runs count=%d, occupied %u bytes\n", 
+		       runs.count, (uint32_t)runs.all_bytes );
 	WRITE_FMT_LOG("sbrk()=%p\n", (void*)sbrk(0) );
     }while( leave_map_nodes != 0 );
 
-    /*do merge only once if Combine not defined*/
-    if ( !mif->Combine ){
-	MERGE_PREVIOUS_AND_NEW(mif, merge_buffers, merge_buffers_count, all, merged );
-	/*assign data from 'merged' buffer into 'all' buffer*/
-	FreeBufferData(&all);
-	all = merged;
-    }
-
-    if( mif->Reduce ){
-	/*user should output data into output file/s*/
-	WRITE_FMT_LOG( "Reduce : %d items, data=%p\n", (int)all.header.count, all.data );
-	mif->Reduce( &all );
-    }
-
+    int res = ReduceRunsFinish( mif, &runs );
     free(map_nodes_list);
-    FreeBufferData(&all);
 
-    WRITE_LOG("ReduceNodeMain Complete\n");
-    return 0;
+    WRITE_FMT_LOG( "ReduceNodeMain received baskets: raw bytes=%llu, wire bytes=%llu\n",
+		   (unsigned long long)mif->data.basket_raw_bytes, 
+		   (unsigned long long)mif->data.basket_wire_bytes );
+    WRITE_FMT_LOG("ReduceNodeMain Complete, res=%d\n", res);
+    return res;
 }
 
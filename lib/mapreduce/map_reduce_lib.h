@@ -21,17 +21,35 @@
 #define __MAP_REDUCE_LIB_H__
 
 #include "map_reduce_datatypes.h"
+#include "block_codec.h"
 
 //forward decl
 struct ChannelsConfigInterface;
+struct BufferedIOWrite;
 
 enum { EMapNode=1, EReduceNode=2, EInputOutputNode=3 };
 
 #define MIN(a,b) (a < b ? a : b )
+#define MAX(a,b) (a < b ? b : a )
 
 #define SEND_BUFFER_SIZE             0x200000 //2MB
 #define DEFAULT_MAP_CHUNK_SIZE_BYTES 0x100000 //1MB
 #define MAP_CHUNK_SIZE_ENV           "MAP_CHUNK_SIZE"
+/*if non zero then map node sends chunk to reducers by separate thread
+  while next chunk is read and mapped*/
+#define MAP_PIPELINE_ENV             "MAP_PIPELINE"
+/*reducer merges and combines received sorted runs only when count of
+  runs of the same level reaches REDUCE_MERGE_RUNS*/
+#define DEFAULT_REDUCE_MERGE_RUNS    8
+#define REDUCE_MERGE_RUNS_ENV        "REDUCE_MERGE_RUNS"
+/*bytes, reducer merges all runs if they are occupied more, 0 - no limit*/
+#define REDUCE_MEMORY_BUDGET_ENV     "REDUCE_MEMORY_BUDGET"
+/*file for spilling of reducer runs if memory budget exceeded, it can
+  be random access channel or file in writable filesystem*/
+#define REDUCE_SPILL_PATH_ENV        "REDUCE_SPILL_PATH"
+#define SPILL_READ_BUFFER_SIZE       0x10000 //64KB
+/*items count in weighted sample of every map node per reducer*/
+#define PARTITION_SAMPLES_PER_REDUCER 100
 
 /*Init MapReduceUserIf existing pointer object and get it ready to use
   comparator_f - if user provides NULL then default comparator will used */
@@ -48,8 +66,42 @@ enum { EMapNode=1, EReduceNode=2, EInputOutputNode=3 };
 	(mif_p)->data.value_addr_is_data = (val_addr_is_data);		\
 	(mif_p)->data.mr_item_size = item_size;				\
 	(mif_p)->data.hash_size = (h_size);				\
+	(mif_p)->data.hash_order = EHashOrderUnknown;			\
+	(mif_p)->data.basket_codec = NULL;				\
+	(mif_p)->data.basket_raw_bytes = 0;				\
+	(mif_p)->data.basket_wire_bytes = 0;				\
+	(mif_p)->data.partitioner = EPartitionerHistogram;		\
+	(mif_p)->data.combine_associative = 0;				\
+	(mif_p)->data.reducers_bytes = NULL;				\
+	(mif_p)->MergeValues = NULL;					\
     }
 
+/*Set order of hashes compared by user ComparatorHash to get LocalSort
+ *faster, hash_order_v is one of EHashOrderBytes, EHashOrderUint*/
+#define SET_MAPREDUCE_HASH_ORDER(mif_p, hash_order_v)	\
+    (mif_p)->data.hash_order = (hash_order_v);
+
+/*Enable compression of map to reduce traffic by codec_p, for example
+ *&LzBlockCodec, NULL disables it. It's worth for network bound jobs,
+ *compare data.basket_raw_bytes and data.basket_wire_bytes*/
+#define SET_MAPREDUCE_BASKET_CODEC(mif_p, codec_p)	\
+    (mif_p)->data.basket_codec = (codec_p);
+
+/*Aggregate map items having equal keys by hash table and user
+ *merge_values_f before sorting, instead of sort and Combine. It's
+ *faster for jobs having few distinct keys in chunk, like word count.
+ *Reducer still uses Combine*/
+#define SET_MAPREDUCE_HASH_COMBINER(mif_p, merge_values_f)	\
+    (mif_p)->MergeValues = (merge_values_f);
+
+/*Set partitioner of map data between reducers, partitioner_v is one of
+ *EPartitionerHistogram, EPartitionerSampling; If combine_assoc_v is non
+ *zero then sampling partitioner splits hot keys between several
+ *reducers, so the same key can be reduced by several reducers*/
+#define SET_MAPREDUCE_PARTITIONER(mif_p, partitioner_v, combine_assoc_v)	\
+    (mif_p)->data.partitioner = (partitioner_v);			\
+    (mif_p)->data.combine_associative = (combine_assoc_v);
+
 
 struct MapReduceUserIf{
     /* read input buffer, allocate and fill keys & values arrays.
@@ -74,6 +126,11 @@ struct MapReduceUserIf{
     /*function converts hash to a string can be overrided by user, otherwise library 
       will use own. It's function used by library for test purposes*/
     char* (*DebugHashAsString)( char* str, const uint8_t* hash, int size);
+    /*optional, merge value of src item into dest item having the same key,
+     *data owned by src is freed by library after call. If it's set then
+     *map node aggregates items by hash table before sorting and uses it
+     *instead of Combine, see SET_MAPREDUCE_HASH_COMBINER*/
+    void (*MergeValues)( ElasticBufItemData *dest, ElasticBufItemData *src );
     /*data*/
     struct MapReduceData data;
 };
@@ -110,7 +167,52 @@ GetReducersDividerArrayBasedOnSummarizedHistograms( struct MapReduceUserIf *mif,
 						    int histograms_count, 
 						    Buffer *divider_array );
 
-/*Sort Buffer array using mritem comparator provided by mif*/
+/*Get weighted reservoir sample of map items into histogram->buffer,
+ *sample item is a hash followed by uint64_t estimated weight of items
+ *it represents, item weight is a size of its data. Sample is sorted by
+ *hash, histogram steps are not used.
+ *@return count of items in sample*/
+size_t
+GetWeightedSample( struct MapReduceUserIf *mif,
+		   const Buffer* map,
+		   int sample_size, 
+		   Histogram *histogram );
+
+/*Create dividers list by weighted samples of all map nodes, so that
+ *every reducer gets about the same weight of data. Hot keys having
+ *weight more than reducer share are logged, and if
+ *mif->data.combine_associative is set then hot key divider is repeated
+ *for several reducers, see DistributeDataIntoBaskets*/
+void 
+GetReducersDividerArrayBasedOnSamples( struct MapReduceUserIf *mif,
+				       Histogram *samples, 
+				       int samples_count, 
+				       Buffer *divider_array );
+
+/*range of map items sent to single reducer*/
+struct BasketInfo{
+    int data_start_index;
+    int count_in_section;
+};
+
+/*Depend on mif->data.dividers_list calculate index of beginning item
+ *and items count of sorted map for every reducer. Items having hash of
+ *divider repeated for several reducers are split evenly between them.
+ *@return array of basket_count items, should be freed by caller*/
+struct BasketInfo* 
+DistributeDataIntoBaskets( struct MapReduceUserIf *mif, 
+			   const Buffer *map,
+			   int basket_count );
+
+/*Aggregate items of map having equal key hash and key data by
+ *mif->MergeValues, items are compacted in place and keep order of the
+ *first item of every key
+ *@return items count after aggregation*/
+size_t
+HashAggregate( struct MapReduceUserIf *mif, Buffer *map );
+
+/*Sort Buffer array using mritem comparator provided by mif, or by radix
+ *sort of hash prefixes if mif->data.hash_order is known*/
 void 
 LocalSort( struct MapReduceUserIf *mif, Buffer *sortable );
 
@@ -123,6 +225,37 @@ MapInputDataLocalProcessing( struct MapReduceUserIf *mif,
 			     int last_chunk, 
 			     Buffer *result );
 
+/*Reduce sorted runs locally the same way as reducer node reduces runs
+ *received from map nodes: runs are added by rounds of runs_per_round
+ *runs, merged and combined by levels after every round, and finally
+ *Reduce is called; REDUCE_MERGE_RUNS, REDUCE_MEMORY_BUDGET,
+ *REDUCE_SPILL_PATH environment variables are used as well. Runs data
+ *is owned by function and runs_array items are reset
+ *@return 0 if ok, -1 if spilled runs can't be read back*/
+int
+ReduceRunsLocalProcessing( struct MapReduceUserIf *mif, 
+			   Buffer *runs_array, int runs_count, int runs_per_round );
+
+/*Write basket of items_count items of sorted map starting from
+ *data_start_index into fdw by framed wire format: header, items array
+ *and arena of keys, values, compressed by data.basket_codec if it's set*/
+void 
+WriteDataToReduce( struct MapReduceUserIf *mif,
+		   struct BufferedIOWrite* bio, 
+		   int fdw, 
+		   const Buffer *map, 
+		   int data_start_index, 
+		   int items_count,
+		   int last_data_flag );
+
+/*Read basket written by WriteDataToReduce into uninitialized map buffer,
+ *keys and values are located in arena of map buffer
+ *@return last_data_flag of basket*/
+int
+RecvDataFromSingleMap( struct MapReduceUserIf *mif,
+		       int fdr,
+		       Buffer *map );
+
 /*Merge source_arrays data into dest array, new array will contain all items
   from source arrays in sorted order*/
 void 
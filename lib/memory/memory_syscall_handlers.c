@@ -32,8 +32,13 @@
 #include "zrt_helper_macros.h"
 #include "memory_syscall_handlers.h"
 #include "bitarray.h"
+#include "zrtapi.h" //MREMAP_MAYMOVE
 
 #define MEMORY_PAGE_FROM_INDEX(memory_if_p, index) ( MMAP_HIGHEST_PAGE_ADDR(memory_if_p) - index*PAGE_SIZE)
+/*index of bit related to page located at addr, pages of mapping
+  [addr, addr+N*PAGE_SIZE) are related to bits [index-N+1, index]*/
+#define MEMORY_INDEX_FROM_PAGE(memory_if_p, addr) ((MMAP_HIGHEST_PAGE_ADDR(memory_if_p) - (addr)) / PAGE_SIZE)
+#define PAGES_COUNT(size) (ROUND_UP(size, PAGE_SIZE)/PAGE_SIZE)
 
 
 #define NO_ADDR_OVERLAP(low_addr, high_addr) (low_addr) < (high_addr) ? 1 : 0
@@ -73,15 +78,67 @@
 
 static struct MemoryManager KMemoryManager;
 
+/*@return the highest index of bit related to page located upper than
+ *brk, or -1 if there are no such pages*/
+static int mmap_index_limit(struct MemoryManager* mem_if_p){
+    if ( mem_if_p->heap_brk > MMAP_HIGHEST_PAGE_ADDR(mem_if_p) ) return -1;
+    int limit = MEMORY_INDEX_FROM_PAGE(mem_if_p, mem_if_p->heap_brk);
+    return limit < mem_if_p->bitarray.bits_count ? limit : mem_if_p->bitarray.bits_count-1;
+}
+
+/*@return index of the smallest sequence of free pages located upper
+ *than brk that is not less than pages count, or -1*/
+static int search_bestfit_index(struct MemoryManager* mem_if_p, int pages){
+    struct BitArrayPublicInterface* bitarray= (struct BitArrayPublicInterface*)&mem_if_p->bitarray;
+    int limit = mmap_index_limit(mem_if_p);
+    int index = 0, run_begin, len, best_index = -1, best_len = 0;
+    while ( index <= limit &&
+	    (len = bitarray->search_emptybit_run(bitarray, index, &run_begin)) > 0 &&
+	    run_begin <= limit ){
+	if ( run_begin+len-1 > limit ) len = limit-run_begin+1;
+	if ( len >= pages && (best_index == -1 || len < best_len) ){
+	    best_index = run_begin;
+	    best_len = len;
+	    if ( len == pages ) break;
+	}
+	index = run_begin+len;
+    }
+    return best_index;
+}
+
+/*Set heap_lowest_mmap_addr to the lowest mapped page after unmapping,
+ *so brk is able to grow up to it*/
+static void update_lowest_mmap_addr(struct MemoryManager* mem_if_p){
+    struct BitArrayPublicInterface* bitarray= (struct BitArrayPublicInterface*)&mem_if_p->bitarray;
+    int bits_count = mem_if_p->bitarray.bits_count;
+    int index = 0, run_begin, len, highest_mapped = bits_count-1;
+    /*free sequence reaching the end of bitarray is located just upper
+      than brk*/
+    while ( (len = bitarray->search_emptybit_run(bitarray, index, &run_begin)) > 0 ){
+	index = run_begin+len;
+	if ( index == bits_count ){
+	    highest_mapped = run_begin-1;
+	    break;
+	}
+    }
+    if ( highest_mapped >= 0 )
+	mem_if_p->heap_lowest_mmap_addr = MEMORY_PAGE_FROM_INDEX(mem_if_p, highest_mapped);
+    else
+	mem_if_p->heap_lowest_mmap_addr = MMAP_HIGHEST_PAGE_ADDR(mem_if_p);
+}
+
 static void* alloc_memory_pseudo_mmap(struct MemoryManager* mem_if_p, 
 				      size_t memsize){ 
-    int i;
     void* ret_addr = NULL;
     struct BitArrayPublicInterface* bitarray= (struct BitArrayPublicInterface*)&mem_if_p->bitarray;
     int map_pages_requested = ROUND_UP(memsize, PAGE_SIZE)/PAGE_SIZE;
 
     /*search for sequence of free pages starting from end*/
-    int mmap_index = bitarray->search_emptybit_sequence_begin(bitarray, 0, map_pages_requested); 
+    int mmap_index;
+    if ( mem_if_p->mmap_policy == EMmapPolicyBestFit )
+	mmap_index = search_bestfit_index(mem_if_p, map_pages_requested);
+    else
+	mmap_index = bitarray->search_emptybit_sequence_begin(bitarray, 0, map_pages_requested); 
     int mmap_low_page_index = mmap_index+ map_pages_requested-1;
 
     /*if indexes of map pages seems to be valid*/
@@ -102,12 +159,7 @@ static void* alloc_memory_pseudo_mmap(struct MemoryManager* mem_if_p,
 	    assert(low_page_memory_addr <= high_page_memory_addr);
 	    
 	    /*mark map chunks corresponding to returning block of memory*/
-	    int current_chunk_index;
-	    for ( i=0; i < map_pages_requested; i++ ){
-		current_chunk_index = mmap_index+i;
-		LOG_DEBUG(ELogIndex, current_chunk_index, "mark chunk as used" );
-		bitarray->toggle_bit(bitarray, current_chunk_index);
-	    }
+	    bitarray->set_range(bitarray, mmap_index, map_pages_requested);
 	    ZRT_LOG(L_SHORT, "PSEUDO_MMAP(%u) ret addr=%p", memsize, ret_addr ); 
 	}
 	else{
@@ -122,6 +174,29 @@ static void* alloc_memory_pseudo_mmap(struct MemoryManager* mem_if_p,
 }
 
 
+/*Mark pages of range [addr, addr+memsize) as mapped regardless of
+ *their previous state, range must be located upper than brk
+ *@return addr, or NULL if range is not valid*/
+static void* alloc_memory_fixed_mmap(struct MemoryManager* mem_if_p, 
+				     void* addr, size_t memsize){
+    struct BitArrayPublicInterface* bitarray= (struct BitArrayPublicInterface*)&mem_if_p->bitarray;
+    int pages = PAGES_COUNT(memsize);
+    if ( (uintptr_t)addr != ROUND_UP((uintptr_t)addr, PAGE_SIZE) ||
+	 addr < mem_if_p->heap_brk || 
+	 addr+pages*PAGE_SIZE > HEAP_MAX_ADDR(mem_if_p->heap_start_ptr, mem_if_p->heap_size) ){
+	ZRT_LOG(L_SHORT, "PSEUDO_MMAP fixed addr=%p, size=%u is not valid", addr, memsize );
+	return NULL;
+    }
+    int index = MEMORY_INDEX_FROM_PAGE(mem_if_p, addr);
+    if ( index >= mem_if_p->bitarray.bits_count ){
+	ZRT_LOG(L_SHORT, "PSEUDO_MMAP fixed addr=%p is out of mmap region", addr );
+	return NULL;
+    }
+    bitarray->set_range(bitarray, index-pages+1, pages);
+    ZRT_LOG(L_SHORT, "PSEUDO_MMAP fixed(%u) ret addr=%p", memsize, addr );
+    return addr;
+}
+
 /*return aligned value that multiple of the power of 2*/
 static size_t roundup_pow2(size_t value){
     size_t bit_mask_after_hi(size_t x);
@@ -139,40 +214,36 @@ size_t bit_mask_after_hi(size_t x)
 }
 
 static void
-memory_init(struct MemoryManager* this, 
+memory_init(struct MemoryManagerPublicInterface* this_public, 
 	    void *heap_ptr, size_t heap_size, void *brk){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
     /*save data into this object*/
     this->heap_start_ptr = heap_ptr;
     this->heap_size = heap_size;
     this->heap_brk = brk;  /*current brk*/
     this->heap_lowest_mmap_addr = MMAP_HIGHEST_PAGE_ADDR(this);
+    this->mmap_policy = EMmapPolicyFirstFit;
 
   SELF_CHECK;
 
-    /*test*/
-    int temp;
     /*constants*/
     const int mmap_pages_count = MMAP_REGION_SIZE_ALIGNED_(heap_ptr, brk, heap_size) / PAGE_SIZE;
-    /*init array used to store status of chunks for mmap/munmap.
-     *keep in mind that pages quantity can be not multiple on 8*/
-    const int bit_array_size = mmap_pages_count/8 + ( mmap_pages_count%8>0?1:0 ); 
-    temp=mmap_pages_count/8; temp += mmap_pages_count%8>0?1:0;
-    LOG_DEBUG(ELogSize, bit_array_size, "bitarray actual size in bytes" );
-    /*remove it if working*/
-    assert(bit_array_size==temp);
+    LOG_DEBUG(ELogCount, mmap_pages_count, "bitarray bits count" );
+    assert(mmap_pages_count <= MAX_MMAP_PAGES_COUNT);
 
     /*Create and init bit array
-      set (1)external array as storage, (2)array size and 
+      set (1)external array as storage, (2)bits count and 
       (3)bitarray pointer to get resulted object*/
     CONSTRUCT_L(BIT_ARRAY) ( this->map_chunks_bit_array, /*(1)*/
-			     bit_array_size,             /*(2)*/
+			     mmap_pages_count,           /*(2)*/
 			     &this->bitarray );          /*(3)*/
 }
 
 
 /**/
 static void* 
-memory_sysbrk(struct MemoryManager* this, void *addr){
+memory_sysbrk(struct MemoryManagerPublicInterface* this_public, void *addr){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
     /*if requested addr is in range of available heap range then it's
       would be returned as heap bound*/
     if ( addr < this->heap_start_ptr ){
@@ -191,45 +262,75 @@ memory_sysbrk(struct MemoryManager* this, void *addr){
     }
 }
 
+static int
+memory_munmap(struct MemoryManagerPublicInterface* this, void *addr, size_t length);
+
+/*Fill pages of file mapping by file data located in range [offset,
+ *offset+length), data is read by portions of MMAP_FILE_READ_CHUNK
+ *directly into mapping, so file of in-memory filesystem having data
+ *source reads its data from source channel without additional copy;
+ *The rest of pages after end of file is zeroed.
+ *@return 0 if OK, or errno*/
+static int
+mmap_file_data(void *addr, size_t length, int fd, off_t offset, off_t filesize){
+    char* dest = (char*)addr;
+    size_t data_len = 0;
+    if ( offset < filesize )
+	data_len = MIN( (off_t)length, filesize-offset );
+
+    while ( data_len > 0 ){
+	size_t part = MIN( data_len, MMAP_FILE_READ_CHUNK );
+	ssize_t readed = pread( fd, dest, part, offset );
+	if ( readed < 0 ){
+	    ZRT_LOG(L_ERROR, "file mmap read error, offset=%lld, errno=%d",
+		    (long long int)offset, errno);
+	    return errno ? errno : EIO;
+	}
+	else if ( readed == 0 ){
+	    break; /*file was truncated*/
+	}
+	dest += readed;
+	offset += readed;
+	data_len -= readed;
+    }
+    /*mapping beyond end of file reads zeros*/
+    memset( dest, '\0', ROUND_UP(length, PAGE_SIZE) - (dest - (char*)addr) );
+    return 0;
+}
+
 static void*
-memory_mmap(struct MemoryManager* this, void *addr, size_t length, int prot, 
+memory_mmap(struct MemoryManagerPublicInterface* this_public, void *addr, size_t length, int prot, 
 	    int flags, int fd, off_t offset){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
     void* alloc_addr = NULL;
     int errcode = 0;
     off_t wanted_mem_block_size = length;
     /* check for allowed case, if prot supplied at least with PROT_READ and fd param
      * passed seems to be correct then try to map file into memory*/
     if ( CHECK_FLAG(prot, PROT_READ) && fd > 0 ){
-	/*doing simple mmap, get stat for file descriptor, allocate memory
-	  and just read file into memory*/
+	/*get stat for file descriptor, allocate memory for requested
+	  length and read only mapped range of file into memory*/
 	struct stat st;
+	if ( length == 0 || offset < 0 ){
+	    errcode = EINVAL;
+	}
 	/*fstat is checking fd passed and get file size*/
-	if ( !fstat(fd, &st) ){
-	    /*min amount of memory here is PAGE_SIZE*/
-	    wanted_mem_block_size = st.st_size == 0 ? PAGE_SIZE : st.st_size;
-	    alloc_addr = alloc_memory_pseudo_mmap( this, wanted_mem_block_size );
+	else if ( !fstat(fd, &st) ){
+	    if ( CHECK_FLAG(flags, MAP_FIXED) )
+		alloc_addr = alloc_memory_fixed_mmap( this, addr, wanted_mem_block_size );
+	    else
+		alloc_addr = alloc_memory_pseudo_mmap( this, wanted_mem_block_size );
 	    if ( alloc_addr != NULL ){
-		errcode = 0;
-		/*create maping in memory just copying file contents starting from offset
-		 *synchronizing data with offset in memory, so at first get current file
-		 *offset and check with passed offset and if that equals then not do seek
-		 *to the required offset(it's suitable for sequential accessed files)*/
-		off_t current_offset = lseek(fd, 0, SEEK_CUR);
-		assert(current_offset!=-1);
-		if ( current_offset != offset ){
-		    current_offset = lseek(fd, offset, SEEK_SET);
-		    assert(current_offset!=-1);
+		errcode = mmap_file_data( alloc_addr, length, fd, offset, st.st_size );
+		if ( errcode != 0 ){
+		    memory_munmap( &this->public, alloc_addr, length );
+		    alloc_addr = NULL;
 		}
-		/*read into memory starting with offest*/
-		ssize_t mmap_data_len = st.st_size-offset;
-		ssize_t copied_bytes = read( fd, alloc_addr+offset, mmap_data_len );
-		/*file size returned by fstat should be the same as readed bytes count*/
-		assert( copied_bytes == mmap_data_len );
-		ZRT_LOG(L_INFO, "file mmap OK, mmap_data_len=%lld, filesize=%lld", 
-			(long long int)mmap_data_len, (long long int)st.st_size );
+		ZRT_LOG(L_INFO, "file mmap errcode=%d, length=%u, offset=%lld, filesize=%lld", 
+			errcode, length, (long long int)offset, (long long int)st.st_size );
 	    }
 	    else{
-		errcode = errno;
+		errcode = ENOMEM;
 	    }
 	}
 	/*fstat fail with passed fd value*/
@@ -248,11 +349,14 @@ memory_mmap(struct MemoryManager* this, void *addr, size_t length, int prot,
 	      CHECK_FLAG(flags, MAP_ANONYMOUS) &&
 #endif //__ZRT_HOST 
 	     length >0 ){
-	alloc_addr = alloc_memory_pseudo_mmap( this, wanted_mem_block_size );
-	if ( alloc_addr != NULL )
-	    errcode = 0;
-	else
-	    errcode = ENOMEM;
+	if ( CHECK_FLAG(flags, MAP_FIXED) ){
+	    alloc_addr = alloc_memory_fixed_mmap( this, addr, wanted_mem_block_size );
+	    errcode = alloc_addr != NULL ? 0 : EINVAL;
+	}
+	else{
+	    alloc_addr = alloc_memory_pseudo_mmap( this, wanted_mem_block_size );
+	    errcode = alloc_addr != NULL ? 0 : ENOMEM;
+	}
     } 
     /*if was supplied unsupported prot or flags params return -1; */
     else{
@@ -273,29 +377,33 @@ memory_mmap(struct MemoryManager* this, void *addr, size_t length, int prot,
 }
 
 static int
-memory_munmap(struct MemoryManager* this, void *addr, size_t length){
+memory_munmap(struct MemoryManagerPublicInterface* this_public, void *addr, size_t length){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
     errno=0;
-    /*if requested addr is in range of available heap range then it's
-      would be returned as heap bound*/
-    if ( addr >= MMAP_LOWEST_PAGE_ADDR(this) && addr <= MMAP_HIGHEST_PAGE_ADDR(this) ){
-	int i;
-	int munmap_begin_chunk_index = (MMAP_HIGHEST_PAGE_ADDR(this) - addr) / PAGE_SIZE;
-	int munmap_chnuks_count = ROUND_UP(length,PAGE_SIZE)/PAGE_SIZE;
-	LOG_DEBUG(ELogIndex, munmap_begin_chunk_index, "" );
-	LOG_DEBUG(ELogCount, munmap_chnuks_count, "" );
-
+    /*pages of range [addr, addr+length) located in mmap region*/
+    void* heap_end = HEAP_MAX_ADDR(this->heap_start_ptr, this->heap_size);
+    void* begin = (void*)((uintptr_t)addr & ~(PAGE_SIZE-1));
+    void* end = heap_end;
+    if ( length < (size_t)(heap_end - begin) )
+	end = (void*)ROUND_UP((uintptr_t)addr+length, PAGE_SIZE);
+    if ( end > heap_end ) end = heap_end;
+    if ( begin < MMAP_LOWEST_PAGE_ADDR(this) ) begin = MMAP_LOWEST_PAGE_ADDR(this);
+
+    if ( begin < end ){
 	struct BitArrayPublicInterface* bitarray = (struct BitArrayPublicInterface*)&this->bitarray;
-	/*unmap region chunk by chunk*/
-	for ( i=munmap_begin_chunk_index; i < munmap_begin_chunk_index+munmap_chnuks_count ; i++ ){
-	    int bit = bitarray->get_bit( bitarray, i);
-	    ZRT_LOG(L_SHORT, "bit index=%d value=%d", i, bit);
-	    if ( bit == 1 ){
-		bitarray->toggle_bit( bitarray, i);
-	    }
-	    else{
-		LOG_DEBUG(ELogAddress, addr, "indicated address does not contain maped region" )
-		    }
-	}
+	/*range is related to bits [index-count+1, index]*/
+	int index = MEMORY_INDEX_FROM_PAGE(this, begin);
+	int low_index = MEMORY_INDEX_FROM_PAGE(this, end-PAGE_SIZE);
+	if ( index >= this->bitarray.bits_count ) index = this->bitarray.bits_count-1;
+	int count = index-low_index+1;
+	int empty_bits = bitarray->count_empty_bits(bitarray);
+	bitarray->clear_range(bitarray, low_index, count);
+	int unmapped = bitarray->count_empty_bits(bitarray) - empty_bits;
+	ZRT_LOG(L_SHORT, "PSEUDO_MUNMAP addr=%p, pages=%d, unmapped pages=%d", 
+		begin, count, unmapped );
+	/*brk can grow into unmapped range*/
+	if ( unmapped > 0 && begin <= this->heap_lowest_mmap_addr )
+	    update_lowest_mmap_addr(this);
     }
     else{
 	ZRT_LOG(L_ERROR, "Can't do unmap addr=%p is not in range [%p-%p]", 
@@ -305,7 +413,80 @@ memory_munmap(struct MemoryManager* this, void *addr, size_t length){
 }
 
 
-static long int memory_get_phys_pages(struct MemoryManager* this){
+static void*
+memory_mremap(struct MemoryManagerPublicInterface* this_public, void *old_addr, size_t old_size, 
+	      size_t new_size, int flags){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
+    struct BitArrayPublicInterface* bitarray = (struct BitArrayPublicInterface*)&this->bitarray;
+    int old_pages = PAGES_COUNT(old_size);
+    int new_pages = PAGES_COUNT(new_size);
+    if ( (uintptr_t)old_addr != ROUND_UP((uintptr_t)old_addr, PAGE_SIZE) ||
+	 old_addr < MMAP_LOWEST_PAGE_ADDR(this) || old_addr > MMAP_HIGHEST_PAGE_ADDR(this) ||
+	 old_pages == 0 || new_pages == 0 || 
+	 (flags & ~MREMAP_MAYMOVE) != 0 ){
+	errno = EINVAL;
+	return MAP_FAILED;
+    }
+    /*mapping occupies bits [old_index-old_pages+1, old_index], pages
+      following mapping have less indexes*/
+    int old_index = MEMORY_INDEX_FROM_PAGE(this, old_addr);
+    if ( old_index-old_pages+1 < 0 ){
+	errno = EINVAL;
+	return MAP_FAILED;
+    }
+
+    if ( new_pages <= old_pages ){
+	/*shrink, unmap the tail of mapping*/
+	bitarray->clear_range(bitarray, old_index-old_pages+1, old_pages-new_pages);
+	ZRT_LOG(L_SHORT, "PSEUDO_MREMAP(%p) shrink to %u", old_addr, new_size );
+	return old_addr;
+    }
+
+    /*grow in place if following pages are not mapped*/
+    int grow_index = old_index-new_pages+1;
+    int grow_pages = new_pages-old_pages;
+    if ( grow_index >= 0 &&
+	 bitarray->search_emptybit_sequence_begin(bitarray, grow_index, grow_pages) == grow_index ){
+	bitarray->set_range(bitarray, grow_index, grow_pages);
+	ZRT_LOG(L_SHORT, "PSEUDO_MREMAP(%p) grow in place to %u", old_addr, new_size );
+	return old_addr;
+    }
+
+    if ( !CHECK_FLAG(flags, MREMAP_MAYMOVE) ){
+	errno = ENOMEM;
+	return MAP_FAILED;
+    }
+    /*move into new mapping; if possible then new mapping is placed at
+      the bottom of free range of double size, so free pages following
+      it are allowing to grow it in place next time*/
+    void* new_addr = NULL;
+    int headroom_index = bitarray->search_emptybit_sequence_begin(bitarray, 0, new_pages*2);
+    if ( headroom_index != -1 ){
+	new_addr = MEMORY_PAGE_FROM_INDEX(this, (headroom_index+new_pages*2-1));
+	if ( new_addr >= this->heap_brk )
+	    new_addr = alloc_memory_fixed_mmap( this, new_addr, new_size );
+	else
+	    new_addr = NULL;
+    }
+    if ( new_addr == NULL )
+	new_addr = alloc_memory_pseudo_mmap( this, new_size );
+    if ( new_addr == NULL ){
+	errno = ENOMEM;
+	return MAP_FAILED;
+    }
+    memcpy( new_addr, old_addr, old_pages*PAGE_SIZE );
+    bitarray->clear_range(bitarray, old_index-old_pages+1, old_pages);
+    if ( old_addr <= this->heap_lowest_mmap_addr )
+	update_lowest_mmap_addr(this);
+    if ( new_addr < this->heap_lowest_mmap_addr )
+	this->heap_lowest_mmap_addr = new_addr;
+    ZRT_LOG(L_SHORT, "PSEUDO_MREMAP(%p) moved to %p, size %u", old_addr, new_addr, new_size );
+    return new_addr;
+}
+
+
+static long int memory_get_phys_pages(struct MemoryManagerPublicInterface* this_public){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
     /*all pages count provided by zerovm (memory rounded up to page size)*/
     intptr_t beginaddr = ROUND_UP((uint32_t)this->heap_start_ptr, PAGE_SIZE);
     intptr_t endaddr = (intptr_t)MMAP_HIGHEST_PAGE_ADDR(this);
@@ -313,20 +494,45 @@ static long int memory_get_phys_pages(struct MemoryManager* this){
     return (endaddr - beginaddr)/PAGE_SIZE + 1;
 }
 
-static long int memory_get_avphys_pages(struct MemoryManager* this){
-    int i;
+static long int memory_get_avphys_pages(struct MemoryManagerPublicInterface* this_public){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
     int all_map_pages_count = ((MMAP_HIGHEST_PAGE_ADDR(this) - MMAP_LOWEST_PAGE_ADDR(this)) / PAGE_SIZE) +1;
-    long int avail_map_pages_count=0;
     struct BitArrayPublicInterface* bitarray = (struct BitArrayPublicInterface*)&this->bitarray;
-    /*pass through bitarray related to pull of map entries*/
-    for ( i=0; i < all_map_pages_count ; i++ ){
-	if ( bitarray->get_bit( bitarray, i) == 0 )
-	    ++avail_map_pages_count;
-    }
-
+    /*cached count of free pages, pages located below brk are never
+      mapped, so they are free and are excluded*/
+    long int avail_map_pages_count = bitarray->count_empty_bits(bitarray);
+    if ( all_map_pages_count < this->bitarray.bits_count )
+	avail_map_pages_count -= this->bitarray.bits_count - all_map_pages_count;
     return avail_map_pages_count;
 }
 
+static void memory_set_mmap_policy(struct MemoryManagerPublicInterface* this_public, int policy){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
+    this->mmap_policy = policy;
+    ZRT_LOG(L_BASE, "mmap policy=%d", policy);
+}
+
+static void memory_get_fragmentation(struct MemoryManagerPublicInterface* this_public, struct zmemstat* stat){
+    struct MemoryManager* this = (struct MemoryManager*)this_public;
+    struct BitArrayPublicInterface* bitarray = (struct BitArrayPublicInterface*)&this->bitarray;
+    int limit = mmap_index_limit(this);
+    int index = 0, run_begin, len;
+    memset(stat, '\0', sizeof(struct zmemstat));
+    stat->page_size = PAGE_SIZE;
+    /*only free pages located upper than brk can be mapped*/
+    while ( index <= limit &&
+	    (len = bitarray->search_emptybit_run(bitarray, index, &run_begin)) > 0 &&
+	    run_begin <= limit ){
+	if ( run_begin+len-1 > limit ) len = limit-run_begin+1;
+	stat->free_pages += len;
+	++stat->free_runs;
+	if ( len > stat->largest_free_run ) stat->largest_free_run = len;
+	index = run_begin+len;
+    }
+    if ( this->heap_lowest_mmap_addr > this->heap_brk )
+	stat->brk_mmap_gap = this->heap_lowest_mmap_addr - this->heap_brk;
+}
+
 
 struct MemoryManagerPublicInterface* memory_interface_instance(){
     return (struct MemoryManagerPublicInterface*)&KMemoryManager;
@@ -337,12 +543,15 @@ struct MemoryManagerPublicInterface* memory_interface_construct( void *heap_ptr,
     struct MemoryManager* this = &KMemoryManager;
 
     /*set functions*/
-    this->public.init = (void*)memory_init;
-    this->public.sysbrk = (void*)memory_sysbrk;
-    this->public.mmap	= (void*)memory_mmap;
-    this->public.munmap = (void*)memory_munmap;
-    this->public.get_phys_pages =    (void*)memory_get_phys_pages;
-    this->public.get_avphys_pages = (void*)memory_get_avphys_pages;
+    this->public.init = memory_init;
+    this->public.sysbrk = memory_sysbrk;
+    this->public.mmap	= memory_mmap;
+    this->public.munmap = memory_munmap;
+    this->public.mremap = memory_mremap;
+    this->public.set_mmap_policy = memory_set_mmap_policy;
+    this->public.get_fragmentation = memory_get_fragmentation;
+    this->public.get_phys_pages =    memory_get_phys_pages;
+    this->public.get_avphys_pages = memory_get_avphys_pages;
 
     /*call init function*/
     this->public.init( (struct MemoryManagerPublicInterface*)this, 
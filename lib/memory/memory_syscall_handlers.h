@@ -30,10 +30,20 @@
 #define ONE_GB_HEAP_SIZE (1024*1024*1024)
 #define PAGE_SIZE (1024*64)
 #define MAX_MMAP_PAGES_COUNT ( MAX_MEMORY_CAPACITY_IN_GB*(ONE_GB_HEAP_SIZE/PAGE_SIZE) )
+/*file data of mapping is read by portions of this size*/
+#define MMAP_FILE_READ_CHUNK (PAGE_SIZE*16)
 
 /*name of constructor*/
 #define MEMORY_MANAGER memory_interface_construct
 
+/*mmap allocation policies*/
+enum { 
+    EMmapPolicyFirstFit=0, /*first free pages range from the end of heap, default*/
+    EMmapPolicyBestFit     /*smallest free pages range that is enough*/
+};
+
+struct zmemstat;
+
 
 /* Low level memory management functions, here are syscalls
  * implementation.  Note that all member functions has
@@ -57,13 +67,16 @@ struct MemoryManagerPublicInterface{
     void* (*sysbrk)(struct MemoryManagerPublicInterface* this, void *addr);
     
     /* MMAP emulation in user-space implementation.
-     * @param addr ignored
-     * @param length length of the mapping, it's used when fd value is not exist
-     * and MAP_ANONYMOUS flag is set;
+     * @param addr ignored, if MAP_FIXED flag is not set; for MAP_FIXED it
+     * should be page aligned address located upper than brk, mapping replaces
+     * pages already mapped at range [addr, addr+length)
+     * @param length length of the mapping
      * @prot 
      * case1: if correct fd values is passed then PROT_READ only supported, another 
-     * prot flags will be ignored; it's implemented by simple loading of whole file
-     * contents into memory, so memory always mapping file contents,
+     * prot flags will be ignored; it's implemented by loading of file contents
+     * located in range [offset, offset+length) into memory, the rest of mapping
+     * after end of file is zeroed; as no page faults are available file data is
+     * read at once, but only mapped range of file is read,
      * case2: if fake fd value passed and MAP_ANONYMOUS flag is set then prot flags
      * PROT_READ|PROT_WRITE both supported and here requeted memory range will allocated,
      * case3: for any another prot flag will returned error, and ENOSYS set to errno;
@@ -73,11 +86,28 @@ struct MemoryManagerPublicInterface{
 		    int flags, int fd, off_t offset);
     
     /* MUNMAP emulation in user-space implementation.
-     * @param addr should be actual address starting map region
-     * @param length ignored  
-     * unmap memory range, in practice memory will released at specified addr*/
+     * @param addr address of range to unmap, it's rounded down to page size
+     * @param length length of range, pages of range are unmapped at once
+     * regardless of mappings they are belonging to, so part of mapping can
+     * be unmapped; range is limited by mmap region, and it's not an error
+     * if range does not contain any mapped pages*/
     int (*munmap)(struct MemoryManagerPublicInterface* this, void *addr, size_t length);
 
+    /* MREMAP emulation in user-space implementation.
+     * @param old_addr address of mapping returned by mmap or mremap
+     * @param flags MREMAP_MAYMOVE or 0
+     * Mapping is shrunk or grown in place if pages following it are not
+     * mapped, otherwise if MREMAP_MAYMOVE is set then data is moved into
+     * new mapping, and old mapping is unmapped;
+     * @return address of mapping, or MAP_FAILED and errno*/
+    void* (*mremap)(struct MemoryManagerPublicInterface* this, void *old_addr, 
+		    size_t old_size, size_t new_size, int flags);
+
+    /*set mmap allocation policy EMmapPolicyFirstFit or EMmapPolicyBestFit*/
+    void (*set_mmap_policy)(struct MemoryManagerPublicInterface* this, int policy);
+    /*get fragmentation report of mmap region, see zmemstat() of zrtapi.h*/
+    void (*get_fragmentation)(struct MemoryManagerPublicInterface* this, struct zmemstat* stat);
+
     /*result for sysconf(_SC_PHYS_PAGES)*/
     long int (*get_phys_pages)(struct MemoryManagerPublicInterface* this);
     /*result for sysconf(_SC_AVPHYS_PAGES)
@@ -94,10 +124,12 @@ struct MemoryManager{
     void*    heap_brk;       /*current brk pointer*/
     size_t   heap_size;      /*entire heap size*/
     void*    heap_lowest_mmap_addr;
+    int      mmap_policy;    /*EMmapPolicyFirstFit or EMmapPolicyBestFit*/
     //
     /*map_chunks_bit_array is used for bitarray, were are only 1bit per
-     *1page needed.  here reserved memory for max available pages count.*/
-    unsigned char map_chunks_bit_array[(MAX_MMAP_PAGES_COUNT)/8]; 
+     *1page needed and summary level.  here reserved memory for max
+     *available pages count.*/
+    uint64_t map_chunks_bit_array[BIT_ARRAY_STORAGE_WORDS(MAX_MMAP_PAGES_COUNT)]; 
     //
     struct BitArray bitarray;
 };
@@ -21,7 +21,7 @@
 
 #define NVRAM_MAX_FILE_SIZE 10240
 #define NVRAM_MAX_SECTION_NAME_LEN 20
-#define NVRAM_MAX_SECTIONS_COUNT 7
+#define NVRAM_MAX_SECTIONS_COUNT 9
 #define NVRAM_MAX_OBSERVERS_COUNT NVRAM_MAX_SECTIONS_COUNT
 #define NVRAM_MAX_RECORDS_IN_SECTION 100
 #define NVRAM_MAX_KEYS_COUNT_IN_RECORD 4
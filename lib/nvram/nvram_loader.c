@@ -39,6 +39,8 @@
 #include "observers/environment_observer.h"
 #include "observers/fstab_observer.h"
 #include "observers/mapping_observer.h"
+#include "observers/iobuffer_observer.h"
+#include "observers/memory_observer.h"
 #include "observers/nvram_observer.h"
 #include "observers/settime_observer.h"
 #include "observers/precache_observer.h"
@@ -346,6 +348,8 @@ struct NvramLoaderPublicInterface* nvram_loader(){
     this->public.add_observer(&this->public, get_settime_observer() );
     this->public.add_observer(&this->public, get_debug_observer() );
     this->public.add_observer(&this->public, get_mapping_observer() );
+    this->public.add_observer(&this->public, get_iobuffer_observer() );
+    this->public.add_observer(&this->public, get_memory_observer() );
     this->public.add_observer(&this->public, get_env_observer() );
     this->public.add_observer(&this->public, get_arg_observer() );
 
@@ -31,6 +31,9 @@
 #include "fstab_observer.h"
 #include "nvram.h"
 #include "image_engine.h"
+#include "mounts_interface.h"
+#include "channels_mount.h"
+#include "file_data_source.h"
 #include "conf_parser.h"
 #include "conf_keys.h"
 
@@ -66,7 +69,8 @@ int handle_is_valid_record(struct MNvramObserver* observer, struct ParsedRecord*
     char* removable = NULL;
     GET_FSTAB_PARAMS(record, &channel_alias, &mount_path, &access, &removable);
 
-    if ( ( !strcmp(access, FSTAB_VAL_ACCESS_WRITE) || !strcmp(access, FSTAB_VAL_ACCESS_READ) ) &&
+    if ( ( !strcmp(access, FSTAB_VAL_ACCESS_WRITE) || !strcmp(access, FSTAB_VAL_ACCESS_READ) ||
+	   !strcmp(access, FSTAB_VAL_ACCESS_READ_ON_DEMAND) ) &&
 	 ( !strcmp(removable, FSTAB_VAL_REMOVABLE_YES) || !strcmp(removable, FSTAB_VAL_REMOVABLE_NO) ))
 	return 0;
     else return 1;	
@@ -149,9 +153,10 @@ void handle_mount_import(struct FstabObserver* observer, struct FstabRecordConta
 	char* removable = NULL;
 	GET_FSTAB_PARAMS(&record->mount, &channel_alias, &mount_path, &access, &removable);
 	int removable_record = !strcasecmp( removable, FSTAB_VAL_REMOVABLE_YES);
+	int on_demand = !strcmp(access, FSTAB_VAL_ACCESS_READ_ON_DEMAND);
 
 	/* In case if we need to inject files into FS.*/
-	if ( !strcmp(access, FSTAB_VAL_ACCESS_READ) && 
+	if ( (!strcmp(access, FSTAB_VAL_ACCESS_READ) || on_demand) && 
 	     EFstabMountWaiting == record->mount_status &&
 	     ( removable_record || (!s_updated_fstab_records && !removable_record) ) ){
 	    /*
@@ -171,8 +176,20 @@ void handle_mount_import(struct FstabObserver* observer, struct FstabRecordConta
 		/*create image loader, passed 1st param: image alias, 2nd param: Root filesystem;
 		 * Root filesystem passed instead MemMount to reject adding of files into /dev folder;
 		 * For example if archive contains non empty /dev folder that contents will be ignored*/
-		struct ImageInterface* image_loader =
-		    alloc_image_loader( s_transparent_mount );
+		struct ImageInterface* image_loader = NULL;
+		if ( on_demand ){
+		    /*files read their data from channel directly, not
+		      via file descriptor that user is able to close*/
+		    struct FileDataSource source;
+		    if ( channels_data_source(s_channels_mount, channel_alias, &source) == 0 )
+			image_loader = alloc_lazy_image_loader( s_transparent_mount, &source );
+		    else{
+			ZRT_LOG( L_ERROR, "can't read %s randomly, mount files by copying", 
+				 channel_alias );
+		    }
+		}
+		if ( image_loader == NULL )
+		    image_loader = alloc_image_loader( s_transparent_mount );
 		/*create archive unpacker*/
 		struct UnpackInterface* tar_unpacker =
 		    alloc_unpacker_tar( mounts_reader, image_loader->observer_implementation );
@@ -222,7 +239,8 @@ void handle_reset_removable(struct FstabObserver* observer){
 	     case 2: do it for records with flag removable=yes if nvram
 	     re-readed (flag s_updated_fstab_records=1)*/
 	    if ( !s_updated_fstab_records ||
-		 (!strcmp(access, FSTAB_VAL_ACCESS_READ) && removable_record != 0) ){
+		 ((!strcmp(access, FSTAB_VAL_ACCESS_READ) || 
+		   !strcmp(access, FSTAB_VAL_ACCESS_READ_ON_DEMAND)) && removable_record != 0) ){
 		record_container->mount_status = EFstabMountWaiting;
 	    }
 	    else{
@@ -30,6 +30,9 @@
 #define FSTAB_PARAM_REMOVABLE         "removable"
 
 #define FSTAB_VAL_ACCESS_READ      "ro"  /*for injecting files into FS*/
+/*for injecting files into FS without copying of their data, files
+ *read data from channel until written, channel must be seekable*/
+#define FSTAB_VAL_ACCESS_READ_ON_DEMAND "ro-ondemand"
 #define FSTAB_VAL_ACCESS_WRITE     "wo"  /*for copying files into image*/
 
 #define FSTAB_VAL_REMOVABLE_YES       "yes"
@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "zrt_defines.h"
+
+#include "zrtlog.h"
+#include "iobuffer_observer.h"
+#include "nvram.h"
+#include "conf_parser.h"
+#include "conf_keys.h"
+#include "channels_mount.h"
+
+
+#define IOBUFFER_PARAM_CHANNEL_KEY_INDEX    0
+#define IOBUFFER_PARAM_SIZE_KEY_INDEX       1
+
+static struct MNvramObserver s_iobuffer_observer;
+static struct ChannelsModeUpdaterPublicInterface *s_nvram_iobuffer_setting_updater;
+
+void handle_iobuffer_record(struct MNvramObserver* observer,
+			    struct ParsedRecord* record,
+			    void* obj1, void* obj2, void* obj3){
+    assert(record);
+
+    /*get param */
+    char* channel = NULL;
+    ALLOCA_PARAM_VALUE(record->parsed_params_array[IOBUFFER_PARAM_CHANNEL_KEY_INDEX], 
+		       &channel);
+    /*get param */
+    char* size = NULL;
+    ALLOCA_PARAM_VALUE(record->parsed_params_array[IOBUFFER_PARAM_SIZE_KEY_INDEX], 
+		       &size);
+
+    ZRT_LOG(L_SHORT, "iobuffer record: channel=%s, size=%s", channel, size);
+
+    if ( channel != NULL && size != NULL ){
+	char* end = NULL;
+	long buffer_size = strtol(size, &end, 10);
+	assert(s_nvram_iobuffer_setting_updater);
+
+	if ( end != size && *end == '\0' && buffer_size >= 0 ){
+	    s_nvram_iobuffer_setting_updater->set_channel_iobuffer_size(s_nvram_iobuffer_setting_updater, 
+									channel, (int)buffer_size);
+	    ZRT_LOG(L_BASE, "channel=%s, iobuffer size=%d", channel, (int)buffer_size );
+	}
+	else{
+	    ZRT_LOG(L_ERROR, "channel=%s, invalid iobuffer size=%s", channel, size );
+	}
+    }
+}
+
+void set_iobuffer_channels_settings_updater( struct ChannelsModeUpdaterPublicInterface 
+					     *nvram_iobuffer_setting_updater ){
+    s_nvram_iobuffer_setting_updater = nvram_iobuffer_setting_updater;
+}
+
+
+struct MNvramObserver* get_iobuffer_observer(){
+    struct MNvramObserver* self = &s_iobuffer_observer;
+    ZRT_LOG(L_INFO, "Create observer for section: %s", IOBUFFER_SECTION_NAME);
+    /*setup section name*/
+    strncpy(self->observed_section_name, IOBUFFER_SECTION_NAME, NVRAM_MAX_SECTION_NAME_LEN);
+    /*setup section keys*/
+    keys_construct(&self->keys);
+    /*add keys and check returned key indexes that are the same as expected*/
+    int key_index;
+    /*check parameters*/
+    key_index = self->keys.add_key(&self->keys, IOBUFFER_PARAM_CHANNEL_KEY);
+    assert(IOBUFFER_PARAM_CHANNEL_KEY_INDEX==key_index);
+    /*check parameters*/
+    key_index = self->keys.add_key(&self->keys, IOBUFFER_PARAM_SIZE_KEY);
+    assert(IOBUFFER_PARAM_SIZE_KEY_INDEX==key_index);
+
+    /*setup functions*/
+    s_iobuffer_observer.handle_nvram_record = handle_iobuffer_record;
+    ZRT_LOG(L_SHORT, "OK observer for section: %s", IOBUFFER_SECTION_NAME);
+    return &s_iobuffer_observer;
+}
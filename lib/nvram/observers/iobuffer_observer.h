@@ -0,0 +1,42 @@
+/*
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IOBUFFER_OBSERVER_H_
+#define IOBUFFER_OBSERVER_H_
+
+#define HANDLE_ONLY_IOBUFFER_SECTION get_iobuffer_observer()
+
+/*example: channel=/dev/stdin, size=4096
+ *size=0 disables buffering of channel. The same size is used by both
+ *read-ahead and write-behind buffers of channel. Read-ahead of
+ *sequential channels is enabled by default, write-behind is enabled
+ *only for channels listed in section*/
+#define IOBUFFER_SECTION_NAME         "iobuffer"
+#define IOBUFFER_PARAM_CHANNEL_KEY    "channel"
+#define IOBUFFER_PARAM_SIZE_KEY       "size"
+
+#include "nvram_observer.h"
+
+struct ChannelsModeUpdaterPublicInterface;
+
+void set_iobuffer_channels_settings_updater( struct ChannelsModeUpdaterPublicInterface 
+					    *nvram_mode_setting_updater );
+
+/*get static interface, object not intended to destroy after using*/
+struct MNvramObserver* get_iobuffer_observer();
+
+#endif /* IOBUFFER_OBSERVER_H_ */
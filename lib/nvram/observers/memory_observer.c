@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "zrt_defines.h"
+
+#include "zrtlog.h"
+#include "memory_observer.h"
+#include "nvram.h"
+#include "conf_parser.h"
+#include "conf_keys.h"
+#include "memory_syscall_handlers.h"
+
+
+#define MEMORY_PARAM_POLICY_KEY_INDEX    0
+
+static struct MNvramObserver s_memory_observer;
+
+void handle_memory_record(struct MNvramObserver* observer,
+			  struct ParsedRecord* record,
+			  void* obj1, void* obj2, void* obj3){
+    assert(record);
+    /*get param*/
+    char* policy = NULL;
+    ALLOCA_PARAM_VALUE(record->parsed_params_array[MEMORY_PARAM_POLICY_KEY_INDEX], 
+		       &policy);
+    ZRT_LOG(L_SHORT, "memory record: policy=%s", policy);
+
+    if ( policy ){
+	struct MemoryManagerPublicInterface* memif = memory_interface_instance();
+	if ( !strcmp(policy, MEMORY_POLICY_BESTFIT) ){
+	    memif->set_mmap_policy(memif, EMmapPolicyBestFit);
+	}
+	else if ( !strcmp(policy, MEMORY_POLICY_FIRSTFIT) ){
+	    memif->set_mmap_policy(memif, EMmapPolicyFirstFit);
+	}
+	else{
+	    ZRT_LOG(L_ERROR, "invalid memory policy=%s", policy );
+	}
+    }
+}
+
+struct MNvramObserver* get_memory_observer(){
+    struct MNvramObserver* self = &s_memory_observer;
+    ZRT_LOG(L_INFO, "Create observer for section: %s", MEMORY_SECTION_NAME);
+    /*setup section name*/
+    strncpy(self->observed_section_name, MEMORY_SECTION_NAME, NVRAM_MAX_SECTION_NAME_LEN);
+    /*setup section keys*/
+    keys_construct(&self->keys);
+    /*add keys and check returned key indexes that are the same as expected*/
+    int key_index;
+    /*check parameters*/
+    key_index = self->keys.add_key(&self->keys, MEMORY_PARAM_POLICY_KEY);
+    assert(MEMORY_PARAM_POLICY_KEY_INDEX==key_index);
+
+    /*setup functions*/
+    s_memory_observer.handle_nvram_record = handle_memory_record;
+    ZRT_LOG(L_SHORT, "OK observer for section: %s", MEMORY_SECTION_NAME);
+    return &s_memory_observer;
+}
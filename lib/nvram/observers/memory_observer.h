@@ -0,0 +1,35 @@
+/*
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MEMORY_OBSERVER_H_
+#define MEMORY_OBSERVER_H_
+
+#define HANDLE_ONLY_MEMORY_SECTION get_memory_observer()
+
+/*example: policy=bestfit
+ *mmap allocation policy, firstfit is default*/
+#define MEMORY_SECTION_NAME         "memory"
+#define MEMORY_PARAM_POLICY_KEY     "policy"
+#define MEMORY_POLICY_FIRSTFIT      "firstfit"
+#define MEMORY_POLICY_BESTFIT       "bestfit"
+
+#include "nvram_observer.h"
+
+/*get static interface, object not intended to destroy after using*/
+struct MNvramObserver* get_memory_observer();
+
+#endif /* MEMORY_OBSERVER_H_ */
@@ -65,6 +65,8 @@
 #include "mounts_manager.h"
 #include "mem_mount_wraper.h"
 #include "mapping_observer.h"
+#include "memory_observer.h"
+#include "iobuffer_observer.h"
 #include "image_engine.h"
 #include "handle_allocator.h"
 #include "fstab_observer.h"
@@ -134,6 +136,8 @@ void set_home_dir(const char *home)
 void zrt_zcall_enhanced_exit(int status){
     ZRT_LOG(L_SHORT, "status %d exiting...", status);
     get_fstab_observer()->mount_export(HANDLE_ONLY_FSTAB_SECTION);
+    /*write data left in write-behind buffers of channels*/
+    channels_flush_writebehind(s_channels_mount);
     zvm_exit(status); /*get controls into zerovm*/
     /* unreachable code*/
     return; 
@@ -402,6 +406,42 @@ int  zrt_zcall_enhanced_munmap(void *addr, size_t len){
     return retcode;
 }
 
+void* zmremap(void *old_address, size_t old_size, size_t new_size, int flags){
+    LOG_SYSCALL_START("old_address=%p, old_size=%u, new_size=%u, flags=%d", 
+		      old_address, old_size, new_size, flags);
+    struct MemoryManagerPublicInterface* memif = memory_interface_instance();
+    void* retaddr = memif->mremap(memif, old_address, old_size, new_size, flags);
+    LOG_INFO_SYSCALL_FINISH( (retaddr!=MAP_FAILED?0:-1), "old_address=%p, new_address=%p", 
+			     old_address, retaddr);
+    return retaddr;
+}
+
+int zmemstat(struct zmemstat* stat){
+    LOG_SYSCALL_START("stat=%p", stat);
+    if ( stat == NULL ){
+	SET_ERRNO(EFAULT);
+	return -1;
+    }
+    struct MemoryManagerPublicInterface* memif = memory_interface_instance();
+    memif->get_fragmentation(memif, stat);
+    LOG_INFO_SYSCALL_FINISH( 0, "free_pages=%u, largest_free_run=%u, free_runs=%u, brk_mmap_gap=%u",
+			     stat->free_pages, stat->largest_free_run, stat->free_runs, 
+			     stat->brk_mmap_gap);
+    return 0;
+}
+
+int zimagestat(struct zimagestat* stat){
+    LOG_SYSCALL_START("stat=%p", stat);
+    if ( stat == NULL ){
+	SET_ERRNO(EFAULT);
+	return -1;
+    }
+    get_image_deploy_stat(&stat->deployed_bytes, &stat->deploy_msec, &stat->images_count);
+    LOG_INFO_SYSCALL_FINISH( 0, "deployed_bytes=%lld, deploy_msec=%lld, images_count=%d",
+			     stat->deployed_bytes, stat->deploy_msec, stat->images_count);
+    return 0;
+}
+
 int zrt_zcall_select(int nfds, fd_set *readfds,
 		     fd_set *writefds, fd_set *exceptfds,
 		     const struct timeval *timeout, int *count){
@@ -478,6 +518,12 @@ void zrt_zcall_enhanced_zrt_setup(void){
     if ( NULL != nvram->section_by_name( nvram, MAPPING_SECTION_NAME ) ){
 	nvram->handle(nvram, HANDLE_ONLY_MAPPING_SECTION, NULL, NULL, NULL);
     }
+    if ( NULL != nvram->section_by_name( nvram, IOBUFFER_SECTION_NAME ) ){
+	nvram->handle(nvram, HANDLE_ONLY_IOBUFFER_SECTION, NULL, NULL, NULL);
+    }
+    if ( NULL != nvram->section_by_name( nvram, MEMORY_SECTION_NAME ) ){
+	nvram->handle(nvram, HANDLE_ONLY_MEMORY_SECTION, NULL, NULL, NULL);
+    }
     if ( NULL != nvram->section_by_name( nvram, FSTAB_SECTION_NAME ) ){
 	nvram->handle(nvram, (struct MNvramObserver*)HANDLE_ONLY_FSTAB_SECTION, 
 		      s_channels_mount, s_transparent_mount, NULL );
@@ -535,6 +581,7 @@ void zrt_internal_init( const struct UserManifest const* manifest ){
 					  s_emu_channels, 
 					  sizeof(s_emu_channels)/sizeof(struct ZVMChannel));
     set_mapping_channels_settings_updater( nvram_mode_setting_updater ); 
+    set_iobuffer_channels_settings_updater( nvram_mode_setting_updater ); 
 
     /*alloc main filesystem that combines all filesystems mounts*/
     s_transparent_mount = alloc_transparent_mount( s_mounts_manager );
@@ -571,10 +618,14 @@ int is_zrt_ready(){
 
 int zfork(){
     ZRT_LOG(L_INFO, P_TEXT, "call zvm_fork");
+    /*buffered data must be written into channels of current session*/
+    channels_flush_writebehind(s_channels_mount);
     /*zvm fork syscall here
       ...*/
     int res = zvm_fork();
     ZRT_LOG(L_INFO, "zvm_fork res=%d", res);
+    /*channels data fetched before fork is not actual*/
+    channels_reset_readahead(s_channels_mount);
 
     /*re-read nvram file because after fork his content can be changed. */
     /*Use updated nvram fields that we get with forked session*/
@@ -595,6 +646,14 @@ int zfork(){
 	if ( NULL != nvram->section_by_name( nvram, MAPPING_SECTION_NAME ) ){
 	    nvram->handle(nvram, HANDLE_ONLY_MAPPING_SECTION, NULL, NULL, NULL);
 	}
+	/*[iobuffer] section*/
+	if ( NULL != nvram->section_by_name( nvram, IOBUFFER_SECTION_NAME ) ){
+	    nvram->handle(nvram, HANDLE_ONLY_IOBUFFER_SECTION, NULL, NULL, NULL);
+	}
+	/*[memory] section*/
+	if ( NULL != nvram->section_by_name( nvram, MEMORY_SECTION_NAME ) ){
+	    nvram->handle(nvram, HANDLE_ONLY_MEMORY_SECTION, NULL, NULL, NULL);
+	}
 	/*[fstab] section*/
 	if ( NULL != nvram->section_by_name( nvram, FSTAB_SECTION_NAME ) ){
 	    /*remove existing fstab records*/
@@ -0,0 +1,504 @@
+/*
+ * zmalloc.c
+ * Size-class allocator tuned for ZeroVM single heap;
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "zrt_defines.h" //ROUND_UP
+#include "zrtapi.h"      //zmremap
+#include "zmalloc.h"
+
+/*16 bytes step up to 128 bytes, and then 4 classes for every doubling
+ *of size up to ZMALLOC_MAX_SMALL_SIZE*/
+#define SIZE_CLASSES_COUNT 40
+#define LARGE_SPAN -1
+/*lookup of size class by 16 bytes step up to 1024 bytes, and then by
+ *128 bytes step, sizes of classes are multiple of steps*/
+#define SMALL_LOOKUP_MAX  1024
+#define SMALL_LOOKUP_STEP ZMALLOC_ALIGN
+#define BIG_LOOKUP_STEP   128
+/*larger objects can't be mapped*/
+#define MAX_LARGE_SIZE ((size_t)1 << 31)
+
+#define PAGES_SIZE(pages) ((size_t)(pages) << ZMALLOC_PAGE_SHIFT)
+#define PAGES_COUNT(size) (ROUND_UP((size), ZMALLOC_PAGE_SIZE) >> ZMALLOC_PAGE_SHIFT)
+#define PAGE_INDEX(addr) (((uintptr_t)(addr) - s_zmalloc.base) >> ZMALLOC_PAGE_SHIFT)
+
+/*Span of pages holding slab of objects of single size class, or
+ *single large object*/
+struct ZSpan{
+    struct ZSpan* next;  /*list of slabs of size class, free spans, or spare descriptors*/
+    struct ZSpan* prev;
+    char*  start;        /*address of the first page*/
+    size_t pages;
+    int    size_class;   /*LARGE_SPAN for large object*/
+    int    used;         /*count of allocated objects of slab*/
+    int    capacity;     /*count of objects of slab*/
+    void*  free_objects; /*list of freed objects of slab*/
+    char*  bump;         /*objects located from bump up to the end of
+			   slab were never allocated*/
+    int    mapped;       /*pages are got by mmap, otherwise from brk*/
+};
+
+struct ZMalloc{
+    int       inited;
+    uintptr_t base;      /*address of page related to the first pagemap item*/
+    /*span owning page, or NULL, it is used to find span of freed
+      pointer without headers of objects*/
+    struct ZSpan* pagemap[ZMALLOC_MAX_PAGES_COUNT];
+    size_t  class_size[SIZE_CLASSES_COUNT];
+    int     class_pages[SIZE_CLASSES_COUNT];
+    uint8_t small_lookup[SMALL_LOOKUP_MAX/SMALL_LOOKUP_STEP+1];
+    uint8_t big_lookup[ZMALLOC_MAX_SMALL_SIZE/BIG_LOOKUP_STEP+1];
+    struct ZSpan* partial[SIZE_CLASSES_COUNT]; /*slabs having free objects*/
+    struct ZSpan* free_spans;  /*pages of released slabs located in brk*/
+    struct ZSpan* large_cache; /*mapped pages of freed large objects*/
+    size_t        large_cache_pages;
+    struct ZSpan* spare;       /*unused descriptors*/
+};
+
+static struct ZMalloc s_zmalloc;
+
+
+static void zmalloc_init(){
+    struct ZMalloc* this = &s_zmalloc;
+    size_t size = 0;
+    int count = 0, i;
+    /*all pages of heap are located upper than initial brk*/
+    this->base = (uintptr_t)sbrk(0) & ~(uintptr_t)(ZMALLOC_PAGE_SIZE-1);
+    while ( size < ZMALLOC_MAX_SMALL_SIZE ){
+	if ( size < 128 )
+	    size += ZMALLOC_ALIGN;
+	else
+	    size += ((size_t)1 << (31-__builtin_clz(size))) / 4;
+	assert(count < SIZE_CLASSES_COUNT);
+	this->class_size[count] = size;
+	/*slab is enough for minimal count of objects*/
+	this->class_pages[count] = PAGES_COUNT(size*ZMALLOC_SLAB_MIN_OBJECTS);
+	++count;
+    }
+    assert(count == SIZE_CLASSES_COUNT);
+    for ( i=0, count=0; i < sizeof(this->small_lookup); i++ ){
+	while ( this->class_size[count] < i*SMALL_LOOKUP_STEP ) ++count;
+	this->small_lookup[i] = count;
+    }
+    for ( i=0, count=0; i < sizeof(this->big_lookup); i++ ){
+	while ( this->class_size[count] < i*BIG_LOOKUP_STEP ) ++count;
+	this->big_lookup[i] = count;
+    }
+    this->inited = 1;
+}
+
+static inline int size_class(size_t size){
+    if ( size <= SMALL_LOOKUP_MAX )
+	return s_zmalloc.small_lookup[(size+SMALL_LOOKUP_STEP-1)/SMALL_LOOKUP_STEP];
+    else
+	return s_zmalloc.big_lookup[(size+BIG_LOOKUP_STEP-1)/BIG_LOOKUP_STEP];
+}
+
+static void list_push(struct ZSpan** head, struct ZSpan* span){
+    span->prev = NULL;
+    span->next = *head;
+    if ( *head != NULL ) (*head)->prev = span;
+    *head = span;
+}
+
+static void list_remove(struct ZSpan** head, struct ZSpan* span){
+    if ( span->prev != NULL ) span->prev->next = span->next;
+    else *head = span->next;
+    if ( span->next != NULL ) span->next->prev = span->prev;
+}
+
+/*@return span owning pointer, or NULL*/
+static struct ZSpan* span_of(const void* ptr){
+    if ( (uintptr_t)ptr < s_zmalloc.base || PAGE_INDEX(ptr) >= ZMALLOC_MAX_PAGES_COUNT )
+	return NULL;
+    return s_zmalloc.pagemap[PAGE_INDEX(ptr)];
+}
+
+/*set owner of all pages of span
+ *@return 0 if OK, -1 if span is out of pagemap*/
+static int pagemap_set(struct ZSpan* span, struct ZSpan* owner){
+    size_t i, index = PAGE_INDEX(span->start);
+    if ( (uintptr_t)span->start < s_zmalloc.base ||
+	 index + span->pages > ZMALLOC_MAX_PAGES_COUNT )
+	return -1;
+    for ( i=0; i < span->pages; i++ )
+	s_zmalloc.pagemap[index+i] = owner;
+    return 0;
+}
+
+
+/*********** pages *************/
+
+static char* map_pages(size_t pages){
+    void* addr = mmap(NULL, PAGES_SIZE(pages), PROT_READ|PROT_WRITE,
+		      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return addr != MAP_FAILED ? addr : NULL;
+}
+
+/*pages are aligned, so brk is padded*/
+static char* brk_pages(size_t pages){
+    char* brk = sbrk(0);
+    size_t pad = ROUND_UP((uintptr_t)brk, ZMALLOC_PAGE_SIZE) - (uintptr_t)brk;
+    if ( PAGES_SIZE(pages) >= MAX_LARGE_SIZE ||
+	 sbrk(pad + PAGES_SIZE(pages)) == (void*)-1 )
+	return NULL;
+    return brk + pad;
+}
+
+/*Slabs prefer brk to keep mmap region not fragmented, large objects
+ *prefer mmap to be resized by zmremap and to be returned into mmap
+ *region after free. Another source is used if preferred one failed.
+ *@return address of pages, or NULL*/
+static char* alloc_pages(size_t pages, int prefer_mmap, int* mapped){
+    char* addr = prefer_mmap ? map_pages(pages) : brk_pages(pages);
+    *mapped = prefer_mmap;
+    if ( addr == NULL ){
+	addr = prefer_mmap ? brk_pages(pages) : map_pages(pages);
+	*mapped = !prefer_mmap;
+    }
+    return addr;
+}
+
+static struct ZSpan* alloc_descriptor(){
+    struct ZMalloc* this = &s_zmalloc;
+    if ( this->spare == NULL ){
+	/*descriptors page is never freed and is not in pagemap*/
+	int mapped, i;
+	struct ZSpan* spans = (struct ZSpan*)alloc_pages(1, 0, &mapped);
+	if ( spans == NULL ) return NULL;
+	for ( i=0; i < ZMALLOC_PAGE_SIZE/sizeof(struct ZSpan); i++ ){
+	    spans[i].next = this->spare;
+	    this->spare = &spans[i];
+	}
+    }
+    struct ZSpan* span = this->spare;
+    this->spare = span->next;
+    memset(span, '\0', sizeof(struct ZSpan));
+    return span;
+}
+
+static void free_descriptor(struct ZSpan* span){
+    span->next = s_zmalloc.spare;
+    s_zmalloc.spare = span;
+}
+
+/*Pages of span located on the top of brk are returned by shrinking
+ *brk, so brk/mmap gap grows, other pages are kept for slabs*/
+static void release_brk_span(struct ZSpan* span){
+    struct ZMalloc* this = &s_zmalloc;
+    list_push(&this->free_spans, span);
+    while ( span != NULL ){
+	char* brk = sbrk(0);
+	for ( span = this->free_spans; span != NULL; span = span->next ){
+	    if ( span->start + PAGES_SIZE(span->pages) == brk ) break;
+	}
+	if ( span != NULL ){
+	    list_remove(&this->free_spans, span);
+	    sbrk(-(intptr_t)PAGES_SIZE(span->pages));
+	    free_descriptor(span);
+	}
+    }
+}
+
+static void release_span(struct ZSpan* span){
+    pagemap_set(span, NULL);
+    if ( span->mapped ){
+	munmap(span->start, PAGES_SIZE(span->pages));
+	free_descriptor(span);
+    }
+    else{
+	release_brk_span(span);
+    }
+}
+
+/*@return span of pages count taken from list, the rest of pages of
+ *bigger span is kept in list, or is unmapped if unmap_rest is set*/
+static struct ZSpan* take_span(struct ZSpan** list, size_t pages, int unmap_rest){
+    struct ZSpan *span, *rest;
+    for ( span = *list; span != NULL; span = span->next ){
+	if ( span->pages >= pages ) break;
+    }
+    if ( span == NULL ) return NULL;
+    list_remove(list, span);
+    if ( span->pages > pages ){
+	char* rest_start = span->start + PAGES_SIZE(pages);
+	size_t rest_pages = span->pages - pages;
+	if ( unmap_rest ){
+	    munmap(rest_start, PAGES_SIZE(rest_pages));
+	}
+	else if ( (rest = alloc_descriptor()) != NULL ){
+	    rest->start = rest_start;
+	    rest->pages = rest_pages;
+	    list_push(list, rest);
+	}
+	else{
+	    /*keep pages in span if no memory for descriptor*/
+	    pages = span->pages;
+	}
+	span->pages = pages;
+    }
+    return span;
+}
+
+
+/*********** small objects *************/
+
+static struct ZSpan* new_slab(int class){
+    struct ZMalloc* this = &s_zmalloc;
+    size_t pages = this->class_pages[class];
+    struct ZSpan* slab = take_span(&this->free_spans, pages, 0);
+    if ( slab == NULL ){
+	if ( (slab = alloc_descriptor()) == NULL ) return NULL;
+	slab->start = alloc_pages(pages, 0, &slab->mapped);
+	slab->pages = pages;
+	if ( slab->start == NULL ){
+	    free_descriptor(slab);
+	    return NULL;
+	}
+    }
+    if ( pagemap_set(slab, slab) != 0 ){
+	release_span(slab);
+	return NULL;
+    }
+    slab->size_class = class;
+    slab->used = 0;
+    slab->capacity = PAGES_SIZE(slab->pages) / this->class_size[class];
+    slab->free_objects = NULL;
+    slab->bump = slab->start;
+    list_push(&this->partial[class], slab);
+    return slab;
+}
+
+static void* small_alloc(size_t size){
+    struct ZMalloc* this = &s_zmalloc;
+    int class = size_class(size);
+    struct ZSpan* slab = this->partial[class];
+    void* obj;
+    if ( slab == NULL && (slab = new_slab(class)) == NULL )
+	return NULL;
+    if ( slab->free_objects != NULL ){
+	obj = slab->free_objects;
+	slab->free_objects = *(void**)obj;
+    }
+    else{
+	obj = slab->bump;
+	slab->bump += this->class_size[class];
+    }
+    /*full slab is not in list*/
+    if ( ++slab->used == slab->capacity )
+	list_remove(&this->partial[class], slab);
+    return obj;
+}
+
+/*@return start of object containing ptr, it can be not the same as
+ *ptr for aligned objects*/
+static inline char* small_object(struct ZSpan* slab, const void* ptr){
+    size_t size = s_zmalloc.class_size[slab->size_class];
+    return slab->start + ((const char*)ptr - slab->start) / size * size;
+}
+
+static void small_free(struct ZSpan* slab, void* ptr){
+    struct ZMalloc* this = &s_zmalloc;
+    int class = slab->size_class;
+    void* obj = small_object(slab, ptr);
+    *(void**)obj = slab->free_objects;
+    slab->free_objects = obj;
+    if ( slab->used-- == slab->capacity )
+	list_push(&this->partial[class], slab);
+    /*empty slab is released if it's not single slab of class having
+      free objects*/
+    if ( slab->used == 0 && (this->partial[class] != slab || slab->next != NULL) ){
+	list_remove(&this->partial[class], slab);
+	release_span(slab);
+    }
+}
+
+
+/*********** large objects *************/
+
+/*@param alignment power of 2 not less than page size*/
+static void* large_alloc(size_t size, size_t alignment){
+    struct ZMalloc* this = &s_zmalloc;
+    size_t extra = alignment - ZMALLOC_PAGE_SIZE;
+    if ( size >= MAX_LARGE_SIZE || extra >= MAX_LARGE_SIZE ) return NULL;
+    size_t pages = PAGES_COUNT(size+extra);
+
+    struct ZSpan* span = take_span(&this->large_cache, pages, 1);
+    if ( span != NULL ){
+	this->large_cache_pages -= span->pages;
+    }
+    else{
+	if ( (span = alloc_descriptor()) == NULL ) return NULL;
+	span->start = alloc_pages(pages, 1, &span->mapped);
+	span->pages = pages;
+	if ( span->start == NULL ){
+	    free_descriptor(span);
+	    return NULL;
+	}
+    }
+    if ( pagemap_set(span, span) != 0 ){
+	release_span(span);
+	return NULL;
+    }
+    span->size_class = LARGE_SPAN;
+    return (void*)ROUND_UP((uintptr_t)span->start, alignment);
+}
+
+/*freed pages are cached while cache is not full, because each mmap
+ *and munmap is a search in pages bitmap*/
+static void large_free(struct ZSpan* span){
+    struct ZMalloc* this = &s_zmalloc;
+    if ( span->mapped &&
+	 this->large_cache_pages + span->pages <= ZMALLOC_LARGE_CACHE_PAGES ){
+	pagemap_set(span, NULL);
+	list_push(&this->large_cache, span);
+	this->large_cache_pages += span->pages;
+    }
+    else{
+	release_span(span);
+    }
+}
+
+/*Object is resized in place only: if zmremap moved it then old pages
+ *would be unmapped before it's known that new pages fit pagemap, so
+ *zrealloc moves object into new one instead and keeps it intact if
+ *new object can't be allocated.
+ *@return address of object, or NULL if it can't be resized in place*/
+static void* large_remap(struct ZSpan* span, size_t size){
+    if ( size >= MAX_LARGE_SIZE ) return NULL;
+    size_t pages = PAGES_COUNT(size);
+    if ( pages == span->pages ) return span->start;
+    if ( PAGE_INDEX(span->start) + pages > ZMALLOC_MAX_PAGES_COUNT ) return NULL;
+    char* addr = zmremap(span->start, PAGES_SIZE(span->pages),
+			 PAGES_SIZE(pages), 0);
+    if ( addr == MAP_FAILED ) return NULL;
+    pagemap_set(span, NULL);
+    span->pages = pages;
+    pagemap_set(span, span);
+    return addr;
+}
+
+static size_t usable_size(struct ZSpan* span, const void* ptr){
+    if ( span->size_class == LARGE_SPAN )
+	return span->start + PAGES_SIZE(span->pages) - (const char*)ptr;
+    else
+	return small_object(span, ptr) + s_zmalloc.class_size[span->size_class]
+	    - (const char*)ptr;
+}
+
+
+/*********** interface *************/
+
+void* zmalloc(size_t size){
+    void* ptr;
+    if ( !s_zmalloc.inited ) zmalloc_init();
+    if ( size <= ZMALLOC_MAX_SMALL_SIZE )
+	ptr = small_alloc(size);
+    else
+	ptr = large_alloc(size, ZMALLOC_PAGE_SIZE);
+    if ( ptr == NULL ) errno = ENOMEM;
+    return ptr;
+}
+
+void zfree(void* ptr){
+    if ( ptr == NULL ) return;
+    struct ZSpan* span = span_of(ptr);
+    assert(span != NULL);
+    if ( span->size_class == LARGE_SPAN )
+	large_free(span);
+    else
+	small_free(span, ptr);
+}
+
+void* zcalloc(size_t nmemb, size_t size){
+    if ( size != 0 && nmemb > (size_t)-1 / size ){
+	errno = ENOMEM;
+	return NULL;
+    }
+    /*reused pages of mmap emulation are not zeroed*/
+    void* ptr = zmalloc(nmemb*size);
+    if ( ptr != NULL ) memset(ptr, '\0', nmemb*size);
+    return ptr;
+}
+
+void* zrealloc(void* ptr, size_t size){
+    void* new_ptr;
+    if ( ptr == NULL ) return zmalloc(size);
+    if ( size == 0 ){
+	zfree(ptr);
+	return NULL;
+    }
+    struct ZSpan* span = span_of(ptr);
+    assert(span != NULL);
+    size_t usable = usable_size(span, ptr);
+    if ( span->size_class != LARGE_SPAN ){
+	if ( size <= usable ) return ptr;
+    }
+    else if ( size > ZMALLOC_MAX_SMALL_SIZE ){
+	if ( span->mapped && ptr == span->start &&
+	     (new_ptr = large_remap(span, size)) != NULL )
+	    return new_ptr;
+	if ( size <= usable ) return ptr;
+    }
+    if ( (new_ptr = zmalloc(size)) == NULL ) return NULL;
+    memcpy(new_ptr, ptr, usable < size ? usable : size);
+    zfree(ptr);
+    return new_ptr;
+}
+
+void* zmemalign(size_t alignment, size_t size){
+    void* ptr;
+    if ( alignment == 0 || (alignment & (alignment-1)) != 0 ){
+	errno = EINVAL;
+	return NULL;
+    }
+    if ( alignment <= ZMALLOC_ALIGN ) return zmalloc(size);
+    if ( !s_zmalloc.inited ) zmalloc_init();
+    /*aligned pointer is located inside of bigger object, and it's not
+      the end of object even for zero size*/
+    if ( size == 0 ) size = 1;
+    if ( size <= ZMALLOC_MAX_SMALL_SIZE &&
+	 alignment <= ZMALLOC_MAX_SMALL_SIZE + ZMALLOC_ALIGN - size ){
+	ptr = small_alloc(size + alignment - ZMALLOC_ALIGN);
+	if ( ptr != NULL ) ptr = (void*)ROUND_UP((uintptr_t)ptr, alignment);
+    }
+    else{
+	ptr = large_alloc(size, alignment > ZMALLOC_PAGE_SIZE ? alignment : ZMALLOC_PAGE_SIZE);
+    }
+    if ( ptr == NULL ) errno = ENOMEM;
+    return ptr;
+}
+
+int zmalloc_owns(const void* ptr){
+    return ptr != NULL && span_of(ptr) != NULL;
+}
+
+size_t zmalloc_usable_size(void* ptr){
+    if ( ptr == NULL ) return 0;
+    struct ZSpan* span = span_of(ptr);
+    assert(span != NULL);
+    return usable_size(span, ptr);
+}
@@ -0,0 +1,60 @@
+/*
+ * zmalloc.h
+ * Size-class allocator tuned for ZeroVM single heap: small objects are
+ * allocated from slabs located in brk, large objects are mapped by
+ * mmap emulation of ZRT;
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ZMALLOC_H__
+#define __ZMALLOC_H__
+
+#include <stddef.h> //size_t
+
+/*allocator page is the same as page of ZRT mmap emulation*/
+#define ZMALLOC_PAGE_SHIFT 16
+#define ZMALLOC_PAGE_SIZE (1<<ZMALLOC_PAGE_SHIFT)
+/*pages map covers 4GB of address space, the whole zerovm heap*/
+#define ZMALLOC_MAX_PAGES_COUNT (1<<(32-ZMALLOC_PAGE_SHIFT))
+/*alignment of all allocated objects*/
+#define ZMALLOC_ALIGN 16
+/*objects up to this size are allocated from slabs of size classes,
+ *bigger objects are mapped*/
+#define ZMALLOC_MAX_SMALL_SIZE 0x8000
+/*minimal count of objects in slab of size class*/
+#define ZMALLOC_SLAB_MIN_OBJECTS 8
+/*pages of freed large objects kept to reuse them without mmap*/
+#define ZMALLOC_LARGE_CACHE_PAGES 32
+
+/*Allocator is not locked, it's safe for cooperative pth threads of
+ *ZRT. Functions are the same as libc ones, errno is set to ENOMEM if
+ *memory is not available*/
+void*  zmalloc(size_t size);
+void   zfree(void* ptr);
+void*  zcalloc(size_t nmemb, size_t size);
+/*Large objects are resized in place by zmremap if pages following
+ *object are not mapped, otherwise object is moved*/
+void*  zrealloc(void* ptr, size_t size);
+/*@param alignment power of 2, otherwise NULL is returned and errno
+ *is EINVAL*/
+void*  zmemalign(size_t alignment, size_t size);
+/*@return count of bytes available at ptr, it's not less than requested*/
+size_t zmalloc_usable_size(void* ptr);
+/*@return 1 if ptr is allocated by zmalloc, 0 for NULL or for pointer
+ *allocated by another allocator*/
+int    zmalloc_owns(const void* ptr);
+
+#endif //__ZMALLOC_H__
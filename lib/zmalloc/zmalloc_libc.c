@@ -0,0 +1,87 @@
+/*
+ * zmalloc_libc.c
+ * libc allocation functions replaced by zmalloc at link time by
+ * linker option --wrap, see ZMALLOC_LDFLAGS of Makefile.env; Object
+ * is not linked into nexe if --wrap is not used;
+ * glibc allocates some objects internally by its own malloc, bypassing
+ * wrapped one, and frees them by wrapped free, so pointers that are not
+ * allocated by zmalloc are passed to glibc functions;
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+
+#include "zrt_defines.h" //ROUND_UP
+#include "zmalloc.h"
+
+/*glibc functions, resolved by --wrap*/
+void   __real_free(void* ptr);
+void*  __real_realloc(void* ptr, size_t size);
+size_t __real_malloc_usable_size(void* ptr);
+
+void* __wrap_malloc(size_t size){
+    return zmalloc(size);
+}
+
+void __wrap_free(void* ptr){
+    if ( ptr == NULL || zmalloc_owns(ptr) )
+	zfree(ptr);
+    else
+	__real_free(ptr);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size){
+    return zcalloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size){
+    if ( ptr == NULL || zmalloc_owns(ptr) )
+	return zrealloc(ptr, size);
+    else
+	return __real_realloc(ptr, size);
+}
+
+void* __wrap_memalign(size_t alignment, size_t size){
+    return zmemalign(alignment, size);
+}
+
+/*error is returned, errno is not changed*/
+int __wrap_posix_memalign(void** memptr, size_t alignment, size_t size){
+    int saved_errno = errno;
+    void* ptr;
+    if ( alignment % sizeof(void*) != 0 || (alignment & (alignment-1)) != 0 )
+	return EINVAL;
+    ptr = zmemalign(alignment, size);
+    errno = saved_errno;
+    if ( ptr == NULL ) return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void* __wrap_valloc(size_t size){
+    return zmemalign(ZMALLOC_PAGE_SIZE, size);
+}
+
+void* __wrap_pvalloc(size_t size){
+    return zmemalign(ZMALLOC_PAGE_SIZE, ROUND_UP(size, ZMALLOC_PAGE_SIZE));
+}
+
+size_t __wrap_malloc_usable_size(void* ptr){
+    if ( ptr == NULL || zmalloc_owns(ptr) )
+	return zmalloc_usable_size(ptr);
+    else
+	return __real_malloc_usable_size(ptr);
+}
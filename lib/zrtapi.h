@@ -19,10 +19,59 @@
 #ifndef __ZRT_API_H__
 #define __ZRT_API_H__
 
+/*lseek whence values to find data and holes in sparse files of
+ *in-memory filesystem, defined here if libc headers lack them*/
+#ifndef SEEK_DATA
+#  define SEEK_DATA 3
+#endif
+#ifndef SEEK_HOLE
+#  define SEEK_HOLE 4
+#endif
+
+#include <stddef.h> //size_t
+
+/*mremap flag, defined here if libc headers lack it*/
+#ifndef MREMAP_MAYMOVE
+#  define MREMAP_MAYMOVE 1
+#endif
+
 /*call zvm_fork() and then reread nvram file and remount removable tar images
  *@return zvm_fork result*/
 int zfork();
 
+/*Resize memory mapping created by mmap, mapping is grown in place if
+ *pages following it are not mapped, otherwise it's moved if flags
+ *contains MREMAP_MAYMOVE.
+ *@return new address of mapping, or MAP_FAILED and errno is set*/
+void* zmremap(void *old_address, size_t old_size, size_t new_size, int flags);
+
+/*Fragmentation report of heap range used by mmap, filled by zmemstat()*/
+struct zmemstat{
+    size_t page_size;        /*size of mmap page*/
+    size_t free_pages;       /*count of not mapped pages located upper than brk*/
+    size_t largest_free_run; /*pages count of the largest free range, it's
+			       the largest mmap that can succeed*/
+    size_t free_runs;        /*count of free ranges*/
+    size_t brk_mmap_gap;     /*bytes between brk and the lowest mapping*/
+};
+
+/*Get fragmentation report of mmap region, it's cheap enough to be
+ *called periodically by long running jobs.
+ *@return 0 if OK, or -1 and errno is set*/
+int zmemstat(struct zmemstat* stat);
+
+/*Deploy report of tar images unpacked at startup or by zfork, filled
+ *by zimagestat(), values are summed for all deployed images*/
+struct zimagestat{
+    long long deployed_bytes; /*bytes of files data copied from images*/
+    long long deploy_msec;    /*time spent to deploy images*/
+    int       images_count;   /*count of deployed images*/
+};
+
+/*Get deploy report of images, to compare startup cost of big images.
+ *@return 0 if OK, or -1 and errno is set*/
+int zimagestat(struct zimagestat* stat);
+
 /*It is intended to use for debugging purposes when using c code
  instrumentation aka ptrace; Tracing is not allowed while environment 
  not fully constructed.
@@ -0,0 +1,32 @@
+/*
+ * Helpers shared by benchmarks located in possible_slow_autotests
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BENCH_HELPERS_H__
+#define __BENCH_HELPERS_H__
+
+#include <stddef.h>
+#include <sys/time.h>
+
+/*@return microseconds elapsed since start*/
+static inline double bench_elapsed_usec(const struct timeval* start){
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec)*1000000.0 + (now.tv_usec - start->tv_usec);
+}
+
+#endif //__BENCH_HELPERS_H__
@@ -0,0 +1,137 @@
+/*
+ * bitarray test: search of free bits sequences and runs, ranges
+ * setting and clearing, free bits counter
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "bitarray.h"
+
+/*not multiple of 64 to check the tail of the last word*/
+#define BITS_COUNT 5000
+#define RANDOM_OPERATIONS_COUNT 10000
+
+static char s_bits[BITS_COUNT];
+
+/*@return index of first sequence of len zero bits of s_bits*/
+static int
+simple_search(int begin, int len){
+    int i, run=0;
+    for ( i=begin; i < BITS_COUNT; i++ ){
+	if ( s_bits[i] ) run=0;
+	else if ( ++run == len ) return i-len+1;
+    }
+    return -1;
+}
+
+/*@return length of first sequence of zero bits of s_bits*/
+static int
+simple_run(int begin, int *run_begin){
+    int i, len=0;
+    for ( i=begin; i < BITS_COUNT; i++ ){
+	if ( !s_bits[i] ){
+	    if ( !len++ ) *run_begin = i;
+	}
+	else if ( len ) break;
+    }
+    return len;
+}
+
+/*@return count of operations results differing from s_bits*/
+static int
+random_operations(struct BitArrayPublicInterface* bitarray){
+    int i, j, wrong=0;
+    for ( i=0; i < RANDOM_OPERATIONS_COUNT; i++ ){
+	int index = rand() % BITS_COUNT;
+	int count = rand() % (BITS_COUNT-index+1);
+	if ( rand()%2 ) count %= 100;
+	switch( rand()%3 ){
+	case 0:
+	    bitarray->set_range(bitarray, index, count);
+	    for ( j=index; j < index+count; j++ ) s_bits[j] = 1;
+	    break;
+	case 1:
+	    bitarray->clear_range(bitarray, index, count);
+	    for ( j=index; j < index+count; j++ ) s_bits[j] = 0;
+	    break;
+	default:
+	    bitarray->toggle_bit(bitarray, index);
+	    s_bits[index] ^= 1;
+	    break;
+	}
+	int len = 1 + rand() % (rand()%2 ? 8 : 300);
+	int begin = rand()%2 ? 0 : rand() % BITS_COUNT;
+	if ( bitarray->search_emptybit_sequence_begin(bitarray, begin, len)
+	     != simple_search(begin, len) )
+	    ++wrong;
+    }
+    return wrong;
+}
+
+int main(int argc, char **argv)
+{
+    static uint64_t storage[BIT_ARRAY_STORAGE_WORDS(BITS_COUNT)];
+    struct BitArray implem;
+    struct BitArrayPublicInterface* bitarray;
+    int i, ret, empty_bits=0;
+
+    bitarray = bit_array_construct(storage, BITS_COUNT, &implem);
+    TEST_OPERATION_RESULT( bitarray->count_empty_bits(bitarray), &ret, ret==BITS_COUNT );
+    /*bits of the last word beyond array are never found*/
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_sequence_begin(bitarray, 0, BITS_COUNT),
+			   &ret, ret==0 );
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_sequence_begin(bitarray, 0, BITS_COUNT+1),
+			   &ret, ret==-1 );
+
+    /*sequence crossing words*/
+    bitarray->set_range(bitarray, 0, BITS_COUNT);
+    TEST_OPERATION_RESULT( bitarray->count_empty_bits(bitarray), &ret, ret==0 );
+    bitarray->clear_range(bitarray, 60, 70);
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_sequence_begin(bitarray, 0, 70),
+			   &ret, ret==60 );
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_sequence_begin(bitarray, 61, 70),
+			   &ret, ret==-1 );
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_sequence_begin(bitarray, 0, 71),
+			   &ret, ret==-1 );
+    int run_begin;
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_run(bitarray, 0, &run_begin),
+			   &ret, ret==70 && run_begin==60 );
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_run(bitarray, 100, &run_begin),
+			   &ret, ret==30 && run_begin==100 );
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_run(bitarray, 130, &run_begin),
+			   &ret, ret==0 );
+    bitarray->clear_range(bitarray, 0, BITS_COUNT);
+    /*run is limited by the end of array*/
+    TEST_OPERATION_RESULT( bitarray->search_emptybit_run(bitarray, 10, &run_begin),
+			   &ret, ret==BITS_COUNT-10 );
+
+    /*compare with simple implementation*/
+    srand(BITS_COUNT);
+    TEST_OPERATION_RESULT( random_operations(bitarray), &ret, ret==0 );
+    for ( i=0; i < BITS_COUNT; i++ ){
+	if ( !s_bits[i] ) ++empty_bits;
+	assert( bitarray->get_bit(bitarray, i) == s_bits[i] );
+    }
+    TEST_OPERATION_RESULT( bitarray->count_empty_bits(bitarray), &ret, ret==empty_bits );
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * read-ahead of sequential channel testing, buffer size is set to 7
+ * bytes by iobuffer nvram section, so reads are crossing buffer bounds
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+
+#include "macro_tests.h"
+
+/*the same as CHANNEL_READONLY_CONTENT in Makefile*/
+#define CHANNEL_CONTENT "0123456789abcdefghijklmnopqrstuvwxyz"
+
+int main(int argc, char**argv){
+    char buf[sizeof(CHANNEL_CONTENT)];
+    int fd, fd2, ret;
+    memset(buf, '\0', sizeof(buf));
+
+    TEST_OPERATION_RESULT( open(CHANNEL_NAME_READONLY, O_RDONLY), &fd, fd!=-1 );
+    /*read by single bytes*/
+    TEST_OPERATION_RESULT( read(fd, buf, 1), &ret, ret==1 && buf[0]=='0' );
+    TEST_OPERATION_RESULT( read(fd, buf+1, 1), &ret, ret==1 && buf[1]=='1' );
+    /*only buffered data is returned, without waiting for channel*/
+    TEST_OPERATION_RESULT( read(fd, buf+2, 10), &ret, ret==5 );
+    TEST_OPERATION_RESULT( read(fd, buf+7, 5), &ret, ret==5 );
+    TEST_OPERATION_RESULT( memcmp(buf, CHANNEL_CONTENT, 12), &ret, ret==0 );
+    /*sequential channel position is shared by data buffered for another fd*/
+    TEST_OPERATION_RESULT( open(CHANNEL_NAME_READONLY, O_RDONLY), &fd2, fd2!=-1 );
+    TEST_OPERATION_RESULT( read(fd2, buf+12, 2), &ret, ret==2 );
+    TEST_OPERATION_RESULT( close(fd2), &ret, ret==0 );
+    /*seek is not allowed for sequential channel*/
+    TEST_OPERATION_RESULT( lseek(fd, 0, SEEK_SET), &ret, ret==-1 && errno==ESPIPE );
+    /*read larger than buffer size goes directly*/
+    TEST_OPERATION_RESULT( read(fd, buf+14, 20), &ret, ret==20 );
+    TEST_OPERATION_RESULT( read(fd, buf+34, 10), &ret, ret==2 );
+    TEST_OPERATION_RESULT( read(fd, buf+36, 10), &ret, ret==0 );
+    TEST_OPERATION_RESULT( memcmp(buf, CHANNEL_CONTENT, sizeof(CHANNEL_CONTENT)-1), &ret, ret==0 );
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    return 0;
+}
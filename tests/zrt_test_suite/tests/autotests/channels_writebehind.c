@@ -0,0 +1,77 @@
+/*
+ * write-behind buffer of channel testing, buffer size is set in
+ * nvram iobuffer section to 16 bytes for /dev/read-write channel
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+
+#define CHANNEL_NAME "/dev/read-write"
+#define TEST_DATA "0123456789abcdefghijklmnopqrstuvwxyz"
+#define BUFFER_SIZE 16
+
+int main(int argc, char **argv)
+{
+    int fd, fd2, ret, i;
+    char buf[sizeof(TEST_DATA)];
+
+    TEST_OPERATION_RESULT( open(CHANNEL_NAME, O_RDWR), &fd, fd!=-1 );
+    /*small writes are buffered*/
+    for ( i=0; i < 10; i++ ){
+	TEST_OPERATION_RESULT( write(fd, TEST_DATA+i, 1), &ret, ret==1 );
+    }
+    /*reading flushes buffer before*/
+    TEST_OPERATION_RESULT( pread(fd, buf, 10, 0), &ret, ret==10 );
+    TEST_OPERATION_RESULT( memcmp(buf, TEST_DATA, 10), &ret, ret==0 );
+
+    /*write that doesn't fit into buffer*/
+    TEST_OPERATION_RESULT( pwrite(fd, TEST_DATA+10, 4, 10), &ret, ret==4 );
+    TEST_OPERATION_RESULT( pwrite(fd, TEST_DATA+14, BUFFER_SIZE, 14), &ret, ret==BUFFER_SIZE );
+    /*not contiguous write*/
+    TEST_OPERATION_RESULT( pwrite(fd, TEST_DATA+32, 4, 32), &ret, ret==4 );
+    TEST_OPERATION_RESULT( pwrite(fd, TEST_DATA+30, 2, 30), &ret, ret==2 );
+    TEST_OPERATION_RESULT( fsync(fd), &ret, ret==0 );
+    TEST_OPERATION_RESULT( pread(fd, buf, strlen(TEST_DATA), 0), &ret, ret==strlen(TEST_DATA) );
+    TEST_OPERATION_RESULT( memcmp(buf, TEST_DATA, strlen(TEST_DATA)), &ret, ret==0 );
+
+    /*buffered data is written when fd replaced by dup2*/
+    TEST_OPERATION_RESULT( pwrite(fd, "XY", 2, 0), &ret, ret==2 );
+    TEST_OPERATION_RESULT( open(CHANNEL_NAME, O_RDONLY), &fd2, fd2!=-1 );
+    TEST_OPERATION_RESULT( dup2(fd2, fd), &ret, ret==fd );
+    TEST_OPERATION_RESULT( pread(fd, buf, 4, 0), &ret, ret==4 );
+    TEST_OPERATION_RESULT( memcmp(buf, "XY23", 4), &ret, ret==0 );
+    TEST_OPERATION_RESULT( close(fd2), &ret, ret==0 );
+
+    /*buffered data is written on close*/
+    TEST_OPERATION_RESULT( open(CHANNEL_NAME, O_WRONLY), &fd2, fd2!=-1 );
+    TEST_OPERATION_RESULT( pwrite(fd2, "01", 2, 0), &ret, ret==2 );
+    TEST_OPERATION_RESULT( close(fd2), &ret, ret==0 );
+    TEST_OPERATION_RESULT( pread(fd, buf, 4, 0), &ret, ret==4 );
+    TEST_OPERATION_RESULT( memcmp(buf, "0123", 4), &ret, ret==0 );
+
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    return 0;
+}
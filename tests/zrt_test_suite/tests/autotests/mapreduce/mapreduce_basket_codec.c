@@ -0,0 +1,85 @@
+/*
+ * mapreduce basket codec test: compression and decompression of
+ * compressible, random and empty blocks, malformed data handling
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "block_codec.h"
+
+#define BLOCK_SIZE 0x100000
+
+/*@return compressed size*/
+static int TestRoundTrip(const struct BlockCodec *codec, const char *block, int size){
+    int bound = codec->bound(size);
+    char *packed = malloc(bound);
+    char *unpacked = malloc(size+1);
+    int packed_size, ret;
+    assert(packed && unpacked);
+
+    TEST_OPERATION_RESULT( codec->compress(block, size, packed, bound),
+			   &packed_size, packed_size>0 && packed_size<=bound );
+    TEST_OPERATION_RESULT( codec->decompress(packed, packed_size, unpacked, size),
+			   &ret, ret==size );
+    TEST_OPERATION_RESULT( memcmp(block, unpacked, size), &ret, ret==0 );
+    /*decompression into smaller block and truncated data are errors*/
+    if ( size > 0 ){
+	TEST_OPERATION_RESULT( codec->decompress(packed, packed_size, unpacked, size-1),
+			       &ret, ret==-1 );
+	TEST_OPERATION_RESULT( codec->decompress(packed, packed_size-1, unpacked, size),
+			       &ret, ret==-1 );
+    }
+    free(packed);
+    free(unpacked);
+    return packed_size;
+}
+
+int main(int argc, char **argv)
+{
+    const struct BlockCodec *codec = &LzBlockCodec;
+    char *block = malloc(BLOCK_SIZE);
+    int i, packed_size;
+    assert(block);
+
+    /*text like data is compressed well*/
+    for ( i=0; i < BLOCK_SIZE; i++ )
+	block[i] = "key value pair"[i%14] + (i/1000)%3;
+    TEST_OPERATION_RESULT( TestRoundTrip(codec, block, BLOCK_SIZE), 
+			   &packed_size, packed_size<BLOCK_SIZE/4 );
+
+    /*random data is not compressed, bound is enough for it*/
+    srand(BLOCK_SIZE);
+    for ( i=0; i < BLOCK_SIZE; i++ )
+	block[i] = rand();
+    TestRoundTrip(codec, block, BLOCK_SIZE);
+
+    /*small and empty blocks*/
+    for ( i=0; i < 32; i++ )
+	TestRoundTrip(codec, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", i);
+
+    /*match offset pointing before the block start*/
+    TEST_OPERATION_RESULT( codec->decompress("\x10" "a" "\x05\x00", 4, block, 5),
+			   &packed_size, packed_size==-1 );
+    free(block);
+    return 0;
+}
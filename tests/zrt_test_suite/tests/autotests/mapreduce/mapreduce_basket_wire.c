@@ -0,0 +1,175 @@
+/*
+ * mapreduce basket wire format test: baskets written by
+ * WriteDataToReduce, as is and compressed by basket codec, must be read
+ * back by RecvDataFromSingleMap into the same items with keys and values
+ * located in arena of received buffer
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+#include <alloca.h>
+
+#include "macro_tests.h"
+#include "map_reduce_lib.h"
+#include "elastic_mr_item.h"
+#include "mr_defines.h"
+#include "buffered_io.h"
+#include "buffer.h"
+
+#define HASH_TYPE uint32_t
+#define ITEM_SIZE sizeof(				\
+			 struct{			\
+			     BinaryData     key_data;	\
+			     BinaryData     value;	\
+			     uint8_t        own_key;	\
+			     uint8_t        own_value;  \
+			     HASH_TYPE      key_hash;	\
+			 })
+#define ITEMS_COUNT 3000
+#define WIRE_PATH "/basket.wire"
+
+static char s_keys[ITEMS_COUNT][16];
+static char s_values[ITEMS_COUNT][32];
+
+static int
+ComparatorHash(const void *h1, const void *h2){
+    HASH_TYPE hash1, hash2;
+    memcpy(&hash1, h1, sizeof(HASH_TYPE));
+    memcpy(&hash2, h2, sizeof(HASH_TYPE));
+    if      ( hash1 < hash2 ) return -1;
+    else if ( hash1 > hash2 ) return 1;
+    else return 0;
+}
+
+static int
+ComparatorMrItem(const void *p1, const void *p2){
+    return ComparatorHash( &((const ElasticBufItemData*)p1)->key_hash,
+			   &((const ElasticBufItemData*)p2)->key_hash );
+}
+
+/*sorted map of items having keys and values of different sizes, data
+  is not owned by items*/
+static void
+CreateMap( struct MapReduceUserIf *mif, Buffer *map ){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    HASH_TYPE hash;
+    int i, res;
+    res = AllocBuffer(map, ITEM_SIZE, ITEMS_COUNT);
+    assert(res==0);
+    memset(item, '\0', ITEM_SIZE);
+    for ( i=0; i < ITEMS_COUNT; i++ ){
+	snprintf(s_keys[i], sizeof(s_keys[i]), "key%d", i);
+	/*repeated values are compressible*/
+	memset(s_values[i], 'v', i % 7 + 1);
+	hash = (HASH_TYPE)i * 2654435761U;
+	item->key_data.addr = (uintptr_t)s_keys[i];
+	item->key_data.size = strlen(s_keys[i])+1;
+	item->value.addr = (uintptr_t)s_values[i];
+	item->value.size = strlen(s_values[i])+1;
+	memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	AddBufferItem(map, item);
+    }
+    LocalSort(mif, map);
+}
+
+/*@return 1 if received items are equal to items range of sent map, and
+  their keys, values are copies located in received buffer*/
+static int
+CheckReceived( const Buffer *map, int start, const Buffer *received ){
+    const ElasticBufItemData *sent, *item;
+    for ( int i=0; i < received->header.count; i++ ){
+	sent = (const ElasticBufItemData*)BufferItemPointer(map, start+i);
+	item = (const ElasticBufItemData*)BufferItemPointer(received, i);
+	if ( ComparatorMrItem(sent, item) ||
+	     item->own_key != EDataNotOwned || item->own_value != EDataNotOwned ||
+	     item->key_data.size != sent->key_data.size ||
+	     item->value.size != sent->value.size ||
+	     item->key_data.addr == sent->key_data.addr ||
+	     item->value.addr == sent->value.addr ||
+	     memcmp((void*)item->key_data.addr, (void*)sent->key_data.addr, sent->key_data.size) ||
+	     memcmp((void*)item->value.addr, (void*)sent->value.addr, sent->value.size) )
+	    return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    struct MapReduceUserIf mif;
+    Buffer map, received;
+    uint64_t raw_bytes, wire_bytes;
+    char c;
+    int fd, ret;
+    void *write_buffer = malloc(SEND_BUFFER_SIZE);
+    BufferedIOWrite* bio = AllocBufferedIOWrite(write_buffer, SEND_BUFFER_SIZE, NULL);
+    assert(write_buffer && bio);
+
+    memset(&mif, '\0', sizeof(mif));
+    PREPARE_MAPREDUCE( &mif, NULL, NULL, NULL,
+		       ComparatorMrItem, ComparatorHash, NULL,
+		       0,    /*value addr is not data*/
+		       ITEM_SIZE,
+		       sizeof(HASH_TYPE) );
+    CreateMap(&mif, &map);
+
+    /*basket sent as is, compressed basket, and empty basket*/
+    TEST_OPERATION_RESULT( open(WIRE_PATH, O_WRONLY|O_CREAT|O_TRUNC, 0666), &fd, fd!=-1 );
+    WriteDataToReduce(&mif, bio, fd, &map, 100, 1000, MAP_NODE_NO_EXCLUDE);
+    SET_MAPREDUCE_BASKET_CODEC(&mif, &LzBlockCodec);
+    WriteDataToReduce(&mif, bio, fd, &map, 1100, ITEMS_COUNT-1100, MAP_NODE_NO_EXCLUDE);
+    TEST_OPERATION_RESULT( mif.data.basket_wire_bytes < mif.data.basket_raw_bytes, &ret, ret==1 );
+    WriteDataToReduce(&mif, bio, fd, &map, ITEMS_COUNT, 0, MAP_NODE_EXCLUDE);
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    raw_bytes = mif.data.basket_raw_bytes;
+    wire_bytes = mif.data.basket_wire_bytes;
+    mif.data.basket_raw_bytes = mif.data.basket_wire_bytes = 0;
+
+    TEST_OPERATION_RESULT( open(WIRE_PATH, O_RDONLY), &fd, fd!=-1 );
+    TEST_OPERATION_RESULT( RecvDataFromSingleMap(&mif, fd, &received), &ret, ret==MAP_NODE_NO_EXCLUDE );
+    TEST_OPERATION_RESULT( received.header.count, &ret, ret==1000 );
+    TEST_OPERATION_RESULT( CheckReceived(&map, 100, &received), &ret, ret==1 );
+    TEST_OPERATION_RESULT( BufferArenaBytes(&received) > 0, &ret, ret==1 );
+    FreeBufferData(&received);
+
+    TEST_OPERATION_RESULT( RecvDataFromSingleMap(&mif, fd, &received), &ret, ret==MAP_NODE_NO_EXCLUDE );
+    TEST_OPERATION_RESULT( received.header.count, &ret, ret==ITEMS_COUNT-1100 );
+    TEST_OPERATION_RESULT( CheckReceived(&map, 1100, &received), &ret, ret==1 );
+    FreeBufferData(&received);
+
+    TEST_OPERATION_RESULT( RecvDataFromSingleMap(&mif, fd, &received), &ret, ret==MAP_NODE_EXCLUDE );
+    TEST_OPERATION_RESULT( received.header.count, &ret, ret==0 );
+    TEST_OPERATION_RESULT( BufferArenaBytes(&received), &ret, ret==0 );
+    FreeBufferData(&received);
+
+    /*receiver has read exactly written baskets*/
+    TEST_OPERATION_RESULT( read(fd, &c, 1), &ret, ret==0 );
+    TEST_OPERATION_RESULT( mif.data.basket_raw_bytes == raw_bytes, &ret, ret==1 );
+    TEST_OPERATION_RESULT( mif.data.basket_wire_bytes == wire_bytes, &ret, ret==1 );
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+
+    FreeBufferData(&map);
+    free(bio);
+    free(write_buffer);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * mapreduce buffer arena test: aligned bump allocations, big
+ * allocations, moving arena between buffers and freeing it with buffer
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "buffer.h"
+
+#define KEYS_COUNT 10000
+#define BIG_SIZE (BUFFER_ARENA_BLOCK_SIZE*2)
+
+/*fill buffer by items pointing to keys copied into its arena*/
+/*@return count of misaligned copies*/
+static int FillKeys(Buffer *buf){
+    char key[32];
+    int i, ret, misaligned=0;
+    ret = AllocBuffer(buf, sizeof(char*), 100);
+    assert(ret==0);
+    for ( i=0; i < KEYS_COUNT; i++ ){
+	sprintf(key, "key%d", i);
+	char *copy = BufferArenaCopy(buf, key, strlen(key)+1);
+	assert(copy);
+	if ( (uintptr_t)copy & (BUFFER_ARENA_ALIGN-1) ) ++misaligned;
+	AddBufferItem(buf, &copy);
+    }
+    return misaligned;
+}
+
+/*@return count of keys differing from expected*/
+static int CheckKeys(const Buffer *buf){
+    char key[32];
+    char *copy;
+    int i, wrong=0;
+    for ( i=0; i < KEYS_COUNT; i++ ){
+	sprintf(key, "key%d", i);
+	GetBufferItem(buf, i, &copy);
+	if ( strcmp(copy, key) ) ++wrong;
+    }
+    return wrong;
+}
+
+int main(int argc, char **argv)
+{
+    Buffer buf, dest;
+    char *small, *big, *next;
+    int ret;
+
+    TEST_OPERATION_RESULT( FillKeys(&buf), &ret, ret==0 );
+    TEST_OPERATION_RESULT( CheckKeys(&buf), &ret, ret==0 );
+
+    /*big allocation doesn't waste current block*/
+    small = BufferArenaAlloc(&buf, 1);
+    big = BufferArenaAlloc(&buf, BIG_SIZE);
+    next = BufferArenaAlloc(&buf, 1);
+    TEST_OPERATION_RESULT( big!=NULL, &ret, ret==1 );
+    memset(big, 'a', BIG_SIZE);
+    TEST_OPERATION_RESULT( next==small+BUFFER_ARENA_ALIGN, &ret, ret==1 );
+
+    /*items moved into another buffer still refer valid keys after
+      source buffer freed with its arena*/
+    ret = AllocBuffer(&dest, sizeof(char*), KEYS_COUNT);
+    assert(ret==0);
+    memcpy(dest.data, buf.data, KEYS_COUNT*sizeof(char*));
+    dest.header.count = KEYS_COUNT;
+    BufferArenaCopy(&dest, "dest", 5);
+    MoveBufferArena(&dest, &buf);
+    TEST_OPERATION_RESULT( buf.arena==NULL, &ret, ret==1 );
+    FreeBufferData(&buf);
+    TEST_OPERATION_RESULT( CheckKeys(&dest), &ret, ret==0 );
+    TEST_OPERATION_RESULT( big[BIG_SIZE-1], &ret, ret=='a' );
+
+    FreeBufferData(&dest);
+    TEST_OPERATION_RESULT( dest.arena==NULL, &ret, ret==1 );
+    /*arena can be used again after buffer freed*/
+    TEST_OPERATION_RESULT( BufferArenaAlloc(&dest, 1)!=NULL, &ret, ret==1 );
+    FreeBufferData(&dest);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * mapreduce hash combiner test: map items aggregated by hash table and
+ * user MergeValues must be equal to result of sort and Combine
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+#include <alloca.h>
+
+#include "macro_tests.h"
+#include "map_reduce_lib.h"
+#include "elastic_mr_item.h"
+#include "mr_defines.h"
+#include "buffer.h"
+
+#define HASH_TYPE uint32_t
+#define ITEM_SIZE sizeof(				\
+			 struct{			\
+			     BinaryData     key_data;	\
+			     BinaryData     value;	\
+			     uint8_t        own_key;	\
+			     uint8_t        own_value;  \
+			     HASH_TYPE      key_hash;	\
+			 })
+#define WORDS_COUNT 100000
+#define DISTINCT_WORDS 3000
+/*keys having the same hash but different data*/
+#define COLLISION_HASH 7
+
+static char*
+PrintableHash( char* str, const uint8_t* hash, int size){
+    HASH_TYPE h;
+    memcpy(&h, hash, sizeof(h));
+    sprintf(str, "%X", h);
+    return str;
+}
+
+static int
+ComparatorHash(const void *h1, const void *h2){
+    HASH_TYPE hash1, hash2;
+    memcpy(&hash1, h1, sizeof(HASH_TYPE));
+    memcpy(&hash2, h2, sizeof(HASH_TYPE));
+    if      ( hash1 < hash2 ) return -1;
+    else if ( hash1 > hash2 ) return 1;
+    else return 0;
+}
+
+/*items of equal hashes are ordered by key, so both combiners give the
+  same order*/
+static int
+ComparatorMrItem(const void *p1, const void *p2){
+    const ElasticBufItemData* item1 = (const ElasticBufItemData*)p1;
+    const ElasticBufItemData* item2 = (const ElasticBufItemData*)p2;
+    int res = ComparatorHash( &item1->key_hash, &item2->key_hash );
+    if ( res ) return res;
+    return strcmp( (const char*)item1->key_data.addr, (const char*)item2->key_data.addr );
+}
+
+/*word count: every word is a key owned by item, value is a count*/
+static int
+Map(const char *data, size_t size, int last_chunk, Buffer *map_buffer ){
+    ElasticBufItemData* item = alloca(map_buffer->header.item_size);
+    char word[32];
+    HASH_TYPE hash;
+    int i, number;
+    srand(WORDS_COUNT);
+    memset(item, '\0', map_buffer->header.item_size);
+    for ( i=0; i < WORDS_COUNT; i++ ){
+	number = rand() % DISTINCT_WORDS;
+	snprintf(word, sizeof(word), "word%d", number);
+	hash = number % 100 == 0 ? COLLISION_HASH : (HASH_TYPE)number * 2654435761U;
+	item->key_data.addr = (uintptr_t)strdup(word);
+	item->key_data.size = strlen(word)+1;
+	item->own_key = EDataOwned;
+	item->value.addr = 1;
+	memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	AddBufferItem(map_buffer, item);
+    }
+    return size;
+}
+
+static int
+Combine( const Buffer *map_buffer, Buffer *reduce_buffer ){
+    ElasticBufItemData* combine = alloca(map_buffer->header.item_size);
+    ElasticBufItemData* current;
+    int i;
+    for ( i=0; i < map_buffer->header.count; i++ ){
+	current = (ElasticBufItemData*)BufferItemPointer(map_buffer, i);
+	if ( i > 0 && !ComparatorMrItem(combine, current) ){
+	    combine->value.addr += current->value.addr;
+	    free((void*)current->key_data.addr);
+	}
+	else{
+	    if ( i > 0 ) AddBufferItem(reduce_buffer, combine);
+	    GetBufferItem(map_buffer, i, combine);
+	}
+    }
+    if ( map_buffer->header.count > 0 )
+	AddBufferItem(reduce_buffer, combine);
+    return 0;
+}
+
+static void
+MergeValues( ElasticBufItemData *dest, ElasticBufItemData *src ){
+    dest->value.addr += src->value.addr;
+}
+
+static int
+Reduce( const Buffer *reduce_buffer ){
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct MapReduceUserIf mif;
+    Buffer combined, aggregated;
+    int i, ret;
+    char input[] = "input";
+
+    memset(&mif, '\0', sizeof(mif));
+    PREPARE_MAPREDUCE( &mif, Map, Combine, Reduce,
+		       ComparatorMrItem, ComparatorHash, PrintableHash,
+		       1,    /*value addr is data*/
+		       ITEM_SIZE,
+		       sizeof(HASH_TYPE) );
+    MapInputDataLocalProcessing(&mif, input, sizeof(input), 1, &combined);
+
+    SET_MAPREDUCE_HASH_COMBINER(&mif, MergeValues);
+    MapInputDataLocalProcessing(&mif, input, sizeof(input), 1, &aggregated);
+
+    TEST_OPERATION_RESULT( aggregated.header.count, &ret, ret==combined.header.count );
+    TEST_OPERATION_RESULT( aggregated.header.count <= DISTINCT_WORDS, &ret, ret==1 );
+    uintptr_t words_count = 0;
+    for ( i=0; i < aggregated.header.count; i++ ){
+	const ElasticBufItemData* item1 = (const ElasticBufItemData*)BufferItemPointer(&combined, i);
+	const ElasticBufItemData* item2 = (const ElasticBufItemData*)BufferItemPointer(&aggregated, i);
+	if ( ComparatorMrItem(item1, item2) != 0 || item1->value.addr != item2->value.addr ){
+	    error(EXIT_FAILURE, 0, "item #%d differs: %s=%u, %s=%u", i, 
+		  (const char*)item1->key_data.addr, (uint32_t)item1->value.addr,
+		  (const char*)item2->key_data.addr, (uint32_t)item2->value.addr );
+	}
+	words_count += item2->value.addr;
+	free((void*)item1->key_data.addr);
+	free((void*)item2->key_data.addr);
+    }
+    TEST_OPERATION_RESULT( words_count, &ret, ret==WORDS_COUNT );
+
+    FreeBufferData(&combined);
+    FreeBufferData(&aggregated);
+    return 0;
+}
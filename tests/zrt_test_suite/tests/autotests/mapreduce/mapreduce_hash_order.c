@@ -0,0 +1,127 @@
+/*
+ * mapreduce hash order test: LocalSort by radix of hash prefix for
+ * EHashOrderBytes must give the same order as qsort by user comparator,
+ * for hashes longer than prefix and for items having equal hashes
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+#include <alloca.h>
+
+#include "macro_tests.h"
+#include "map_reduce_lib.h"
+#include "elastic_mr_item.h"
+#include "mr_defines.h"
+#include "buffer.h"
+
+/*hash is longer than 8 bytes prefix used by radix sort*/
+#define HASH_BYTES 16
+#define ITEM_SIZE sizeof(				\
+			 struct{			\
+			     BinaryData     key_data;	\
+			     BinaryData     value;	\
+			     uint8_t        own_key;	\
+			     uint8_t        own_value;  \
+			     uint8_t        key_hash[HASH_BYTES]; \
+			 })
+#define ITEMS_COUNT 20000
+
+static int
+ComparatorHash(const void *h1, const void *h2){
+    return memcmp(h1, h2, HASH_BYTES);
+}
+
+/*items of equal hashes are ordered by value*/
+static int
+ComparatorMrItem(const void *p1, const void *p2){
+    const ElasticBufItemData* item1 = (const ElasticBufItemData*)p1;
+    const ElasticBufItemData* item2 = (const ElasticBufItemData*)p2;
+    int res = ComparatorHash( &item1->key_hash, &item2->key_hash );
+    if ( res ) return res;
+    if      ( item1->value.addr < item2->value.addr ) return -1;
+    else if ( item1->value.addr > item2->value.addr ) return 1;
+    else return 0;
+}
+
+/*fill buffer by the same pseudo random items for every call; bytes
+  of prefix and of hash tail get few values, so many items have equal
+  prefixes, differ only after prefix or have equal hashes*/
+static void FillItems(Buffer *buf){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    uint8_t hash[HASH_BYTES];
+    int i, j, res;
+    res = AllocBuffer(buf, ITEM_SIZE, ITEMS_COUNT);
+    assert(res==0);
+    memset(item, '\0', ITEM_SIZE);
+    srand(ITEMS_COUNT);
+    for ( i=0; i < ITEMS_COUNT; i++ ){
+	memset(hash, '\0', sizeof(hash));
+	for ( j=0; j < 8; j++ )
+	    hash[j] = rand() % 2 ? 0x80 : 0x01;
+	hash[8] = rand() % 2;
+	hash[HASH_BYTES-1] = rand() % 4;
+	memcpy(&item->key_hash, hash, HASH_BYTES);
+	/*reversed index makes insertion order differ from sorted one*/
+	item->value.addr = ITEMS_COUNT - i;
+	AddBufferItem(buf, item);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct MapReduceUserIf mif;
+    Buffer expected, sorted;
+    int i, ret, equal_hashes = 0;
+
+    memset(&mif, '\0', sizeof(mif));
+    PREPARE_MAPREDUCE( &mif, NULL, NULL, NULL,
+		       ComparatorMrItem, ComparatorHash, NULL,
+		       1,    /*value addr is data*/
+		       ITEM_SIZE,
+		       HASH_BYTES );
+
+    /*order by user comparator only*/
+    FillItems(&expected);
+    LocalSort(&mif, &expected);
+
+    SET_MAPREDUCE_HASH_ORDER(&mif, EHashOrderBytes);
+    FillItems(&sorted);
+    LocalSort(&mif, &sorted);
+
+    TEST_OPERATION_RESULT( sorted.header.count, &ret, ret==ITEMS_COUNT );
+    for ( i=1; i < sorted.header.count; i++ ){
+	const ElasticBufItemData* prev = (const ElasticBufItemData*)BufferItemPointer(&sorted, i-1);
+	const ElasticBufItemData* item = (const ElasticBufItemData*)BufferItemPointer(&sorted, i);
+	if ( ComparatorMrItem(prev, item) >= 0 )
+	    error(EXIT_FAILURE, 0, "items #%d, #%d are not sorted", i-1, i);
+	if ( !ComparatorHash(&prev->key_hash, &item->key_hash) )
+	    ++equal_hashes;
+    }
+    /*test data must contain ties to be checked*/
+    TEST_OPERATION_RESULT( equal_hashes > 0, &ret, ret==1 );
+    TEST_OPERATION_RESULT( memcmp(expected.data, sorted.data, ITEMS_COUNT*ITEM_SIZE),
+			   &ret, ret==0 );
+
+    FreeBufferData(&expected);
+    FreeBufferData(&sorted);
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * mapreduce pipelined map node test: map node sending chunks by sender
+ * thread if MAP_PIPELINE is set must write to reducers exactly the same
+ * baskets as map node sending every chunk before mapping next one
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <error.h>
+#include <errno.h>
+
+#include "macro_tests.h"
+#include "channels_conf.h"
+#include "mapreduce_runs.h"
+
+#define INPUT_PATH "/map_pipeline.input"
+#define OUTPUT_PATH_FORMAT "/map_pipeline%s.reducer%d"
+#define REDUCERS_COUNT 3
+/*input is fixed size records "k%06d\n", chunk is multiple of record,
+  and the last chunk is incomplete*/
+#define RECORD_SIZE 8
+#define CHUNK_RECORDS 1000
+#define RECORDS_COUNT (20*CHUNK_RECORDS+1)
+
+static char*
+PrintableHash( char* str, const uint8_t* hash, int size){
+    HASH_TYPE h;
+    memcpy(&h, hash, sizeof(h));
+    sprintf(str, "%X", h);
+    return str;
+}
+
+/*item for every record, key refers to input buffer*/
+static int
+Map( const char *data, size_t size, int last_chunk, Buffer *map_buffer ){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    HASH_TYPE hash;
+    size_t pos;
+    memset(item, '\0', ITEM_SIZE);
+    for ( pos=0; pos+RECORD_SIZE <= size; pos+=RECORD_SIZE ){
+	hash = KeyHash(atoi(data+pos+1));
+	item->key_data.addr = (uintptr_t)(data+pos);
+	item->key_data.size = RECORD_SIZE-1;
+	item->own_key = EDataNotOwned;
+	item->value.addr = 1;
+	memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	AddBufferItem(map_buffer, item);
+    }
+    return pos;
+}
+
+/*map node doesn't reduce*/
+static int
+Reduce( const Buffer *reduce_buffer ){
+    return 0;
+}
+
+static void
+WriteInput(){
+    FILE* f;
+    int i, ret;
+    TEST_OPERATION_RESULT( (f = fopen(INPUT_PATH, "w"))!=NULL, &ret, ret==1 );
+    srand(RECORDS_COUNT);
+    for ( i=0; i < RECORDS_COUNT; i++ )
+	fprintf(f, "k%06d\n", rand() % KEYS_COUNT);
+    TEST_OPERATION_RESULT( fclose(f), &ret, ret==0 );
+}
+
+/*Run single map node for input file, baskets sent to every reducer
+ *are written into own file
+ *@param pipeline value of MAP_PIPELINE
+ *@param suffix of output files*/
+static void
+RunMapNode( const char* pipeline, const char* suffix ){
+    struct MapReduceUserIf mif;
+    struct ChannelsConfigInterface chif;
+    char path[PATH_MAX];
+    int fdr, fdw[REDUCERS_COUNT];
+    int i, ret;
+
+    PrepareRunsMapReduce(&mif, Reduce);
+    mif.Map = Map;
+    mif.DebugHashAsString = PrintableHash;
+    setenv(MAP_PIPELINE_ENV, pipeline, 1);
+
+    SetupChannelsConfigInterface(&chif, 1, EMapNode);
+    TEST_OPERATION_RESULT( open(INPUT_PATH, O_RDONLY), &fdr, fdr!=-1 );
+    chif.AddChannel(&chif, EInputOutputNode, 1, fdr, EChannelModeRead);
+    /*single map node, histograms are not sent*/
+    chif.AddChannel(&chif, EMapNode, 1, fdr, EChannelModeWrite);
+    for ( i=0; i < REDUCERS_COUNT; i++ ){
+	snprintf(path, sizeof(path), OUTPUT_PATH_FORMAT, suffix, i+1);
+	TEST_OPERATION_RESULT( open(path, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR),
+			       &fdw[i], fdw[i]!=-1 );
+	chif.AddChannel(&chif, EReduceNode, i+1, fdw[i], EChannelModeWrite);
+    }
+
+    TEST_OPERATION_RESULT( MapNodeMain(&mif, &chif), &ret, ret==0 );
+    TEST_OPERATION_RESULT( mif.data.basket_raw_bytes > 0, &ret, ret==1 );
+
+    for ( i=0; i < REDUCERS_COUNT; i++ )
+	TEST_OPERATION_RESULT( close(fdw[i]), &ret, ret==0 );
+    TEST_OPERATION_RESULT( close(fdr), &ret, ret==0 );
+    chif.Free(&chif);
+    FreeBufferData(&mif.data.dividers_list);
+    for ( i=0; i < mif.data.histograms_count; i++ )
+	FreeBufferData(&mif.data.histograms_list[i].buffer);
+    free(mif.data.histograms_list);
+}
+
+/*@return 1 if files of reducer written by both runs are not empty and
+  equal*/
+static int
+OutputsEqual( int reducer ){
+    char path[PATH_MAX];
+    char data1[4096], data2[4096];
+    FILE *f1, *f2;
+    size_t size1, size2, all = 0;
+    int equal = 1;
+    snprintf(path, sizeof(path), OUTPUT_PATH_FORMAT, "", reducer);
+    f1 = fopen(path, "r");
+    snprintf(path, sizeof(path), OUTPUT_PATH_FORMAT, ".pipelined", reducer);
+    f2 = fopen(path, "r");
+    assert(f1 && f2);
+    do{
+	size1 = fread(data1, 1, sizeof(data1), f1);
+	size2 = fread(data2, 1, sizeof(data2), f2);
+	if ( size1 != size2 || memcmp(data1, data2, size1) )
+	    equal = 0;
+	all += size1;
+    }while( equal && size1 > 0 );
+    fclose(f1);
+    fclose(f2);
+    return equal && all > 0;
+}
+
+int main(int argc, char **argv)
+{
+    char chunk_size[32];
+    int i, ret;
+
+    WriteInput();
+    snprintf(chunk_size, sizeof(chunk_size), "%d", CHUNK_RECORDS*RECORD_SIZE);
+    setenv(MAP_CHUNK_SIZE_ENV, chunk_size, 1);
+
+    RunMapNode("0", "");
+    RunMapNode("1", ".pipelined");
+    for ( i=0; i < REDUCERS_COUNT; i++ )
+	TEST_OPERATION_RESULT( OutputsEqual(i+1), &ret, ret==1 );
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * mapreduce reducer runs test: sorted runs are merged and combined by
+ * levels of REDUCE_MERGE_RUNS runs, or all at once if runs exceed
+ * REDUCE_MEMORY_BUDGET; count of Combine calls depends on settings, but
+ * reduced result must be the same
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <error.h>
+#include <errno.h>
+
+#include "macro_tests.h"
+#include "mapreduce_runs.h"
+
+static int s_reduce_calls;
+
+/*every key must be met once in sorted order*/
+static int
+Reduce( const Buffer *reduce_buffer ){
+    const ElasticBufItemData* item;
+    int i;
+    ++s_reduce_calls;
+    for ( i=0; i < reduce_buffer->header.count; i++ ){
+	item = (const ElasticBufItemData*)BufferItemPointer(reduce_buffer, i);
+	if ( i > 0 && ComparatorMrItem(BufferItemPointer(reduce_buffer, i-1), item) >= 0 )
+	    error(EXIT_FAILURE, 0, "reduced item #%d is not sorted", i);
+	AddReduced(item);
+    }
+    return 0;
+}
+
+/*create runs and reset counters of calls*/
+static void
+CreateLevelsRuns( struct MapReduceUserIf *mif, Buffer *runs, int in_arena ){
+    CreateRuns(mif, runs, RUNS_COUNT, in_arena);
+    s_reduce_calls = 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct MapReduceUserIf mif;
+    Buffer runs[RUNS_COUNT];
+    int ret;
+
+    PrepareRunsMapReduce(&mif, Reduce);
+    unsetenv(REDUCE_SPILL_PATH_ENV);
+
+    /*runs are not merged while less than REDUCE_MERGE_RUNS, single
+      final merge and Combine*/
+    setenv(REDUCE_MERGE_RUNS_ENV, "100", 1);
+    unsetenv(REDUCE_MEMORY_BUDGET_ENV);
+    CreateLevelsRuns(&mif, runs, 0);
+    ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1);
+    TEST_OPERATION_RESULT( s_combine_calls, &ret, ret==1 );
+    TEST_OPERATION_RESULT( s_reduce_calls, &ret, ret==1 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+
+    /*every pair of runs of the same level is merged, 8 runs are
+      combined into run of level 3 by 4+2+1 merges, and it's reduced as is*/
+    setenv(REDUCE_MERGE_RUNS_ENV, "2", 1);
+    CreateLevelsRuns(&mif, runs, 0);
+    ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1);
+    TEST_OPERATION_RESULT( s_combine_calls, &ret, ret==7 );
+    TEST_OPERATION_RESULT( s_reduce_calls, &ret, ret==1 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+
+    /*runs are always exceeding tiny memory budget, so all runs are
+      merged after every round of 2 runs*/
+    setenv(REDUCE_MERGE_RUNS_ENV, "100", 1);
+    setenv(REDUCE_MEMORY_BUDGET_ENV, "1", 1);
+    CreateLevelsRuns(&mif, runs, 0);
+    ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 2);
+    TEST_OPERATION_RESULT( s_combine_calls, &ret, ret==RUNS_COUNT/2 );
+    TEST_OPERATION_RESULT( s_reduce_calls, &ret, ret==1 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+
+    /*keys are located in arenas of runs, combined items refer only few
+      keys, so their keys are copied into new arena of merged run and
+      arenas of merged runs are freed*/
+    setenv(REDUCE_MERGE_RUNS_ENV, "2", 1);
+    unsetenv(REDUCE_MEMORY_BUDGET_ENV);
+    CreateLevelsRuns(&mif, runs, 1);
+    ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1);
+    TEST_OPERATION_RESULT( s_combine_calls, &ret, ret==7 );
+    TEST_OPERATION_RESULT( s_reduce_calls, &ret, ret==1 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+
+    /*Reduce is not defined*/
+    mif.Reduce = NULL;
+    CreateLevelsRuns(&mif, runs, 0);
+    TEST_OPERATION_RESULT( ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1), &ret, ret==0 );
+    TEST_OPERATION_RESULT( s_reduce_calls, &ret, ret==0 );
+    return 0;
+}
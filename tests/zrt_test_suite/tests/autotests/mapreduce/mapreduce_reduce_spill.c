@@ -0,0 +1,110 @@
+/*
+ * mapreduce reducer spill test: runs exceeding small REDUCE_MEMORY_BUDGET
+ * are spilled into REDUCE_SPILL_PATH file, and reduced by several sorted
+ * batches; items of equal hash are never divided between batches, spill
+ * of previous reduce is truncated, and reduce fails if spill can't be read
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <error.h>
+#include <errno.h>
+
+#include "macro_tests.h"
+#include "mapreduce_runs.h"
+
+#define SPILL_PATH "/reduce.spill"
+/*spill file giving no data back*/
+#define BROKEN_SPILL_PATH "/dev/null"
+/*every run is bigger than budget, so every round is spilled*/
+#define MEMORY_BUDGET "20000"
+
+static int s_reduce_calls;
+static HASH_TYPE s_last_hash;
+
+/*batches must be sorted, and hash of previous batch can't be repeated*/
+static int
+Reduce( const Buffer *reduce_buffer ){
+    const ElasticBufItemData* item;
+    HASH_TYPE hash;
+    int i;
+    for ( i=0; i < reduce_buffer->header.count; i++ ){
+	item = (const ElasticBufItemData*)BufferItemPointer(reduce_buffer, i);
+	memcpy(&hash, &item->key_hash, sizeof(HASH_TYPE));
+	if ( i == 0 && s_reduce_calls > 0 && hash <= s_last_hash )
+	    error(EXIT_FAILURE, 0, "batch #%d starts by hash of previous batch", s_reduce_calls);
+	if ( i > 0 && hash < s_last_hash )
+	    error(EXIT_FAILURE, 0, "item #%d of batch #%d is not sorted", i, s_reduce_calls);
+	s_last_hash = hash;
+	AddReduced(item);
+    }
+    ++s_reduce_calls;
+    return 0;
+}
+
+/*create runs and reset state of batches check*/
+static void
+CreateSpillRuns( struct MapReduceUserIf *mif, Buffer *runs, int count ){
+    CreateRuns(mif, runs, count, 0);
+    s_reduce_calls = 0;
+    s_last_hash = 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct MapReduceUserIf mif;
+    Buffer runs[RUNS_COUNT];
+    struct stat st;
+    off_t spill_size;
+    int ret;
+
+    PrepareRunsMapReduce(&mif, Reduce);
+    setenv(REDUCE_MERGE_RUNS_ENV, "100", 1);
+    setenv(REDUCE_MEMORY_BUDGET_ENV, MEMORY_BUDGET, 1);
+    setenv(REDUCE_SPILL_PATH_ENV, SPILL_PATH, 1);
+
+    CreateSpillRuns(&mif, runs, RUNS_COUNT);
+    TEST_OPERATION_RESULT( ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1), &ret, ret==0 );
+    TEST_OPERATION_RESULT( s_reduce_calls > 1, &ret, ret==1 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+    TEST_OPERATION_RESULT( stat(SPILL_PATH, &st), &ret, ret==0 && st.st_size>0 );
+    spill_size = st.st_size;
+
+    /*spill file of previous reduce is truncated, less data is spilled*/
+    CreateSpillRuns(&mif, runs, RUNS_COUNT/2);
+    TEST_OPERATION_RESULT( ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT/2, 1), &ret, ret==0 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+    TEST_OPERATION_RESULT( stat(SPILL_PATH, &st), &ret, ret==0 && st.st_size<spill_size );
+
+    /*without Combine equal hashes are repeated, but still not divided
+      between batches*/
+    mif.Combine = NULL;
+    CreateSpillRuns(&mif, runs, RUNS_COUNT);
+    TEST_OPERATION_RESULT( ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1), &ret, ret==0 );
+    TEST_OPERATION_RESULT( s_reduce_calls > 1, &ret, ret==1 );
+    TEST_OPERATION_RESULT( CheckReduced(), &ret, ret==1 );
+
+    /*spilled runs can't be read back, reduce fails without reducing
+      broken data*/
+    mif.Combine = Combine;
+    setenv(REDUCE_SPILL_PATH_ENV, BROKEN_SPILL_PATH, 1);
+    CreateSpillRuns(&mif, runs, RUNS_COUNT);
+    TEST_OPERATION_RESULT( ReduceRunsLocalProcessing(&mif, runs, RUNS_COUNT, 1), &ret, ret==-1 );
+    TEST_OPERATION_RESULT( s_reduce_calls, &ret, ret==0 );
+    return 0;
+}
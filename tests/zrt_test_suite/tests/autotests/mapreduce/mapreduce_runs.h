@@ -0,0 +1,161 @@
+/*
+ * Sorted runs for mapreduce reducer tests: items of KEYS_COUNT keys
+ * having unique hashes, Combine summing values of equal hashes, and
+ * sums of values expected to be reduced. Including test defines own
+ * Reduce adding items into reduced sums by AddReduced.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MAPREDUCE_RUNS_H__
+#define __MAPREDUCE_RUNS_H__
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <alloca.h>
+
+#include "map_reduce_lib.h"
+#include "elastic_mr_item.h"
+#include "mr_defines.h"
+#include "buffer.h"
+
+#define HASH_TYPE uint32_t
+#define ITEM_SIZE sizeof(				\
+			 struct{			\
+			     BinaryData     key_data;	\
+			     BinaryData     value;	\
+			     uint8_t        own_key;	\
+			     uint8_t        own_value;  \
+			     HASH_TYPE      key_hash;	\
+			 })
+#define RUNS_COUNT 8
+#define ITEMS_PER_RUN 2000
+#define KEYS_COUNT 500
+
+static char s_keys[KEYS_COUNT][8];
+static uintptr_t s_expected[KEYS_COUNT];
+static uintptr_t s_reduced[KEYS_COUNT];
+static int s_combine_calls;
+
+static inline HASH_TYPE
+KeyHash(int key){
+    return (HASH_TYPE)key * 2654435761U;
+}
+
+static inline int
+ComparatorHash(const void *h1, const void *h2){
+    HASH_TYPE hash1, hash2;
+    memcpy(&hash1, h1, sizeof(HASH_TYPE));
+    memcpy(&hash2, h2, sizeof(HASH_TYPE));
+    if      ( hash1 < hash2 ) return -1;
+    else if ( hash1 > hash2 ) return 1;
+    else return 0;
+}
+
+/*every key has unique hash*/
+static inline int
+ComparatorMrItem(const void *p1, const void *p2){
+    return ComparatorHash( &((const ElasticBufItemData*)p1)->key_hash,
+			   &((const ElasticBufItemData*)p2)->key_hash );
+}
+
+/*sum values of items having equal hashes, data of items read from
+  spill is freed by reducer*/
+static inline int
+Combine( const Buffer *map_buffer, Buffer *reduce_buffer ){
+    ElasticBufItemData* combine = alloca(map_buffer->header.item_size);
+    const ElasticBufItemData* current;
+    int i;
+    ++s_combine_calls;
+    for ( i=0; i < map_buffer->header.count; i++ ){
+	current = (const ElasticBufItemData*)BufferItemPointer(map_buffer, i);
+	if ( i > 0 && !ComparatorMrItem(combine, current) ){
+	    combine->value.addr += current->value.addr;
+	}
+	else{
+	    if ( i > 0 ) AddBufferItem(reduce_buffer, combine);
+	    GetBufferItem(map_buffer, i, combine);
+	}
+    }
+    if ( map_buffer->header.count > 0 )
+	AddBufferItem(reduce_buffer, combine);
+    return 0;
+}
+
+/*add value of reduced item to sum of its key*/
+static inline void
+AddReduced( const ElasticBufItemData* item ){
+    s_reduced[atoi((const char*)item->key_data.addr+1)] += item->value.addr;
+}
+
+/*prepare keys and mif for runs, value addr is data*/
+static inline void
+PrepareRunsMapReduce( struct MapReduceUserIf *mif,
+		      int (*reduce)(const Buffer *reduce_buffer) ){
+    int i;
+    for ( i=0; i < KEYS_COUNT; i++ )
+	snprintf(s_keys[i], sizeof(s_keys[i]), "k%d", i);
+    memset(mif, '\0', sizeof(*mif));
+    PREPARE_MAPREDUCE( mif, NULL, Combine, reduce,
+		       ComparatorMrItem, ComparatorHash, NULL,
+		       1,    /*value addr is data*/
+		       ITEM_SIZE,
+		       sizeof(HASH_TYPE) );
+}
+
+/*create the same sorted runs for every call
+ *@param in_arena if non zero then keys are copied into arena of run*/
+static inline void
+CreateRuns( struct MapReduceUserIf *mif, Buffer *runs, int count, int in_arena ){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    HASH_TYPE hash;
+    int i, j, key, res;
+    memset(s_expected, '\0', sizeof(s_expected));
+    memset(s_reduced, '\0', sizeof(s_reduced));
+    memset(item, '\0', ITEM_SIZE);
+    srand(RUNS_COUNT);
+    for ( i=0; i < count; i++ ){
+	res = AllocBuffer(&runs[i], ITEM_SIZE, ITEMS_PER_RUN);
+	assert(res==0);
+	for ( j=0; j < ITEMS_PER_RUN; j++ ){
+	    key = rand() % KEYS_COUNT;
+	    hash = KeyHash(key);
+	    item->key_data.size = strlen(s_keys[key])+1;
+	    if ( in_arena )
+		item->key_data.addr = (uintptr_t)
+		    BufferArenaCopy(&runs[i], s_keys[key], item->key_data.size);
+	    else
+		item->key_data.addr = (uintptr_t)s_keys[key];
+	    item->own_key = EDataNotOwned;
+	    item->value.addr = j % 3 + 1;
+	    memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	    AddBufferItem(&runs[i], item);
+	    s_expected[key] += item->value.addr;
+	}
+	LocalSort(mif, &runs[i]);
+    }
+    s_combine_calls = 0;
+}
+
+/*@return 1 if reduced values are equal to expected ones*/
+static inline int
+CheckReduced(){
+    return memcmp(s_reduced, s_expected, sizeof(s_expected)) == 0;
+}
+
+#endif //__MAPREDUCE_RUNS_H__
@@ -0,0 +1,230 @@
+/*
+ * mapreduce sampling partitioner test: dividers created from weighted
+ * samples, hot key split between reducers if Combine is associative,
+ * hot key following light keys gets own divider
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+#include <alloca.h>
+
+#include "macro_tests.h"
+#include "map_reduce_lib.h"
+#include "elastic_mr_item.h"
+#include "mr_defines.h"
+#include "buffer.h"
+
+#define HASH_TYPE uint16_t
+#define ITEM_SIZE sizeof(				\
+			 struct{			\
+			     BinaryData     key_data;	\
+			     BinaryData     value;	\
+			     uint8_t        own_key;	\
+			     uint8_t        own_value;  \
+			     HASH_TYPE      key_hash;	\
+			 })
+#define MAP_NODES_COUNT 2
+#define REDUCE_NODES_COUNT 4
+#define KEYS_COUNT 1000
+#define HOT_KEY_HASH 500
+#define HOT_KEY_COUNT 3000
+#define ITEMS_COUNT (KEYS_COUNT+HOT_KEY_COUNT)
+
+static char*
+PrintableHash( char* str, const uint8_t* hash, int size){
+    HASH_TYPE h;
+    memcpy(&h, hash, sizeof(h));
+    sprintf(str, "%X", h);
+    return str;
+}
+
+static int
+ComparatorHash(const void *h1, const void *h2){
+    HASH_TYPE hash1, hash2;
+    memcpy(&hash1, h1, sizeof(HASH_TYPE));
+    memcpy(&hash2, h2, sizeof(HASH_TYPE));
+    if      ( hash1 < hash2 ) return -1;
+    else if ( hash1 > hash2 ) return 1;
+    else return 0;
+}
+
+static int
+ComparatorMrItem(const void *p1, const void *p2){
+    return ComparatorHash( &((ElasticBufItemData*)p1)->key_hash,
+			   &((ElasticBufItemData*)p2)->key_hash );
+}
+
+/*every key once and hot key many times*/
+static void FillMap(struct MapReduceUserIf *mif, Buffer *map){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    HASH_TYPE hash;
+    int i, res;
+    res = AllocBuffer(map, ITEM_SIZE, ITEMS_COUNT);
+    assert(res==0);
+    memset(item, '\0', ITEM_SIZE);
+    for ( i=0; i < ITEMS_COUNT; i++ ){
+	hash = i < KEYS_COUNT ? i : HOT_KEY_HASH;
+	memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	item->value.addr = 1;
+	AddBufferItem(map, item);
+    }
+    LocalSort(mif, map);
+}
+
+/*@return count of items in the biggest basket*/
+static int TestPartitioning(struct MapReduceUserIf *mif, int combine_associative){
+    Histogram samples[MAP_NODES_COUNT];
+    Buffer map;
+    HASH_TYPE hash, maxhash=~0;
+    int i, ret, hot_dividers=0, hot_baskets=0, max_count=0, next_index=0;
+
+    SET_MAPREDUCE_PARTITIONER(mif, EPartitionerSampling, combine_associative);
+    FillMap(mif, &map);
+    memset(samples, '\0', sizeof(samples));
+    for ( i=0; i < MAP_NODES_COUNT; i++ ){
+	TEST_OPERATION_RESULT( GetWeightedSample(mif, &map,
+						 REDUCE_NODES_COUNT*PARTITION_SAMPLES_PER_REDUCER,
+						 &samples[i]),
+			       &ret, ret==REDUCE_NODES_COUNT*PARTITION_SAMPLES_PER_REDUCER );
+    }
+
+    ret = AllocBuffer(&mif->data.dividers_list, sizeof(HASH_TYPE), REDUCE_NODES_COUNT);
+    assert(ret==0);
+    GetReducersDividerArrayBasedOnSamples(mif, samples, MAP_NODES_COUNT,
+					  &mif->data.dividers_list);
+    TEST_OPERATION_RESULT( mif->data.dividers_list.header.count,
+			   &ret, ret==REDUCE_NODES_COUNT );
+    GetBufferItem(&mif->data.dividers_list, REDUCE_NODES_COUNT-1, &hash);
+    TEST_OPERATION_RESULT( hash==maxhash, &ret, ret==1 );
+    for ( i=0; i < REDUCE_NODES_COUNT; i++ ){
+	GetBufferItem(&mif->data.dividers_list, i, &hash);
+	if ( hash == HOT_KEY_HASH ) ++hot_dividers;
+    }
+    /*hot key divider is repeated only if it's allowed*/
+    TEST_OPERATION_RESULT( hot_dividers, &ret, combine_associative ? ret>1 : ret<=1 );
+
+    /*baskets are contiguous ranges of map, hot key is sent to several
+      reducers only if it's allowed*/
+    struct BasketInfo* baskets = DistributeDataIntoBaskets(mif, &map, REDUCE_NODES_COUNT);
+    for ( i=0; i < REDUCE_NODES_COUNT; i++ ){
+	TEST_OPERATION_RESULT( baskets[i].count_in_section==0 ||
+			       baskets[i].data_start_index==next_index, &ret, ret==1 );
+	next_index += baskets[i].count_in_section;
+	if ( baskets[i].count_in_section > max_count )
+	    max_count = baskets[i].count_in_section;
+	if ( baskets[i].count_in_section > 0 ){
+	    /*hot key items are located at the end of basket*/
+	    const ElasticBufItemData* last = (const ElasticBufItemData*)
+		BufferItemPointer(&map, next_index-1);
+	    memcpy(&hash, &last->key_hash, sizeof(HASH_TYPE));
+	    if ( hash == HOT_KEY_HASH ) ++hot_baskets;
+	}
+    }
+    TEST_OPERATION_RESULT( next_index, &ret, ret==ITEMS_COUNT );
+    TEST_OPERATION_RESULT( hot_baskets, &ret, combine_associative ? ret>1 : ret==1 );
+
+    free(baskets);
+    FreeBufferData(&mif->data.dividers_list);
+    for ( i=0; i < MAP_NODES_COUNT; i++ )
+	FreeBufferData(&samples[i].buffer);
+    FreeBufferData(&map);
+    return max_count;
+}
+
+/*light keys of single item, and hot key of LATE_HOT_KEY_COUNT items
+  after them; weight of item is ITEM_SIZE, so that hot key weights
+  exactly first reducer share, and share recalculated after first
+  divider is a bit bigger than weight of hot key*/
+#define LATE_HOT_KEY_COUNT 10
+#define LATE_HOT_KEY_HASH (LATE_HOT_KEY_COUNT+1)
+#define LATE_ITEMS_COUNT (4*LATE_HOT_KEY_COUNT)
+static void FillMapLateHotKey(struct MapReduceUserIf *mif, Buffer *map){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    HASH_TYPE hash;
+    int i, res;
+    res = AllocBuffer(map, ITEM_SIZE, LATE_ITEMS_COUNT);
+    assert(res==0);
+    memset(item, '\0', ITEM_SIZE);
+    for ( i=0; i < LATE_ITEMS_COUNT; i++ ){
+	if ( i >= LATE_HOT_KEY_HASH && i < LATE_HOT_KEY_HASH+LATE_HOT_KEY_COUNT )
+	    hash = LATE_HOT_KEY_HASH;
+	else
+	    hash = i;
+	/*rest of total weight after 4 shares is 3*/
+	item->key_data.size = i == LATE_ITEMS_COUNT-1 ? 3 : 0;
+	memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	AddBufferItem(map, item);
+    }
+    LocalSort(mif, map);
+}
+
+/*@return index of divider equal to hot key hash or -1*/
+static int TestLateHotKey(struct MapReduceUserIf *mif){
+    Histogram sample;
+    Buffer map;
+    HASH_TYPE hash;
+    int i, ret, hot_index=-1;
+
+    SET_MAPREDUCE_PARTITIONER(mif, EPartitionerSampling, 1);
+    FillMapLateHotKey(mif, &map);
+    memset(&sample, '\0', sizeof(sample));
+    /*sample is bigger than map, so it has all items*/
+    TEST_OPERATION_RESULT( GetWeightedSample(mif, &map,
+					     REDUCE_NODES_COUNT*PARTITION_SAMPLES_PER_REDUCER,
+					     &sample),
+			   &ret, ret==LATE_ITEMS_COUNT );
+    ret = AllocBuffer(&mif->data.dividers_list, sizeof(HASH_TYPE), REDUCE_NODES_COUNT);
+    assert(ret==0);
+    GetReducersDividerArrayBasedOnSamples(mif, &sample, 1, &mif->data.dividers_list);
+    TEST_OPERATION_RESULT( mif->data.dividers_list.header.count,
+			   &ret, ret==REDUCE_NODES_COUNT );
+    for ( i=0; i < REDUCE_NODES_COUNT; i++ ){
+	GetBufferItem(&mif->data.dividers_list, i, &hash);
+	if ( hash == LATE_HOT_KEY_HASH ) hot_index = i;
+    }
+    FreeBufferData(&mif->data.dividers_list);
+    FreeBufferData(&sample.buffer);
+    FreeBufferData(&map);
+    return hot_index;
+}
+
+int main(int argc, char **argv)
+{
+    struct MapReduceUserIf mif;
+    int ret;
+
+    memset(&mif, '\0', sizeof(mif));
+    PREPARE_MAPREDUCE( &mif, NULL, NULL, NULL,
+		       ComparatorMrItem, ComparatorHash, PrintableHash,
+		       1,    /*value addr is data*/
+		       ITEM_SIZE,
+		       sizeof(HASH_TYPE) );
+
+    /*hot key goes to single reducer*/
+    TEST_OPERATION_RESULT( TestPartitioning(&mif, 0), &ret, ret>=HOT_KEY_COUNT );
+    /*hot key is split, no reducer gets half of data*/
+    TEST_OPERATION_RESULT( TestPartitioning(&mif, 1), &ret, ret<ITEMS_COUNT/2 );
+    /*first reducer gets light keys, second one gets single light key
+      and hot key*/
+    TEST_OPERATION_RESULT( TestLateHotKey(&mif), &ret, ret==1 );
+    return 0;
+}
@@ -43,6 +43,7 @@
 
 void sbrk_mmap_test();
 void mmap_test_file_mapping(off_t offset);
+void mmap_test_file_window(off_t offset, size_t length);
 void mmap_test_unmap(void* unmap_addr, size_t length);
 void* mmap_test_align(size_t length, int result_expected);
 
@@ -69,6 +70,10 @@ int main(int argc, char**argv){
     /*test2: test mmap with not 0 offset*/
     mmap_test_file_mapping(10);
 
+    /*test: only mapped range of file is in mapping*/
+    mmap_test_file_window(2, 5);
+    mmap_test_file_window(DATASIZE_FOR_MMAP+1, 5);
+
     /*test3: test mmap address must be aligned to page size.
       PROT_READ|PROT_WRITE, MAP_ANONYMOUS*/
     void* addr;
@@ -111,16 +116,37 @@ void mmap_test_file_mapping(off_t offset){
     MMAP_READONLY_SHARED_FILE(MMAP_FILE, offset, &fd, data)
 
     fprintf(stderr, "expected data:%s\n", DATA_FOR_MMAP+offset);
-    fprintf(stderr, "mmaped data  :%s\n", ((char*)data+offset));
+    fprintf(stderr, "mmaped data  :%s\n", (char*)data);
 
+    /*mapping starts from file data located at offset, the rest of
+      mapping after end of file is zeroed*/
+    int ret;
     off_t filesize;
     GET_FILE_SIZE(MMAP_FILE, &filesize);
-    CMP_MEM_DATA( DATA_FOR_MMAP+offset, data+offset, filesize-offset );
+    CMP_MEM_DATA( DATA_FOR_MMAP+offset, data, filesize-offset );
+    if ( offset > 0 )
+	TEST_OPERATION_RESULT( data[filesize-1], &ret, ret==0 );
 
     MUNMAP_FILE(data, filesize);
     CLOSE_FILE(fd);
 }
 
+void mmap_test_file_window(off_t offset, size_t length){
+    int fd;
+    int ret;
+    char* data;
+    TEST_OPERATION_RESULT( open(MMAP_FILE, O_RDONLY), &fd, fd!=-1);
+    data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, offset);
+    TEST_OPERATION_RESULT( data!=MAP_FAILED, &ret, ret!=0 );
+    if ( offset < DATASIZE_FOR_MMAP ){
+	CMP_MEM_DATA( DATA_FOR_MMAP+offset, data, length );
+    }
+    /*bytes after requested length are not file data*/
+    TEST_OPERATION_RESULT( data[length], &ret, ret==0 );
+    MUNMAP_FILE(data, length);
+    CLOSE_FILE(fd);
+}
+
 void* mmap_test_align(size_t length, int result_expected){
     int32_t addr;
     int ret;
@@ -0,0 +1,102 @@
+/*
+ * mmap fragmentation test: partial unmapping of mapping, fragmentation
+ * report got by zmemstat, best-fit mmap policy set by nvram, brk/mmap
+ * gap restored after unmapping of the lowest mapping
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "zrtapi.h"
+
+#define MAPPING_PAGES 8
+#define FIXED_PAGES 4
+
+static void* map_pages(size_t count){
+    return mmap(NULL, count*sysconf(_SC_PAGESIZE), PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+}
+
+int main(int argc, char **argv)
+{
+    struct zmemstat mapped, holes, refilled, again;
+    int pagesize = sysconf(_SC_PAGESIZE);
+    int ret;
+    char *addr, *hole;
+
+    /*output is done before getting stats, so stdio buffers
+      allocations are not changing them*/
+    TEST_OPERATION_RESULT( zmemstat(NULL), &ret, ret==-1&&errno==EFAULT );
+    TEST_OPERATION_RESULT( zmemstat(&mapped), &ret, ret==0 );
+    TEST_OPERATION_RESULT( mapped.page_size, &ret, ret==pagesize );
+    TEST_OPERATION_RESULT( mapped.largest_free_run<=mapped.free_pages &&
+			   mapped.free_runs>0, &ret, ret==1 );
+
+    /*unmap parts of mapping: pages [4,7) and page 1*/
+    addr = map_pages(MAPPING_PAGES);
+    zmemstat(&mapped);
+    munmap(addr+4*pagesize, 3*pagesize);
+    munmap(addr+pagesize, pagesize);
+    zmemstat(&holes);
+    /*unmapping of not mapped pages changes nothing*/
+    munmap(addr+4*pagesize+1, 3*pagesize-1);
+    zmemstat(&again);
+    TEST_OPERATION_RESULT( addr!=MAP_FAILED, &ret, ret==1 );
+    TEST_OPERATION_RESULT( holes.free_pages-mapped.free_pages, &ret, ret==4 );
+    TEST_OPERATION_RESULT( holes.free_runs-mapped.free_runs, &ret, ret==2 );
+    TEST_OPERATION_RESULT( again.free_pages==holes.free_pages, &ret, ret==1 );
+
+    /*best-fit policy is set by nvram, single page fills entirely
+      the smallest free range*/
+    hole = map_pages(1);
+    zmemstat(&refilled);
+    TEST_OPERATION_RESULT( hole!=MAP_FAILED, &ret, ret==1 );
+    TEST_OPERATION_RESULT( holes.free_runs-refilled.free_runs, &ret, ret==1 );
+    munmap(hole, pagesize);
+    munmap(addr, MAPPING_PAGES*pagesize);
+
+    /*the largest free range is the largest mmap can succeed*/
+    zmemstat(&mapped);
+    hole = map_pages(mapped.largest_free_run+1);
+    TEST_OPERATION_RESULT( hole==MAP_FAILED, &ret, ret==1 );
+    hole = map_pages(mapped.largest_free_run);
+    TEST_OPERATION_RESULT( hole!=MAP_FAILED, &ret, ret==1 );
+    munmap(hole, mapped.largest_free_run*pagesize);
+
+    /*map pages just below the lowest mapping, brk/mmap gap is
+      restored after unmapping them*/
+    zmemstat(&mapped);
+    TEST_OPERATION_RESULT( mapped.brk_mmap_gap>(FIXED_PAGES+1)*pagesize, &ret, ret==1 );
+    addr = (char*)sbrk(0) + mapped.brk_mmap_gap - FIXED_PAGES*pagesize;
+    hole = mmap(addr, FIXED_PAGES*pagesize, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+    zmemstat(&holes);
+    munmap(hole, FIXED_PAGES*pagesize);
+    zmemstat(&again);
+    TEST_OPERATION_RESULT( hole==addr, &ret, ret==1 );
+    TEST_OPERATION_RESULT( (mapped.brk_mmap_gap-holes.brk_mmap_gap)/pagesize,
+			   &ret, ret==FIXED_PAGES );
+    TEST_OPERATION_RESULT( again.brk_mmap_gap==mapped.brk_mmap_gap, &ret, ret==1 );
+    return 0;
+}
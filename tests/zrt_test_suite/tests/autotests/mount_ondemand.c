@@ -0,0 +1,64 @@
+/*
+ * on demand mount of tar image testing: file data is read from
+ * channel and copied into memory on write. Image contains file
+ * test.1234 with contents "mount\n"
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+
+#define FILENAME "/ondemand/test.1234"
+#define CONTENTS "mount\n"
+
+int main(int argc, char **argv)
+{
+    int fd, ret, i;
+    char buf[20];
+    struct stat st;
+
+    /*file data is read from channel without user file descriptor,
+      closing of all user files can't break it*/
+    for ( i=3; i < 64; i++ )
+	close(i);
+
+    TEST_OPERATION_RESULT( stat(FILENAME, &st), &ret, ret==0 && st.st_size==strlen(CONTENTS) );
+    TEST_OPERATION_RESULT( open(FILENAME, O_RDWR), &fd, fd!=-1 );
+    TEST_OPERATION_RESULT( read(fd, buf, sizeof(buf)), &ret, ret==strlen(CONTENTS) );
+    TEST_OPERATION_RESULT( memcmp(buf, CONTENTS, strlen(CONTENTS)), &ret, ret==0 );
+
+    /*write copies data into memory, rest of data is kept*/
+    TEST_OPERATION_RESULT( pwrite(fd, "M", 1, 0), &ret, ret==1 );
+    TEST_OPERATION_RESULT( pread(fd, buf, sizeof(buf), 0), &ret, ret==strlen(CONTENTS) );
+    TEST_OPERATION_RESULT( memcmp(buf, "Mount\n", strlen(CONTENTS)), &ret, ret==0 );
+
+    /*truncate and grow*/
+    TEST_OPERATION_RESULT( ftruncate(fd, 2), &ret, ret==0 );
+    TEST_OPERATION_RESULT( ftruncate(fd, 4), &ret, ret==0 );
+    TEST_OPERATION_RESULT( pread(fd, buf, sizeof(buf), 0), &ret, ret==4 );
+    TEST_OPERATION_RESULT( memcmp(buf, "Mo\0\0", 4), &ret, ret==0 );
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * mremap test: zmremap shrinks mapping and grows it in place keeping
+ * address while pages following mapping are not mapped, otherwise
+ * moves it with contents if MREMAP_MAYMOVE is set, or fails with
+ * ENOMEM; wrong arguments are failing with EINVAL
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "zrtapi.h"
+
+#define RESERVED_PAGES 12
+#define SHRINKED_PAGES 4
+#define GROWN_PAGES 8
+
+/*every page N of mapping is filled by N+1*/
+static void fill_pages(char* addr, int count, int pagesize){
+    int i;
+    for ( i=0; i < count; i++ )
+	memset(addr+i*pagesize, i+1, pagesize);
+}
+
+/*@return 1 if pages are filled by fill_pages*/
+static int check_pages(const char* addr, int count, int pagesize){
+    int i, j;
+    for ( i=0; i < count; i++ )
+	for ( j=0; j < pagesize; j++ )
+	    if ( addr[i*pagesize+j] != (char)(i+1) ) return 0;
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    struct zmemstat mapped, shrinked;
+    int pagesize = sysconf(_SC_PAGESIZE);
+    int ret;
+    char *addr, *blocker, *moved;
+
+    /*map pages to be sure that pages following shrinked mapping
+      are not mapped*/
+    addr = mmap(NULL, RESERVED_PAGES*pagesize, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    TEST_OPERATION_RESULT( addr!=MAP_FAILED, &ret, ret==1 );
+    fill_pages(addr, RESERVED_PAGES, pagesize);
+
+    /*shrink keeps address and unmaps tail of mapping*/
+    zmemstat(&mapped);
+    TEST_OPERATION_RESULT( zmremap(addr, RESERVED_PAGES*pagesize, SHRINKED_PAGES*pagesize, 0)==addr,
+			   &ret, ret==1 );
+    zmemstat(&shrinked);
+    TEST_OPERATION_RESULT( shrinked.free_pages-mapped.free_pages,
+			   &ret, ret==RESERVED_PAGES-SHRINKED_PAGES );
+    TEST_OPERATION_RESULT( check_pages(addr, SHRINKED_PAGES, pagesize), &ret, ret==1 );
+
+    /*grow in place keeps address and contents while following pages
+      are not mapped, even without MREMAP_MAYMOVE*/
+    TEST_OPERATION_RESULT( zmremap(addr, SHRINKED_PAGES*pagesize, GROWN_PAGES*pagesize, 0)==addr,
+			   &ret, ret==1 );
+    TEST_OPERATION_RESULT( check_pages(addr, SHRINKED_PAGES, pagesize), &ret, ret==1 );
+    fill_pages(addr, GROWN_PAGES, pagesize);
+
+    /*map pages just following mapping, so it can't be grown in place*/
+    blocker = mmap(addr+GROWN_PAGES*pagesize, pagesize, PROT_READ|PROT_WRITE,
+		   MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+    TEST_OPERATION_RESULT( blocker==addr+GROWN_PAGES*pagesize, &ret, ret==1 );
+    TEST_OPERATION_RESULT( zmremap(addr, GROWN_PAGES*pagesize, RESERVED_PAGES*pagesize, 0)==MAP_FAILED,
+			   &ret, ret==1&&errno==ENOMEM );
+    TEST_OPERATION_RESULT( check_pages(addr, GROWN_PAGES, pagesize), &ret, ret==1 );
+
+    /*grow with MREMAP_MAYMOVE moves mapping with contents*/
+    moved = zmremap(addr, GROWN_PAGES*pagesize, RESERVED_PAGES*pagesize, MREMAP_MAYMOVE);
+    TEST_OPERATION_RESULT( moved!=MAP_FAILED && moved!=addr, &ret, ret==1 );
+    TEST_OPERATION_RESULT( check_pages(moved, GROWN_PAGES, pagesize), &ret, ret==1 );
+    fill_pages(moved, RESERVED_PAGES, pagesize);
+
+    /*unaligned address, zero sizes and unknown flags are wrong*/
+    TEST_OPERATION_RESULT( zmremap(moved+1, pagesize, 2*pagesize, MREMAP_MAYMOVE)==MAP_FAILED,
+			   &ret, ret==1&&errno==EINVAL );
+    TEST_OPERATION_RESULT( zmremap(moved, RESERVED_PAGES*pagesize, 0, 0)==MAP_FAILED,
+			   &ret, ret==1&&errno==EINVAL );
+    TEST_OPERATION_RESULT( zmremap(moved, 0, pagesize, 0)==MAP_FAILED,
+			   &ret, ret==1&&errno==EINVAL );
+    TEST_OPERATION_RESULT( zmremap(moved, pagesize, pagesize, ~MREMAP_MAYMOVE)==MAP_FAILED,
+			   &ret, ret==1&&errno==EINVAL );
+    /*failed calls left mapping untouched*/
+    TEST_OPERATION_RESULT( check_pages(moved, RESERVED_PAGES, pagesize), &ret, ret==1 );
+
+    munmap(blocker, pagesize);
+    munmap(moved, RESERVED_PAGES*pagesize);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * sparse files of in-memory filesystem testing: ftruncate growth,
+ * reading holes, SEEK_DATA/SEEK_HOLE
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "zrtapi.h" /*SEEK_DATA, SEEK_HOLE*/
+#include "macro_tests.h"
+
+#define FILENAME "/sparsefile"
+#define FILE_SIZE (1024*1024*1024)
+/*offset aligned by chunk size of in-memory filesystem*/
+#define DATA_OFFSET (512*1024)
+#define CHUNK_SIZE 0x10000
+
+int main(int argc, char **argv)
+{
+    int fd, ret;
+    char buf[100];
+    char zeros[100];
+    struct stat st;
+    memset(zeros, '\0', sizeof(zeros));
+
+    TEST_OPERATION_RESULT( open(FILENAME, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR), &fd, fd!=-1 );
+    /*grow up to 1GB without allocating memory for data*/
+    TEST_OPERATION_RESULT( ftruncate(fd, FILE_SIZE), &ret, ret==0 );
+    TEST_OPERATION_RESULT( fstat(fd, &st), &ret, ret==0 && st.st_size==FILE_SIZE );
+    TEST_OPERATION_RESULT( lseek(fd, 0, SEEK_CUR), &ret, ret==0 );
+
+    /*whole file is a hole*/
+    TEST_OPERATION_RESULT( lseek(fd, 0, SEEK_HOLE), &ret, ret==0 );
+    TEST_OPERATION_RESULT( lseek(fd, 0, SEEK_DATA), &ret, ret==-1&&errno==ENXIO );
+    TEST_OPERATION_RESULT( pread(fd, buf, sizeof(buf), FILE_SIZE/2), &ret, ret==sizeof(buf) );
+    TEST_OPERATION_RESULT( memcmp(buf, zeros, sizeof(buf)), &ret, ret==0 );
+
+    /*data in the middle of file*/
+    TEST_OPERATION_RESULT( pwrite(fd, "data", 4, DATA_OFFSET), &ret, ret==4 );
+    TEST_OPERATION_RESULT( lseek(fd, 0, SEEK_DATA), &ret, ret==DATA_OFFSET );
+    TEST_OPERATION_RESULT( lseek(fd, 0, SEEK_HOLE), &ret, ret==0 );
+    TEST_OPERATION_RESULT( lseek(fd, DATA_OFFSET, SEEK_HOLE), &ret, ret==DATA_OFFSET+CHUNK_SIZE );
+    TEST_OPERATION_RESULT( lseek(fd, DATA_OFFSET+CHUNK_SIZE, SEEK_DATA), &ret, ret==-1&&errno==ENXIO );
+    TEST_OPERATION_RESULT( pread(fd, buf, 8, DATA_OFFSET-4), &ret, ret==8 );
+    TEST_OPERATION_RESULT( memcmp(buf, "\0\0\0\0data", 8), &ret, ret==0 );
+
+    /*seek beyond of file end*/
+    TEST_OPERATION_RESULT( lseek(fd, FILE_SIZE, SEEK_HOLE), &ret, ret==-1&&errno==ENXIO );
+    TEST_OPERATION_RESULT( lseek(fd, FILE_SIZE, SEEK_DATA), &ret, ret==-1&&errno==ENXIO );
+
+    /*reduce, grow again and check that data is zeroed*/
+    TEST_OPERATION_RESULT( ftruncate(fd, DATA_OFFSET+2), &ret, ret==0 );
+    TEST_OPERATION_RESULT( ftruncate(fd, FILE_SIZE), &ret, ret==0 );
+    TEST_OPERATION_RESULT( pread(fd, buf, 4, DATA_OFFSET), &ret, ret==4 );
+    TEST_OPERATION_RESULT( memcmp(buf, "da\0\0", 4), &ret, ret==0 );
+
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    REMOVE_EXISTING_FILEPATH(FILENAME);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * zmalloc test: alignment and usable size of objects of all size
+ * classes, realloc keeping data between small and large objects,
+ * memalign, calloc zeroing reused pages, reuse of freed slabs and
+ * unmapping of freed large objects
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "zrtapi.h"
+#include "zmalloc.h"
+
+#define MAX_TESTED_SIZE (4*ZMALLOC_MAX_SMALL_SIZE)
+/*every small size class is tested, large objects are tested rarely*/
+#define SMALL_SIZE_STEP 7
+#define LARGE_SIZE_STEP (ZMALLOC_MAX_SMALL_SIZE/16)
+#define NEXT_TESTED_SIZE(size) \
+    ((size) + ((size) < ZMALLOC_MAX_SMALL_SIZE ? SMALL_SIZE_STEP : LARGE_SIZE_STEP))
+#define OBJECTS_COUNT 1000
+#define LARGE_SIZE (1024*1024)
+
+/*@return count of objects of sizes up to MAX_TESTED_SIZE which are not
+ *aligned, have not enough usable size, or are corrupted by neighbours*/
+static int check_sizes(){
+    static char* s_objects[ZMALLOC_MAX_SMALL_SIZE/SMALL_SIZE_STEP +
+			    MAX_TESTED_SIZE/LARGE_SIZE_STEP + 1];
+    size_t size, i;
+    int wrong = 0;
+    for ( size=0, i=0; size <= MAX_TESTED_SIZE; size=NEXT_TESTED_SIZE(size), i++ ){
+	s_objects[i] = zmalloc(size);
+	if ( s_objects[i] == NULL || (uintptr_t)s_objects[i] % ZMALLOC_ALIGN != 0 ||
+	     zmalloc_usable_size(s_objects[i]) < size )
+	    ++wrong;
+	else
+	    memset(s_objects[i], (char)i, size);
+    }
+    for ( size=0, i=0; size <= MAX_TESTED_SIZE; size=NEXT_TESTED_SIZE(size), i++ ){
+	if ( size > 0 && s_objects[i] != NULL &&
+	     (s_objects[i][0] != (char)i || s_objects[i][size-1] != (char)i) )
+	    ++wrong;
+	zfree(s_objects[i]);
+    }
+    return wrong;
+}
+
+/*grow object from small to large and shrink it back by realloc, every
+ *growth fills new half of object by its size exponent
+ *@return count of bytes not kept*/
+static int check_realloc(){
+    size_t size, i;
+    int wrong = 0;
+    char* ptr = zmalloc(16);
+    memset(ptr, 4, 16);
+    for ( size=32; size <= LARGE_SIZE; size*=2 ){
+	ptr = zrealloc(ptr, size);
+	if ( ptr == NULL ) return -1;
+	memset(ptr+size/2, __builtin_ctz(size), size/2);
+    }
+    for ( i=0; i < 16; i++ ) if ( ptr[i] != 4 ) ++wrong;
+    for ( size=LARGE_SIZE/2; size >= 16; size/=2 ){
+	ptr = zrealloc(ptr, size);
+	if ( ptr == NULL ) return -1;
+	if ( ptr[size-1] != __builtin_ctz(size) ) ++wrong;
+    }
+    zfree(ptr);
+    return wrong;
+}
+
+int main(int argc, char **argv)
+{
+    int ret, i;
+    char* ptr;
+    char* objects[OBJECTS_COUNT];
+
+    TEST_OPERATION_RESULT( check_sizes(), &ret, ret==0 );
+    TEST_OPERATION_RESULT( check_realloc(), &ret, ret==0 );
+    zfree(NULL);
+    TEST_OPERATION_RESULT( zrealloc(NULL, 100)!=NULL, &ret, ret==1 );
+
+    /*aligned objects and interior pointers are freed*/
+    TEST_OPERATION_RESULT( zmemalign(3, 100)==NULL&&errno==EINVAL, &ret, ret==1 );
+    for ( i=5; i <= 20; i++ ){
+	size_t alignment = (size_t)1<<i;
+	ptr = zmemalign(alignment, 100);
+	int aligned = ptr != NULL && ((uintptr_t)ptr & (alignment-1)) == 0;
+	TEST_OPERATION_RESULT( aligned, &ret, ret==1 );
+	memset(ptr, 'a', 100);
+	zfree(ptr);
+    }
+
+    /*freed pages are reused by calloc*/
+    ptr = zmalloc(LARGE_SIZE);
+    memset(ptr, 'a', LARGE_SIZE);
+    zfree(ptr);
+    ptr = zcalloc(LARGE_SIZE/8, 8);
+    for ( i=0, ret=0; i < LARGE_SIZE; i++ ) if ( ptr[i] ) ++ret;
+    TEST_OPERATION_RESULT( ret, &ret, ret==0 );
+    zfree(ptr);
+    TEST_OPERATION_RESULT( zcalloc((size_t)-1, 2)==NULL&&errno==ENOMEM, &ret, ret==1 );
+
+    /*pages of freed slabs are reused without growing brk*/
+    for ( i=0; i < OBJECTS_COUNT; i++ ) objects[i] = zmalloc(2000);
+    char* brk = sbrk(0);
+    for ( i=0; i < OBJECTS_COUNT; i++ ) zfree(objects[i]);
+    for ( i=0; i < OBJECTS_COUNT; i++ ) objects[i] = zmalloc(2000);
+    char* reused_brk = sbrk(0);
+    for ( i=0; i < OBJECTS_COUNT; i++ ) zfree(objects[i]);
+    TEST_OPERATION_RESULT( reused_brk==brk, &ret, ret==1 );
+
+    /*pages of large object not fitting into cache are unmapped*/
+    struct zmemstat before, allocated, freed;
+    zmemstat(&before);
+    ptr = zmalloc(ZMALLOC_PAGE_SIZE*ZMALLOC_LARGE_CACHE_PAGES*2);
+    zmemstat(&allocated);
+    zfree(ptr);
+    zmemstat(&freed);
+    TEST_OPERATION_RESULT( before.free_pages-allocated.free_pages, &ret,
+			   ret>=ZMALLOC_LARGE_CACHE_PAGES*2 );
+    TEST_OPERATION_RESULT( freed.free_pages==before.free_pages, &ret, ret==1 );
+    return 0;
+}
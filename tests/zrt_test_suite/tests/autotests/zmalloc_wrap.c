@@ -0,0 +1,110 @@
+/*
+ * zmalloc replacing malloc family at link time: nexe is linked with
+ * ZMALLOC_LDFLAGS, see LDFLAGS-zmalloc_wrap.c of Makefile; objects
+ * allocated by glibc functions are zmalloc objects freed by zfree, and
+ * pointers allocated by glibc malloc itself are freed by glibc
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "zmalloc.h"
+
+#define TEST_FILE "/zmalloc_wrap.txt"
+#define LINES_COUNT 100
+/*longer than initial getline buffer, so it's grown by realloc*/
+#define LINE_MAX_SIZE 1000
+#define LARGE_SIZE (1024*1024)
+
+/*glibc malloc, resolved by --wrap*/
+void* __real_malloc(size_t size);
+
+/*@return count of wrong lines read by getline, buffer of getline is
+ *allocated and grown by zmalloc*/
+static int check_getline(){
+    FILE* f;
+    char* line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    int i, wrong = 0, ret;
+
+    TEST_OPERATION_RESULT( (f = fopen(TEST_FILE, "w"))!=NULL, &ret, ret==1 );
+    for ( i=0; i < LINES_COUNT; i++ )
+	fprintf(f, "%0*d\n", i*LINE_MAX_SIZE/LINES_COUNT + 1, i);
+    TEST_OPERATION_RESULT( fclose(f), &ret, ret==0 );
+
+    TEST_OPERATION_RESULT( (f = fopen(TEST_FILE, "r"))!=NULL, &ret, ret==1 );
+    for ( i=0; (len = getline(&line, &line_size, f)) != -1; i++ ){
+	if ( !zmalloc_owns(line) || line_size < (size_t)len ||
+	     len != i*LINE_MAX_SIZE/LINES_COUNT + 2 || atoi(line) != i )
+	    ++wrong;
+    }
+    TEST_OPERATION_RESULT( i, &ret, ret==LINES_COUNT );
+    TEST_OPERATION_RESULT( fclose(f), &ret, ret==0 );
+    free(line);
+    return wrong;
+}
+
+int main(int argc, char **argv)
+{
+    char *ptr, *dup, *str;
+    void* aligned;
+    int ret;
+
+    /*malloc family is zmalloc*/
+    ptr = malloc(100);
+    TEST_OPERATION_RESULT( zmalloc_owns(ptr), &ret, ret==1 );
+    TEST_OPERATION_RESULT( malloc_usable_size(ptr)>=100, &ret, ret==1 );
+    ptr = realloc(ptr, LARGE_SIZE);
+    TEST_OPERATION_RESULT( zmalloc_owns(ptr), &ret, ret==1 );
+    free(ptr);
+    ptr = calloc(10, 10);
+    TEST_OPERATION_RESULT( zmalloc_owns(ptr) && ptr[99]==0, &ret, ret==1 );
+    free(ptr);
+    TEST_OPERATION_RESULT( posix_memalign(&aligned, 4096, 100), &ret, ret==0 );
+    TEST_OPERATION_RESULT( zmalloc_owns(aligned) && ((uintptr_t)aligned & 4095)==0, &ret, ret==1 );
+    free(aligned);
+
+    /*objects allocated inside of glibc*/
+    dup = strdup("zmalloc");
+    TEST_OPERATION_RESULT( zmalloc_owns(dup) && !strcmp(dup, "zmalloc"), &ret, ret==1 );
+    free(dup);
+    ret = asprintf(&str, "%d", LARGE_SIZE);
+    assert(ret > 0);
+    TEST_OPERATION_RESULT( zmalloc_owns(str) && atoi(str)==LARGE_SIZE, &ret, ret==1 );
+    free(str);
+    TEST_OPERATION_RESULT( check_getline(), &ret, ret==0 );
+
+    /*pointer of glibc malloc is not known by zmalloc, and is freed by
+      glibc*/
+    ptr = __real_malloc(100);
+    TEST_OPERATION_RESULT( ptr!=NULL && !zmalloc_owns(ptr), &ret, ret==1 );
+    strcpy(ptr, "glibc");
+    ptr = realloc(ptr, 200);
+    TEST_OPERATION_RESULT( ptr!=NULL && !zmalloc_owns(ptr) && !strcmp(ptr, "glibc"), &ret, ret==1 );
+    TEST_OPERATION_RESULT( malloc_usable_size(ptr)>=200, &ret, ret==1 );
+    free(ptr);
+    return 0;
+}
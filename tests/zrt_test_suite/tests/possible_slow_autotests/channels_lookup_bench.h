@@ -0,0 +1,80 @@
+/*
+ * Channels lookup benchmark: open, stat, pread channels for manifest
+ * with different channels count. Including test must define
+ * BENCH_CHANNELS_COUNT equal to amount of /dev/bench/N channels added
+ * into manifest by Makefile.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CHANNELS_LOOKUP_BENCH_H__
+#define __CHANNELS_LOOKUP_BENCH_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "bench_helpers.h"
+
+#define BENCH_ITERATIONS 10000
+#define BENCH_CHANNEL_NAME_FORMAT "/dev/bench/%d"
+
+int main(int argc, char **argv)
+{
+    char name[PATH_MAX];
+    char buf[64];
+    struct stat st;
+    struct timeval start;
+    int ret, fd, i;
+    double open_usec=0, stat_usec=0, pread_usec=0;
+
+    /*the last added channel is the worst case for linear search*/
+    snprintf(name, sizeof(name), BENCH_CHANNEL_NAME_FORMAT, BENCH_CHANNELS_COUNT-1);
+    TEST_OPERATION_RESULT( stat(name, &st), &ret, ret==0 );
+
+    for ( i=0; i < BENCH_ITERATIONS; i++ ){
+	gettimeofday(&start, NULL);
+	fd = open(name, O_RDONLY);
+	open_usec += bench_elapsed_usec(&start);
+	assert(fd>=0);
+
+	gettimeofday(&start, NULL);
+	ret = stat(name, &st);
+	stat_usec += bench_elapsed_usec(&start);
+	assert(ret==0);
+
+	gettimeofday(&start, NULL);
+	ret = pread(fd, buf, sizeof(buf), 0);
+	pread_usec += bench_elapsed_usec(&start);
+	assert(ret>=0);
+
+	close(fd);
+    }
+
+    fprintf(stderr, "channels=%d, iterations=%d, usec per call: open=%.3f, stat=%.3f, pread=%.3f\n",
+	    BENCH_CHANNELS_COUNT, BENCH_ITERATIONS,
+	    open_usec/BENCH_ITERATIONS, stat_usec/BENCH_ITERATIONS, pread_usec/BENCH_ITERATIONS);
+    return 0;
+}
+
+#endif //__CHANNELS_LOOKUP_BENCH_H__
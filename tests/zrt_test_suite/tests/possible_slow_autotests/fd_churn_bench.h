@@ -0,0 +1,80 @@
+/*
+ * Open/close churn benchmark: keep BENCH_OPENED_COUNT files opened,
+ * then repeatedly close one of them and open it again. Including test
+ * must define BENCH_OPENED_COUNT.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FD_CHURN_BENCH_H__
+#define __FD_CHURN_BENCH_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "bench_helpers.h"
+
+#define BENCH_ITERATIONS 100000
+#define BENCH_FILE_NAME_FORMAT "/churn%d"
+
+static int s_fds[BENCH_OPENED_COUNT];
+
+int main(int argc, char **argv)
+{
+    char name[PATH_MAX];
+    struct timeval start;
+    double churn_usec;
+    int ret, fd, i;
+
+    for ( i=0; i < BENCH_OPENED_COUNT; i++ ){
+	snprintf(name, sizeof(name), BENCH_FILE_NAME_FORMAT, i);
+	s_fds[i] = open(name, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+	assert(s_fds[i]>=0);
+    }
+
+    gettimeofday(&start, NULL);
+    for ( i=0; i < BENCH_ITERATIONS; i++ ){
+	/*spread closed descriptors over whole range*/
+	int index = (i*7919) % BENCH_OPENED_COUNT;
+	snprintf(name, sizeof(name), BENCH_FILE_NAME_FORMAT, index);
+	ret = close(s_fds[index]);
+	assert(ret==0);
+	fd = open(name, O_RDWR);
+	/*lowest available descriptor must be reused*/
+	assert(fd==s_fds[index]);
+    }
+    churn_usec = bench_elapsed_usec(&start);
+
+    fprintf(stderr, "opened=%d, iterations=%d, usec per close+open=%.3f\n",
+	    BENCH_OPENED_COUNT, BENCH_ITERATIONS, churn_usec/BENCH_ITERATIONS);
+
+    for ( i=0; i < BENCH_OPENED_COUNT; i++ ){
+	snprintf(name, sizeof(name), BENCH_FILE_NAME_FORMAT, i);
+	TEST_OPERATION_RESULT( close(s_fds[i]), &ret, ret==0 );
+	REMOVE_EXISTING_FILEPATH(name);
+    }
+    return 0;
+}
+
+#endif //__FD_CHURN_BENCH_H__
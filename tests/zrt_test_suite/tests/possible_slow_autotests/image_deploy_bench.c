@@ -0,0 +1,90 @@
+/*
+ * Image deploy benchmark: tar image containing 256MB file and 1000
+ * small files is mounted into /bench at startup. Test reports deploy
+ * time and throughput got by zimagestat, checks sizes of deployed files
+ * and contents of small files, every small file N is filled by "N\n"
+ * lines, and reports read throughput of big file.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "zrtapi.h"
+#include "macro_tests.h"
+#include "bench_helpers.h"
+
+#define BIG_FILE_NAME "/bench/big"
+#define BIG_FILE_SIZE (256*1024*1024)
+#define SMALL_FILES_COUNT 1000
+#define SMALL_FILE_SIZE 3000
+#define MB (1024*1024)
+
+/*fill expected contents of small file, the same as created by Makefile*/
+static void small_file_contents(int index, char* buf, int size){
+    char line[16];
+    int linelen = snprintf(line, sizeof(line), "%d\n", index);
+    int i;
+    for ( i=0; i < size; i++ )
+	buf[i] = line[i%linelen];
+}
+
+int main(int argc, char **argv)
+{
+    static char buf[64*1024];
+    char expected[SMALL_FILE_SIZE];
+    char path[64];
+    struct stat st;
+    struct zimagestat deploy;
+    struct timeval start;
+    int ret, fd, i;
+    long long readed = 0;
+
+    TEST_OPERATION_RESULT( zimagestat(&deploy), &ret, ret==0 && deploy.images_count > 0 );
+    fprintf(stderr, "image deployed %lld bytes in %lld ms, %.2f MB/s\n",
+	    deploy.deployed_bytes, deploy.deploy_msec,
+	    deploy.deploy_msec > 0 ? (double)deploy.deployed_bytes/MB/(deploy.deploy_msec/1000.0) : 0.0);
+    TEST_OPERATION_RESULT( deploy.deployed_bytes >= BIG_FILE_SIZE, &ret, ret==1 );
+
+    TEST_OPERATION_RESULT( stat(BIG_FILE_NAME, &st), &ret, ret==0 && st.st_size==BIG_FILE_SIZE );
+    for ( i=0; i < SMALL_FILES_COUNT; i++ ){
+	snprintf(path, sizeof(path), "/bench/small/%d", i);
+	TEST_OPERATION_RESULT( stat(path, &st), &ret, ret==0 && st.st_size==SMALL_FILE_SIZE );
+	small_file_contents(i, expected, SMALL_FILE_SIZE);
+	TEST_OPERATION_RESULT( open(path, O_RDONLY), &fd, fd!=-1 );
+	TEST_OPERATION_RESULT( read(fd, buf, sizeof(buf)), &ret, ret==SMALL_FILE_SIZE );
+	TEST_OPERATION_RESULT( memcmp(buf, expected, SMALL_FILE_SIZE), &ret, ret==0 );
+	TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    }
+
+    TEST_OPERATION_RESULT( open(BIG_FILE_NAME, O_RDONLY), &fd, fd!=-1 );
+    gettimeofday(&start, NULL);
+    while ( (ret=read(fd, buf, sizeof(buf))) > 0 )
+	readed += ret;
+    fprintf(stderr, "deployed file read %.2f MB/s\n",
+	    (double)readed/MB/(bench_elapsed_usec(&start)/1000000.0));
+    TEST_OPERATION_RESULT( readed==BIG_FILE_SIZE, &ret, ret==1 );
+    TEST_OPERATION_RESULT( close(fd), &ret, ret==0 );
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * mapreduce LocalSort benchmark: sort of 1M up to 50M items having
+ * 64bit hashes by user comparator and by radix sort of hash prefixes.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <alloca.h>
+
+#include "map_reduce_lib.h"
+#include "elastic_mr_item.h"
+#include "mr_defines.h"
+#include "buffer.h"
+#include "bench_helpers.h"
+
+#define HASH_TYPE uint64_t
+#define ITEM_SIZE sizeof(				\
+			 struct{			\
+			     BinaryData     key_data;	\
+			     BinaryData     value;	\
+			     uint8_t        own_key;	\
+			     uint8_t        own_value;  \
+			     HASH_TYPE      key_hash;	\
+			 })
+#define MILLION 1000000
+
+static int
+ComparatorHash(const void *h1, const void *h2){
+    HASH_TYPE hash1, hash2;
+    memcpy(&hash1, h1, sizeof(HASH_TYPE));
+    memcpy(&hash2, h2, sizeof(HASH_TYPE));
+    if      ( hash1 < hash2 ) return -1;
+    else if ( hash1 > hash2 ) return 1;
+    else return 0;
+}
+
+static int
+ComparatorMrItem(const void *p1, const void *p2){
+    return ComparatorHash( &((ElasticBufItemData*)p1)->key_hash,
+			   &((ElasticBufItemData*)p2)->key_hash );
+}
+
+/*fill buffer by the same pseudo random hashes for every call*/
+static void FillItems(Buffer *buf, int count){
+    ElasticBufItemData* item = alloca(ITEM_SIZE);
+    HASH_TYPE hash;
+    int i, res;
+    res = AllocBuffer(buf, ITEM_SIZE, count);
+    assert(res==0);
+    memset(item, '\0', ITEM_SIZE);
+    srand(count);
+    for ( i=0; i < count; i++ ){
+	hash = ((HASH_TYPE)rand() << 33) ^ ((HASH_TYPE)rand() << 11) ^ rand();
+	memcpy(&item->key_hash, &hash, sizeof(HASH_TYPE));
+	item->value.addr = i;
+	AddBufferItem(buf, item);
+    }
+}
+
+static void CheckSorted(struct MapReduceUserIf *mif, const Buffer *buf){
+    int i;
+    for ( i=1; i < buf->header.count; i++ ){
+	assert( ComparatorMrItem(BufferItemPointer(buf, i-1),
+				 BufferItemPointer(buf, i)) <= 0 );
+    }
+}
+
+/*@return sort time in usec*/
+static double BenchLocalSort(struct MapReduceUserIf *mif, int count){
+    struct timeval start;
+    double usec;
+    Buffer buf;
+    FillItems(&buf, count);
+    gettimeofday(&start, NULL);
+    LocalSort(mif, &buf);
+    usec = bench_elapsed_usec(&start);
+    CheckSorted(mif, &buf);
+    FreeBufferData(&buf);
+    return usec;
+}
+
+int main(int argc, char **argv)
+{
+    static const int s_items_counts[] = {MILLION, 10*MILLION, 50*MILLION};
+    struct MapReduceUserIf mif;
+    double qsort_usec, radix_usec;
+    int i;
+
+    memset(&mif, '\0', sizeof(mif));
+    PREPARE_MAPREDUCE( &mif, NULL, NULL, NULL,
+		       ComparatorMrItem, ComparatorHash, NULL,
+		       1,    /*value addr is data*/
+		       ITEM_SIZE,
+		       sizeof(HASH_TYPE) );
+
+    for ( i=0; i < sizeof(s_items_counts)/sizeof(*s_items_counts); i++ ){
+	SET_MAPREDUCE_HASH_ORDER(&mif, EHashOrderUnknown);
+	qsort_usec = BenchLocalSort(&mif, s_items_counts[i]);
+	SET_MAPREDUCE_HASH_ORDER(&mif, EHashOrderUint);
+	radix_usec = BenchLocalSort(&mif, s_items_counts[i]);
+
+	fprintf(stderr, "items=%dM, qsort %.0f ms, radix %.0f ms, speedup %.2f\n",
+		s_items_counts[i]/MILLION, qsort_usec/1000, radix_usec/1000,
+		qsort_usec/radix_usec);
+    }
+    return 0;
+}
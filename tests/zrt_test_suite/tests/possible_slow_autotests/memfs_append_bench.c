@@ -0,0 +1,83 @@
+/*
+ * In-memory filesystem append benchmark: append to files of size from
+ * 1MB up to 2GB, report throughput and heap usage at the end of append
+ * comparing it with file size.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "bench_helpers.h"
+#include "zrtapi.h"
+
+#define BENCH_FILE_NAME "/append_bench.data"
+#define BENCH_BLOCK_SIZE 4096
+#define MB (1024LL*1024LL)
+
+/*memory taken from heap by brk or mmap, it doesn't depend on allocator*/
+static long long heap_usage(){
+    struct zmemstat stat;
+    zmemstat(&stat);
+    return -(long long)stat.free_pages*stat.page_size;
+}
+
+int main(int argc, char **argv)
+{
+    static const off64_t s_file_sizes[] = {MB, 16*MB, 256*MB, 2048*MB};
+    char block[BENCH_BLOCK_SIZE];
+    struct stat st;
+    struct timeval start;
+    int ret, fd, i;
+    memset(block, 'x', sizeof(block));
+
+    for ( i=0; i < sizeof(s_file_sizes)/sizeof(*s_file_sizes); i++ ){
+	off64_t written = 0;
+	long long heap_before = heap_usage();
+	double usec;
+
+	fd = open(BENCH_FILE_NAME, O_CREAT|O_WRONLY|O_APPEND, S_IRUSR|S_IWUSR);
+	assert(fd>=0);
+	gettimeofday(&start, NULL);
+	while ( written < s_file_sizes[i] ){
+	    ret = write(fd, block, sizeof(block));
+	    assert(ret==sizeof(block));
+	    written += ret;
+	}
+	usec = bench_elapsed_usec(&start);
+	TEST_OPERATION_RESULT( fstat(fd, &st), &ret, ret==0 && st.st_size==written );
+
+	fprintf(stderr, "file size=%lldMB, append %.2f MB/s, heap usage growth=%lldMB\n",
+		s_file_sizes[i]/MB, (double)written/MB/(usec/1000000.0),
+		(heap_usage()-heap_before)/MB);
+
+	close(fd);
+	TEST_OPERATION_RESULT( unlink(BENCH_FILE_NAME), &ret, ret==0 );
+    }
+    return 0;
+}
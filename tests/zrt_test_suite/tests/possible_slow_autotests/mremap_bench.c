@@ -0,0 +1,123 @@
+/*
+ * mremap benchmark: grow vector from 1MB up to 1GB by doubling its
+ * capacity, using mmap+copy+munmap, zmremap and realloc; report time
+ * and count of growths done in place.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "zrtapi.h"
+#include "bench_helpers.h"
+
+#define MB (1024*1024)
+#define MIN_VECTOR_SIZE MB
+#define MAX_VECTOR_SIZE (1024*MB)
+
+enum { EGrowMmapCopy, EGrowMremap, EGrowRealloc };
+static const char* s_grow_names[] = {"mmap+copy", "zmremap", "realloc"};
+
+/*@return new address of vector, or NULL if no memory*/
+static char* grow_vector(int method, char* vector, size_t size, size_t new_size){
+    char* grown;
+    switch( method ){
+    case EGrowMmapCopy:
+	grown = mmap(NULL, new_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if ( grown == MAP_FAILED ) return NULL;
+	if ( vector != NULL ){
+	    memcpy(grown, vector, size);
+	    munmap(vector, size);
+	}
+	return grown;
+    case EGrowMremap:
+	if ( vector == NULL )
+	    grown = mmap(NULL, new_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	else
+	    grown = zmremap(vector, size, new_size, MREMAP_MAYMOVE);
+	return grown != MAP_FAILED ? grown : NULL;
+    default:
+	return realloc(vector, new_size);
+    }
+}
+
+static void free_vector(int method, char* vector, size_t size){
+    if ( method == EGrowRealloc )
+	free(vector);
+    else
+	munmap(vector, size);
+}
+
+/*fill vector growing it by doubling capacity, and check its contents
+ *@return max size reached*/
+static size_t bench_grow(int method){
+    struct timeval start;
+    char *vector = NULL, *grown;
+    size_t size = 0, new_size, i;
+    int in_place = 0, growths = 0;
+
+    gettimeofday(&start, NULL);
+    for ( new_size=MIN_VECTOR_SIZE; new_size <= MAX_VECTOR_SIZE; new_size*=2 ){
+	grown = grow_vector(method, vector, size, new_size);
+	if ( grown == NULL ){
+	    fprintf(stderr, "%s: no memory to grow vector to %uMB\n",
+		    s_grow_names[method], (unsigned)(new_size/MB));
+	    break;
+	}
+	if ( grown == vector ) ++in_place;
+	++growths;
+	/*append data into new part of vector*/
+	memset(grown+size, (char)growths, new_size-size);
+	vector = grown;
+	size = new_size;
+    }
+    double usec = bench_elapsed_usec(&start);
+
+    /*data of every growth is at its place*/
+    int wrong = 0, part = 2;
+    for ( i=0; i < size; i+=MB ){
+	/*growth N filled range [MIN<<(N-2), MIN<<(N-1))*/
+	while ( i >= (size_t)MIN_VECTOR_SIZE << (part-1) ) ++part;
+	if ( vector[i] != (char)(i < MIN_VECTOR_SIZE ? 1 : part) ) ++wrong;
+    }
+    int ret;
+    TEST_OPERATION_RESULT( wrong, &ret, ret==0 );
+
+    fprintf(stderr, "%s: grow vector up to %uMB %.0f ms, growths=%d, in place=%d\n",
+	    s_grow_names[method], (unsigned)(size/MB), usec/1000, growths, in_place);
+    if ( vector != NULL )
+	free_vector(method, vector, size);
+    return size;
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+    /*vector is always grown by zmremap at least as big as by mmap+copy*/
+    size_t mmap_size = bench_grow(EGrowMmapCopy);
+    TEST_OPERATION_RESULT( bench_grow(EGrowMremap)>=mmap_size, &ret, ret==1 );
+    bench_grow(EGrowRealloc);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * zmalloc benchmark: compare zmalloc with glibc malloc linked into the
+ * same nexe on workloads of small objects churn, mixed small and large
+ * objects, growth of objects by realloc; report time and pages taken
+ * from heap at the peak of workload.
+ *
+ * Copyright (c) 2013, LiteStack, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <error.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macro_tests.h"
+#include "zrtapi.h"
+#include "zmalloc.h"
+#include "bench_helpers.h"
+
+#define KB 1024
+#define MB (1024*1024)
+#define CHURN_SLOTS 4096
+#define CHURN_OPERATIONS 1000000
+#define MIXED_SLOTS 512
+#define MIXED_OPERATIONS 100000
+#define GROWN_OBJECTS 64
+#define GROWN_MAX_SIZE (256*KB)
+#define GROWN_STEP KB
+
+struct Allocator{
+    const char* name;
+    void* (*malloc)(size_t size);
+    void  (*free)(void* ptr);
+    void* (*realloc)(void* ptr, size_t size);
+};
+
+static const struct Allocator s_allocators[] = {
+    {"glibc",   malloc,  free,  realloc},
+    {"zmalloc", zmalloc, zfree, zrealloc}
+};
+
+static void* s_slots[CHURN_SLOTS];
+static size_t s_sizes[CHURN_SLOTS];
+static unsigned s_random;
+
+/*own generator to get the same sequence for every allocator*/
+static unsigned bench_random(){
+    s_random = s_random*1103515245 + 12345;
+    return (s_random >> 16) & 0x7fff;
+}
+
+/*@return count of pages of heap taken since stat was got*/
+static size_t bench_taken_pages(const struct zmemstat* stat){
+    struct zmemstat now;
+    zmemstat(&now);
+    return stat->free_pages > now.free_pages ? stat->free_pages - now.free_pages : 0;
+}
+
+/*object is filled by its slot index, so every byte of object is checked*/
+static void fill_slot(int slot, size_t size){
+    memset(s_slots[slot], (char)slot, size);
+    s_sizes[slot] = size;
+}
+
+/*@return count of wrong objects, all objects are freed*/
+static int check_slots(const struct Allocator* allocator, int slots){
+    int i, wrong = 0;
+    size_t j;
+    for ( i=0; i < slots; i++ ){
+	if ( s_slots[i] == NULL ) continue;
+	for ( j=0; j < s_sizes[i]; j++ ){
+	    if ( ((char*)s_slots[i])[j] != (char)i ){
+		++wrong;
+		break;
+	    }
+	}
+	allocator->free(s_slots[i]);
+	s_slots[i] = NULL;
+    }
+    return wrong;
+}
+
+/*replace random objects by objects of size up to max_small_size, or
+ *by large objects with given probability in percents*/
+static int bench_replace(const struct Allocator* allocator, const char* workload,
+			 int slots, int operations, size_t max_small_size, int large_percent){
+    struct timeval start;
+    struct zmemstat stat;
+    size_t peak = 0, pages;
+    int i;
+
+    s_random = operations;
+    zmemstat(&stat);
+    gettimeofday(&start, NULL);
+    for ( i=0; i < operations; i++ ){
+	int slot = bench_random() % slots;
+	size_t size = 1 + bench_random() % max_small_size;
+	if ( (int)(bench_random() % 100) < large_percent )
+	    size = ZMALLOC_MAX_SMALL_SIZE + bench_random() * 32;
+	allocator->free(s_slots[slot]);
+	s_slots[slot] = allocator->malloc(size);
+	if ( s_slots[slot] == NULL ) break;
+	fill_slot(slot, size < 64 ? size : 64);
+	if ( i % (operations/16) == 0 && (pages = bench_taken_pages(&stat)) > peak )
+	    peak = pages;
+    }
+    double usec = bench_elapsed_usec(&start);
+    fprintf(stderr, "%s %s: %d operations %.0f ms, peak pages=%u\n",
+	    allocator->name, workload, i, usec/1000, (unsigned)peak);
+    return i == operations ? check_slots(allocator, slots) : -1;
+}
+
+/*grow objects by realloc interleaving them*/
+static int bench_grow(const struct Allocator* allocator){
+    struct timeval start;
+    struct zmemstat stat;
+    size_t size, peak = 0, pages;
+    int i, wrong;
+
+    zmemstat(&stat);
+    gettimeofday(&start, NULL);
+    for ( size=GROWN_STEP; size <= GROWN_MAX_SIZE; size+=GROWN_STEP ){
+	for ( i=0; i < GROWN_OBJECTS; i++ ){
+	    s_slots[i] = allocator->realloc(s_slots[i], size);
+	    if ( s_slots[i] == NULL ) return -1;
+	    memset((char*)s_slots[i]+size-GROWN_STEP, (char)i, GROWN_STEP);
+	    s_sizes[i] = size;
+	}
+	/*moved objects are freed, so peak is reached inside of loop*/
+	if ( (pages = bench_taken_pages(&stat)) > peak )
+	    peak = pages;
+    }
+    double usec = bench_elapsed_usec(&start);
+    wrong = check_slots(allocator, GROWN_OBJECTS);
+    fprintf(stderr, "%s grow: %d objects up to %uKB %.0f ms, peak pages=%u\n",
+	    allocator->name, GROWN_OBJECTS, (unsigned)(GROWN_MAX_SIZE/KB),
+	    usec/1000, (unsigned)peak);
+    return wrong;
+}
+
+int main(int argc, char **argv)
+{
+    int ret, i;
+    for ( i=0; i < sizeof(s_allocators)/sizeof(*s_allocators); i++ ){
+	const struct Allocator* allocator = &s_allocators[i];
+	TEST_OPERATION_RESULT( bench_replace(allocator, "churn", CHURN_SLOTS,
+					     CHURN_OPERATIONS, 512, 0), &ret, ret==0 );
+	TEST_OPERATION_RESULT( bench_replace(allocator, "mixed", MIXED_SLOTS,
+					     MIXED_OPERATIONS, 4*KB, 10), &ret, ret==0 );
+	TEST_OPERATION_RESULT( bench_grow(allocator), &ret, ret==0 );
+    }
+    return 0;
+}